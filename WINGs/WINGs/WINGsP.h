@@ -449,6 +449,9 @@ void W_CallDestroyHandlers(W_View *view);
 
 /* ---[ wfont.c ]--------------------------------------------------------- */
 
+/* number of non ASCII characters whose width is remembered by a font */
+#define W_GLYPH_CACHE_SIZE	256
+
 typedef struct W_Font {
     struct W_Screen *screen;
 
@@ -461,6 +464,13 @@ typedef struct W_Font {
 
 #ifdef USE_PANGO
     PangoLayout *layout;
+#else
+    /* advance of the characters already measured, -1 when not known */
+    short asciiWidths[128];
+    struct {
+        unsigned int ucs;
+        short width;
+    } glyphWidths[W_GLYPH_CACHE_SIZE];
 #endif
 } W_Font;
 
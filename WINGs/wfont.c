@@ -121,6 +121,66 @@ static char *makeFontOfSize(const char *font, int size, const char *fallback)
 	return result;
 }
 
+#ifndef USE_PANGO
+static void initGlyphWidths(WMFont *font)
+{
+	int i;
+
+	for (i = 0; i < wlengthof(font->asciiWidths); i++)
+		font->asciiWidths[i] = -1;
+
+	for (i = 0; i < W_GLYPH_CACHE_SIZE; i++)
+		font->glyphWidths[i].width = -1;
+}
+
+/*
+ * Xft draws a string with the advance of every glyph added up, so the width
+ * of each character is measured once and remembered: in a plain table for
+ * ASCII, and in a table indexed by a hash of the character for the others.
+ */
+static int glyphWidth(WMFont *font, FcChar32 ucs)
+{
+	XGlyphInfo extents;
+	short *width;
+
+	if (ucs < wlengthof(font->asciiWidths)) {
+		width = &font->asciiWidths[ucs];
+	} else {
+		int i = (ucs ^ (ucs >> 7)) % W_GLYPH_CACHE_SIZE;
+
+		if (font->glyphWidths[i].ucs != ucs)
+			font->glyphWidths[i].width = -1;
+		font->glyphWidths[i].ucs = ucs;
+		width = &font->glyphWidths[i].width;
+	}
+
+	if (*width < 0) {
+		XftTextExtents32(font->screen->display, font->font, &ucs, 1, &extents);
+		*width = extents.xOff;
+	}
+
+	return *width;
+}
+
+/*
+ * Gets the next character of an UTF-8 string and returns the number of bytes
+ * it takes, or 0 when the string is not valid anymore, where Xft stops.
+ */
+static int nextCharacter(const char *text, int length, FcChar32 *ucs)
+{
+	int len;
+
+	if ((unsigned char)*text < 0x80) {
+		*ucs = (unsigned char)*text;
+		return 1;
+	}
+
+	len = FcUtf8ToUcs4((const FcChar8 *) text, ucs, length);
+
+	return (len > 0) ? len : 0;
+}
+#endif
+
 WMFont *WMCreateFont(WMScreen * scrPtr, const char *fontName)
 {
 	Display *display = scrPtr->display;
@@ -166,6 +226,10 @@ WMFont *WMCreateFont(WMScreen * scrPtr, const char *fontName)
 	font->height = font->font->ascent + font->font->descent;
 	font->y = font->font->ascent;
 
+#ifndef USE_PANGO
+	initGlyphWidths(font);
+#endif
+
 	font->refCount = 1;
 
 	font->name = fname;
@@ -295,11 +359,9 @@ WMFont *WMBoldSystemFontOfSize(WMScreen * scrPtr, int size)
 
 int WMWidthOfString(WMFont * font, const char *text, int length)
 {
+	int width;
 #ifdef USE_PANGO
 	const char *previous_text;
-	int width;
-#else
-	XGlyphInfo extents;
 #endif
 
 	wassertrv(font != NULL && text != NULL, 0);
@@ -311,9 +373,75 @@ int WMWidthOfString(WMFont * font, const char *text, int length)
 
 	return width;
 #else
-	XftTextExtentsUtf8(font->screen->display, font->font, (XftChar8 *) text, length, &extents);
+	width = 0;
+	while (length > 0) {
+		FcChar32 ucs;
+		int len = nextCharacter(text, length, &ucs);
+
+		if (len == 0)
+			break;
+
+		width += glyphWidth(font, ucs);
+		text += len;
+		length -= len;
+	}
+
+	return width;
+#endif
+}
+
+/*
+ * Fills widths[i] with the width of the first i bytes of text, for i going
+ * from 0 to length, so that the place where a string must be cut to fit in
+ * some space can be found without measuring it again and again. Positions
+ * in the middle of a multibyte character get the width of what is before
+ * that character.
+ */
+void WMWidthsOfStringPrefixes(WMFont *font, const char *text, int length, int *widths)
+{
+	int i, width;
+#ifdef USE_PANGO
+	const char *previous_text;
+	PangoRectangle pos;
+#endif
 
-	return extents.xOff;	/* don't ask :P */
+	wassertr(font != NULL && text != NULL && widths != NULL);
+
+	widths[0] = 0;
+#ifdef USE_PANGO
+	previous_text = pango_layout_get_text(font->layout);
+	if ((previous_text == NULL) || (strncmp(text, previous_text, length) != 0) || previous_text[length] != '\0')
+		pango_layout_set_text(font->layout, text, length);
+
+	width = 0;
+	for (i = 1; i < length; i++) {
+		if ((text[i] & 0xc0) != 0x80) {
+			pango_layout_index_to_pos(font->layout, i, &pos);
+			width = PANGO_PIXELS(pos.x);
+		}
+		widths[i] = width;
+	}
+	if (length > 0)
+		pango_layout_get_pixel_size(font->layout, &widths[length], NULL);
+#else
+	width = 0;
+	i = 0;
+	while (i < length) {
+		FcChar32 ucs;
+		int len = nextCharacter(text + i, length - i, &ucs);
+
+		if (len == 0)
+			break;
+
+		/* the bytes of the character but the first one are inside it */
+		while (--len > 0 && i < length)
+			widths[++i] = width;
+
+		width += glyphWidth(font, ucs);
+		widths[++i] = width;
+	}
+	while (i < length)
+		widths[++i] = width;
 #endif
 }
 
@@ -205,3 +205,61 @@ AC_DEFUN_ONCE([WM_XEXT_CHECK_XRANDR],
     [supported_xext], [LIBXRANDR], [], [-])dnl
 AC_SUBST([LIBXRANDR])dnl
 ]) dnl AC_DEFUN
+
+
+# WM_XEXT_CHECK_XDAMAGE
+# ---------------------
+#
+# Check for the X Damage extension, used to track changes in client windows
+# The check depends on variable 'enable_xdamage' being either:
+#   yes  - detect, fail if not found
+#   no   - do not detect, disable support
+#   auto - detect, disable if not found
+#
+# When found, append appropriate stuff in LIBXDAMAGE, and append info to
+# the variable 'supported_xext'
+# When not found, append info to variable 'unsupported'
+AC_DEFUN_ONCE([WM_XEXT_CHECK_XDAMAGE],
+[WM_LIB_CHECK([XDamage], [-lXdamage], [XDamageQueryExtension], [$XLIBS],
+    [wm_save_CFLAGS="$CFLAGS"
+     AS_IF([wm_fn_lib_try_compile "X11/extensions/Xdamage.h" "Display *dpy;" "XDamageQueryExtension(dpy, NULL, NULL)" ""],
+        [],
+        [AC_MSG_ERROR([found $CACHEVAR but cannot compile using XDamage header])])
+     CFLAGS="$wm_save_CFLAGS"],
+    [supported_xext], [LIBXDAMAGE], [enable_xdamage], [-])dnl
+AC_SUBST([LIBXDAMAGE])dnl
+]) dnl AC_DEFUN
+
+
+# WM_XEXT_CHECK_XCB
+# -----------------
+#
+# Check for the Xlib/XCB bridge, used to send several requests before
+# waiting for the replies
+# The check depends on variable 'enable_xcb' being either:
+#   yes  - detect, fail if not found
+#   no   - do not detect, disable support
+#   auto - detect, disable if not found
+#
+# When found, append appropriate stuff in LIBXCB, and append info to
+# the variable 'supported_xext'
+# When not found, append info to variable 'unsupported'
+AC_DEFUN_ONCE([WM_XEXT_CHECK_XCB],
+[WM_LIB_CHECK([XCB], [-lX11-xcb], [XGetXCBConnection], [$XLIBS -lxcb],
+    [wm_save_CFLAGS="$CFLAGS"
+     AC_COMPILE_IFELSE([AC_LANG_PROGRAM([dnl
+@%:@include <X11/Xlib.h>
+@%:@include <X11/Xlib-xcb.h>
+@%:@include <xcb/xcb.h>
+], [dnl
+  xcb_connection_t *c = XGetXCBConnection(NULL);
+
+  xcb_get_property(c, 0, 0, 0, XCB_GET_PROPERTY_TYPE_ANY, 0, 1);])],
+        [],
+        [AC_MSG_ERROR([found $CACHEVAR but cannot compile using Xlib-xcb header])])
+     CFLAGS="$wm_save_CFLAGS"],
+    [supported_xext], [LIBXCB], [enable_xcb], [-])dnl
+AS_IF([test "x$enable_xcb" != "xno"],
+    [WM_APPEND_ONCE([-lxcb], [LIBXCB])])dnl
+AC_SUBST([LIBXCB])dnl
+]) dnl AC_DEFUN
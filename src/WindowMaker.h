@@ -468,6 +468,7 @@ extern struct WPreferences {
 	char workspace_border_position;     /* Where to leave a workspace border */
 	char single_click;                  /* single click to lauch applications */
 	int history_lines;                  /* history of "Run..." dialog */
+	int max_concurrent_launches;        /* applications started at once when restoring, 0 for no limit */
 	char cycle_active_head_only;        /* Cycle only windows on the active head */
 	char cycle_ignore_minimized;        /* Ignore minimized windows when cycling */
 	char strict_windoze_cycle;          /* don't close switch panel when shift is released */
@@ -797,6 +798,13 @@ extern struct wmaker_global_variables {
 		} randr;
 #endif
 
+#ifdef USE_XDAMAGE
+		struct {
+			Bool supported;
+			int event_base;
+		} damage;
+#endif
+
 		/*
 		 * If no extension were activated, we would end up with an empty
 		 * structure, which old compilers may not appreciate, so let's
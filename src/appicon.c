@@ -54,6 +54,7 @@
 #include "placement.h"
 #include "misc.h"
 #include "event.h"
+#include "launchqueue.h"
 #ifdef USE_DOCK_XDND
 #include "xdnd.h"
 #endif
@@ -413,6 +414,7 @@ WAppIcon *create_appicon(virtual_screen *vscr, char *command, char *wm_class, ch
 
 void wAppIconDestroy(WAppIcon *aicon)
 {
+	wLaunchQueueRemoveIcon(aicon);
 	RemoveFromStackList(aicon->icon->vscr, aicon->icon->core);
 	wIconDestroy(aicon->icon);
 	if (aicon->command)
@@ -516,6 +518,23 @@ void wAppIconPaint(WAppIcon *aicon)
 			       0, 0, wPreferences.icon_size, wPreferences.icon_size);
 }
 
+/* the marks of wAppIconPaint() are all in the top left corner */
+Bool wAppIconExposeNeedsPaint(WAppIcon *aicon, XEvent *event)
+{
+	WScreen *scr = aicon->icon->vscr->screen_ptr;
+
+	if (aicon->launching || wIconExposeNeedsPaint(aicon->icon, event))
+		return True;
+
+#ifdef WS_INDICATOR
+	if (aicon->docked && aicon->yindex == 0)
+		return True;
+#endif
+
+	return wExposeIntersects(event, 0, 0, WMAX(scr->dock_dots->width, 13),
+				 WMAX(scr->dock_dots->height, 13));
+}
+
 /* Save the application icon, if it's a dockapp then use it with dock = True */
 void save_appicon(WAppIcon *aicon)
 {
@@ -762,8 +781,8 @@ static void iconExpose(WObjDescriptor *desc, XEvent *event)
 {
 	WAppIcon *aicon = desc->parent;
 
-	/* Parameter not used, but tell the compiler that it is ok */
-	(void) event;
+	if (!wAppIconExposeNeedsPaint(aicon, event))
+		return;
 
 	wIconPaint(aicon->icon);
 	wAppIconPaint(aicon);
@@ -0,0 +1,62 @@
+/*
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Messages exchanged with the workspace background helper, 'wmsetbg -helper'.
+ *
+ * Window Maker writes the messages on the standard input of the helper.
+ * Each one is a BGHelperHeader followed by 'length' bytes of data:
+ *
+ *   S  set the texture of the workspace, data is the texture description
+ *   U  unset the texture of the workspace
+ *   C  show the texture of the workspace
+ *   P  set the pixmap search path, data is the path
+ *   K  exit
+ *   B  batch, data is a sequence of messages handled in order
+ *
+ * Strings are not null terminated. Workspace 0 holds the default texture,
+ * the others are the workspaces + 1.
+ *
+ * The helper answers each C with an A header on its standard output once
+ * the background is on the screen, so that Window Maker never queues more
+ * than one change while the helper is busy.
+ */
+
+#ifndef WMBGHELPER_H_
+#define WMBGHELPER_H_
+
+#include <stdint.h>
+
+#define BGHELPER_VERSION	1
+
+/* value of the workspace field for messages which do not use it */
+#define BGHELPER_NO_WORKSPACE	0xffff
+
+/* largest data accepted in one message */
+#define BGHELPER_MAX_LENGTH	(1024 * 1024)
+
+typedef struct BGHelperHeader {
+	uint8_t version;
+	uint8_t type;
+	uint16_t workspace;
+	uint32_t length;
+} BGHelperHeader;
+
+#endif
@@ -1009,6 +1009,8 @@ void clip_destroy(WDock *dock)
 		wArrangeIcons(dock->vscr, True);
 
 	wfree(dock->icon_array);
+	if (dock->slots.used)
+		wfree(dock->slots.used);
 
 	if (dock->vscr->last_dock == dock)
 		dock->vscr->last_dock = NULL;
@@ -1215,6 +1217,8 @@ static void clip_set_attacheddocks(WDock *dock, WMPropList *state)
 	if (clip_set_attacheddocks_do(dock, apps))
 		return;
 
+	wDockInvalidateSlots(dock);
+
 	set_attacheddocks_map(dock);
 
 	/* if the first icon is not defined, use the default */
@@ -1402,6 +1406,7 @@ Bool clip_attach_icon(WDock *dock, WAppIcon *icon, int x, int y, Bool update_ico
 	icon->xindex = x;
 
 	icon->omnipresent = 0;
+	wDockOccupySlot(dock, icon);
 
 	icon->x_pos = dock->x_pos + x * ICON_SIZE;
 	icon->y_pos = dock->y_pos + y * ICON_SIZE;
@@ -1456,9 +1461,7 @@ Bool clip_snap_icon(WDock *dock, WAppIcon *icon, int req_x, int req_y, int *ret_
 	virtual_screen *vscr = dock->vscr;
 	int dx, dy;
 	int ex_x, ex_y;
-	int i, offset = ICON_SIZE / 2;
-	WAppIcon *aicon = NULL;
-	WAppIcon *nicon = NULL;
+	int offset = ICON_SIZE / 2;
 
 	if (wPreferences.flags.noupdates)
 		return False;
@@ -1485,49 +1488,35 @@ Bool clip_snap_icon(WDock *dock, WAppIcon *icon, int req_x, int req_y, int *ret_
 	if (!onScreen(vscr, dx + ex_x * ICON_SIZE, dy + ex_y * ICON_SIZE))
 		return False;
 
-	int start, stop, k, neighbours = 0;
+	int start, stop, k, x, y, neighbours = 0, used = 0;
 
 	start = icon->omnipresent ? 0 : vscr->workspace.current;
 	stop = icon->omnipresent ? vscr->workspace.count : start + 1;
 
-	aicon = NULL;
-	for (k = start; k < stop; k++) {
+	/* the slot must be free, or be the one of the icon when redocking */
+	for (k = start; k < stop && !used; k++) {
 		WDock *tmp = vscr->workspace.array[k]->clip;
 		if (!tmp)
 			continue;
 
-		for (i = 0; i < tmp->max_icons; i++) {
-			nicon = tmp->icon_array[i];
-			if (nicon && nicon->xindex == ex_x && nicon->yindex == ex_y) {
-				aicon = nicon;
-				break;
-			}
-		}
-
-		if (aicon)
-			break;
+		used = wDockSlotIsUsed(tmp, ex_x, ex_y, redocking ? icon : NULL);
 	}
 
-	for (k = start; k < stop; k++) {
+	/* Icon can't be its own neighbour */
+	for (k = start; k < stop && !neighbours; k++) {
 		WDock *tmp = vscr->workspace.array[k]->clip;
 		if (!tmp)
 			continue;
 
-		for (i = 0; i < tmp->max_icons; i++) {
-			nicon = tmp->icon_array[i];
-			if (nicon && nicon != icon &&	/* Icon can't be its own neighbour */
-			    (abs(nicon->xindex - ex_x) <= CLIP_ATTACH_VICINITY &&
-			     abs(nicon->yindex - ex_y) <= CLIP_ATTACH_VICINITY)) {
-				neighbours = 1;
-				break;
-			}
-		}
-
-		if (neighbours)
-			break;
+		for (y = ex_y - CLIP_ATTACH_VICINITY; y <= ex_y + CLIP_ATTACH_VICINITY && !neighbours; y++)
+			for (x = ex_x - CLIP_ATTACH_VICINITY; x <= ex_x + CLIP_ATTACH_VICINITY; x++)
+				if (wDockSlotIsUsed(tmp, x, y, icon)) {
+					neighbours = 1;
+					break;
+				}
 	}
 
-	if (neighbours && (aicon == NULL || (redocking && aicon == icon))) {
+	if (neighbours && !used) {
 		*ret_x = ex_x;
 		*ret_y = ex_y;
 		return True;
@@ -1720,8 +1709,7 @@ static Bool iconCanBeOmnipresent(WAppIcon *aicon)
 {
 	virtual_screen *vscr = aicon->icon->vscr;
 	WDock *clip;
-	WAppIcon *btn;
-	int i, j;
+	int i;
 
 	for (i = 0; i < vscr->workspace.count; i++) {
 		clip = vscr->workspace.array[i]->clip;
@@ -1732,11 +1720,8 @@ static Bool iconCanBeOmnipresent(WAppIcon *aicon)
 		if (clip->icon_count + vscr->global_icon_count >= clip->max_icons)
 			return False;	/* Clip is full in some workspace */
 
-		for (j = 0; j < clip->max_icons; j++) {
-			btn = clip->icon_array[j];
-			if (btn && btn->xindex == aicon->xindex && btn->yindex == aicon->yindex)
-				return False;
-		}
+		if (wDockSlotIsUsed(clip, aicon->xindex, aicon->yindex, NULL))
+			return False;
 	}
 
 	return True;
@@ -1757,6 +1742,7 @@ int wClipMakeIconOmnipresent(WAppIcon *aicon, int omnipresent)
 	if (omnipresent) {
 		if (iconCanBeOmnipresent(aicon)) {
 			aicon->omnipresent = 1;
+			wDockInvalidateGlobalSlots(vscr);
 			new_entry = wmalloc(sizeof(WAppIconChain));
 			new_entry->aicon = aicon;
 			new_entry->next = vscr->clip.global_icons;
@@ -1768,6 +1754,7 @@ int wClipMakeIconOmnipresent(WAppIcon *aicon, int omnipresent)
 		}
 	} else {
 		aicon->omnipresent = 0;
+		wDockInvalidateGlobalSlots(vscr);
 		if (aicon == vscr->clip.global_icons->aicon) {
 			tmp = vscr->clip.global_icons->next;
 			wfree(vscr->clip.global_icons);
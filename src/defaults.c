@@ -67,6 +67,7 @@
 #include "misc.h"
 #include "winmenu.h"
 #include "miniwindow.h"
+#include "thumbnail.h"
 
 typedef struct _WDefaultEntry  WDefaultEntry;
 typedef int (WDECallbackConvert) (WDefaultEntry *entry, WMPropList *plvalue, void *addr);
@@ -234,6 +235,7 @@ static WDECallbackUpdate setClipTitleColorCollapsed;
 static WDECallbackUpdate setMenuStyle;
 static WDECallbackUpdate setSwPOptions;
 static WDECallbackUpdate updateUsableArea;
+static WDECallbackUpdate setMiniPreviewBalloons;
 static WDECallbackUpdate setModifierKeyLabels;
 static WDECallbackUpdate setCursor_root;
 static WDECallbackUpdate setCursor_select;
@@ -774,6 +776,8 @@ WDefaultEntry optionList[] = {
 	    &wPreferences.do_not_make_appicons_bounce, getBool, NULL, NULL, NULL, 1},
 	{"DoubleClickTime", "250", (void *) &wPreferences.dblclick_time,
 	    &wPreferences.dblclick_time, getInt, setDoubleClick, NULL, NULL, 1},
+	{"MaxConcurrentLaunches", "4", NULL,
+	    &wPreferences.max_concurrent_launches, getInt, NULL, NULL, NULL, 1},
 	{"ClipAutoraiseDelay", "600", NULL,
 	     &wPreferences.clip_auto_raise_delay, getInt, NULL, NULL, NULL, 1},
 	{"ClipAutolowerDelay", "1000", NULL,
@@ -843,7 +847,7 @@ WDefaultEntry optionList[] = {
 	{"MiniwindowTitleBalloons", "NO", NULL,
 	    &wPreferences.miniwin_title_balloon, getBool, NULL, NULL, NULL, 1},
 	{"MiniwindowPreviewBalloons", "NO", NULL,
-	    &wPreferences.miniwin_preview_balloon, getBool, NULL, NULL, NULL, 1},
+	    &wPreferences.miniwin_preview_balloon, getBool, setMiniPreviewBalloons, NULL, NULL, 1},
 	{"AppIconBalloons", "NO", NULL,
 	    &wPreferences.appicon_balloon, getBool, NULL, NULL, NULL, 1},
 	{"HelpBalloons", "NO", NULL,
@@ -1666,6 +1670,10 @@ static void refresh_defaults(virtual_screen *vscr, unsigned int needs_refresh)
 	if (foo)
 		WMPostNotificationName(WNWindowAppearanceSettingsChanged, NULL, (void *)(uintptr_t) foo);
 
+	if (needs_refresh & (REFRESH_ICON_FONT | REFRESH_ICON_TITLE_COLOR |
+			     REFRESH_ICON_TITLE_BACK | REFRESH_ICON_TILE))
+		wIconTitleCacheFlush(vscr->screen_ptr);
+
 	if (!(needs_refresh & REFRESH_ICON_TILE)) {
 		foo = 0;
 		if (needs_refresh & REFRESH_ICON_FONT)
@@ -3210,6 +3218,7 @@ static int set_workspace_back(virtual_screen *vscr)
 			SendHelperMessage(vscr, 'P', -1, wPreferences.pixmap_path);
 		}
 
+		BeginHelperBatch(vscr);
 		for (i = 0; i < WMGetPropListItemCount(value); i++) {
 			val = WMGetFromPLArray(value, i);
 			if (val && WMIsPLArray(val) && WMGetPropListItemCount(val) > 0) {
@@ -3220,8 +3229,7 @@ static int set_workspace_back(virtual_screen *vscr)
 				SendHelperMessage(vscr, 'U', i + 1, NULL);
 			}
 		}
-
-		sleep(1);
+		EndHelperBatch(vscr);
 
 		WMReleasePropList(value);
 	}
@@ -3237,9 +3245,11 @@ static int set_workspace_back(virtual_screen *vscr)
 				/* set the default workspace background to this one */
 				str = WMGetPropListDescription(value, False);
 				if (str) {
+					BeginHelperBatch(vscr);
 					SendHelperMessage(vscr, 'S', 0, str);
 					wfree(str);
 					SendHelperMessage(vscr, 'C', vscr->workspace.current + 1, NULL);
+					EndHelperBatch(vscr);
 				} else {
 					SendHelperMessage(vscr, 'U', 0, NULL);
 				}
@@ -5321,6 +5331,16 @@ static int updateUsableArea(virtual_screen *vscr)
 	return REFRESH_USABLE_AREA;
 }
 
+static int setMiniPreviewBalloons(virtual_screen *vscr)
+{
+	/* Parameter not used, but tell the compiler that it is ok */
+	(void) vscr;
+
+	wThumbnailUpdatePreferences();
+
+	return 0;
+}
+
 static int setWorkspaceMapBackground(virtual_screen *vscr)
 {
 	WTexture *texture = get_texture_from_defstruct(vscr, wPreferences.texture.workspacemapback);
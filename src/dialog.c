@@ -62,6 +62,7 @@
 #include "window.h"
 #include "actions.h"
 #include "xinerama.h"
+#include "iconloader.h"
 
 #define COPYRIGHT_TEXT  \
 	"Copyright \xc2\xa9 1997-2006 Alfredo K. Kojima\n"\
@@ -100,6 +101,8 @@ static int pstrcmp(const char **str1, const char **str2);
 static int strmatch(const void *str1, const void *str2);
 static void ScanFiles(const char *dir, const char *prefix, unsigned acceptmask, unsigned declinemask, WMArray *result);
 static void buttonCallback(void *self, void *clientData);
+static void cancelThumbnails(IconPanel *panel, Bool all);
+static void uncheckThumbnails(IconPanel *panel);
 static void drawIconProc(WMList *lPtr, int index, Drawable d, char *text, int state, WMRect *rect);
 static void handleHistoryKeyPress(XEvent *event, void *clientData);
 static void handleKeyPress(XEvent *event, void *clientData);
@@ -568,6 +571,7 @@ static void listPixmaps(virtual_screen *vscr, WMList *lPtr, const char *path)
 	IconPanel *panel = WMGetHangedData(lPtr);
 
 	panel->preview = False;
+	uncheckThumbnails(panel);
 	apath = wexpandpath(path);
 	dir = opendir(apath);
 	if (!dir) {
@@ -594,6 +598,17 @@ static void listPixmaps(virtual_screen *vscr, WMList *lPtr, const char *path)
 			continue;
 		}
 
+#ifdef DT_UNKNOWN
+		/* the type of most entries is known without a stat */
+		if (dentry->d_type == DT_REG) {
+			/* the unreadable ones are greyed out when their preview fails */
+			WMAddListItem(lPtr, dentry->d_name);
+			continue;
+		}
+		if (dentry->d_type != DT_LNK && dentry->d_type != DT_UNKNOWN)
+			continue;
+#endif
+
 		if (stat(pbuf, &statb) < 0)
 			continue;
 
@@ -650,6 +665,7 @@ static void listCallback(void *self, void *data)
 		WMSetLabelImage(panel->iconView, NULL);
 		WMSetButtonEnabled(panel->okButton, False);
 		WMClearList(panel->iconList);
+		cancelThumbnails(panel, False);
 		listPixmaps(panel->vscr, panel->iconList, path);
 	} else {
 		char *tmp, *iconFile;
@@ -697,6 +713,166 @@ static void listIconPaths(WMList *lPtr)
 	wfree(paths);
 }
 
+/*
+ * The previews of the icon list are decoded by the icon loader, so that
+ * scrolling through a large directory does not wait for the image files,
+ * and they are kept for as long as the panel is open. A preview is
+ * decoded again if its file was modified since. The files are only
+ * checked once each time their directory is listed, not on every redraw.
+ */
+typedef struct IconThumbnail {
+	IconPanel *panel;
+	char *path;
+	time_t mtime;
+	off_t size;
+	Bool checked;		/* the file was looked at since the directory was listed */
+
+	Bool loading;
+	RImage *image;		/* NULL if the file could not be loaded */
+	WMPixmap *pixmap[2];	/* the image over the normal and the selected background */
+} IconThumbnail;
+
+static void freeThumbnail(IconThumbnail *thumb)
+{
+	int i;
+
+	if (thumb->loading)
+		wIconLoaderCancel(thumb);
+
+	for (i = 0; i < 2; i++)
+		if (thumb->pixmap[i])
+			WMReleasePixmap(thumb->pixmap[i]);
+
+	if (thumb->image)
+		RReleaseImage(thumb->image);
+
+	wfree(thumb->path);
+	wfree(thumb);
+}
+
+/* Drop the previews still being loaded, or all of them */
+static void cancelThumbnails(IconPanel *panel, Bool all)
+{
+	WMHashEnumerator e;
+	IconThumbnail *thumb;
+	WMArray *drop;
+	int i;
+
+	if (!panel->thumbnails)
+		return;
+
+	drop = WMCreateArray(16);
+	e = WMEnumerateHashTable(panel->thumbnails);
+	while ((thumb = WMNextHashEnumeratorItem(&e)) != NULL)
+		if (all || thumb->loading)
+			WMAddToArray(drop, thumb);
+
+	for (i = 0; i < WMGetArrayItemCount(drop); i++) {
+		thumb = WMGetFromArray(drop, i);
+		WMHashRemove(panel->thumbnails, thumb->path);
+		freeThumbnail(thumb);
+	}
+	WMFreeArray(drop);
+}
+
+/* Have the files of the previews looked at again when they are drawn */
+static void uncheckThumbnails(IconPanel *panel)
+{
+	WMHashEnumerator e;
+	IconThumbnail *thumb;
+
+	if (!panel->thumbnails)
+		return;
+
+	e = WMEnumerateHashTable(panel->thumbnails);
+	while ((thumb = WMNextHashEnumeratorItem(&e)) != NULL)
+		thumb->checked = False;
+}
+
+static void redisplayIconList(void *data)
+{
+	IconPanel *panel = (IconPanel *) data;
+
+	panel->redisplay = NULL;
+	WMRedisplayWidget(panel->iconList);
+}
+
+static void thumbnailLoaded(RImage *image, void *data)
+{
+	IconThumbnail *thumb = (IconThumbnail *) data;
+	IconPanel *panel = thumb->panel;
+
+	thumb->loading = False;
+	thumb->image = image;
+
+	/* several previews usually arrive together, draw them at once */
+	if (!panel->redisplay)
+		panel->redisplay = WMAddIdleHandler(redisplayIconList, panel);
+}
+
+static IconThumbnail *getThumbnail(IconPanel *panel, const char *path, int max_size)
+{
+	IconThumbnail *thumb;
+	struct stat statb;
+
+	if (!panel->thumbnails)
+		panel->thumbnails = WMCreateHashTable(WMStringPointerHashCallbacks);
+
+	thumb = WMHashGet(panel->thumbnails, path);
+	if (thumb && thumb->checked)
+		return thumb;
+
+	if (stat(path, &statb) < 0)
+		return NULL;
+
+	if (thumb) {
+		if (thumb->mtime == statb.st_mtime && thumb->size == statb.st_size) {
+			thumb->checked = True;
+			return thumb;
+		}
+
+		WMHashRemove(panel->thumbnails, thumb->path);
+		freeThumbnail(thumb);
+	}
+
+	thumb = wmalloc(sizeof(IconThumbnail));
+	thumb->panel = panel;
+	thumb->path = wstrdup(path);
+	thumb->mtime = statb.st_mtime;
+	thumb->size = statb.st_size;
+	thumb->checked = True;
+	thumb->loading = True;
+	WMHashInsert(panel->thumbnails, thumb->path, thumb);
+
+	wIconLoaderRequest(panel->vscr->screen_ptr->rcontext, path, max_size, thumbnailLoaded, thumb);
+
+	return thumb;
+}
+
+static WMPixmap *getThumbnailPixmap(IconPanel *panel, IconThumbnail *thumb, WMColor *back, int selected)
+{
+	RImage *image;
+	RColor color;
+
+	if (thumb->pixmap[selected] || !thumb->image)
+		return thumb->pixmap[selected];
+
+	image = RCloneImage(thumb->image);
+	if (!image)
+		return NULL;
+
+	color.red = WMRedComponentOfColor(back) >> 8;
+	color.green = WMGreenComponentOfColor(back) >> 8;
+	color.blue = WMBlueComponentOfColor(back) >> 8;
+	color.alpha = WMGetColorAlpha(back) >> 8;
+
+	RCombineImageWithColor(image, &color);
+	thumb->pixmap[selected] = WMCreatePixmapFromRImage(WMWidgetScreen(panel->win), image, 0);
+	RReleaseImage(image);
+
+	return thumb->pixmap[selected];
+}
+
 static void drawIconProc(WMList *lPtr, int index, Drawable d, char *text, int state, WMRect *rect)
 {
 	IconPanel *panel = WMGetHangedData(lPtr);
@@ -704,11 +880,11 @@ static void drawIconProc(WMList *lPtr, int index, Drawable d, char *text, int st
 	GC gc = scr->draw_gc;
 	GC copygc = scr->copy_gc;
 	char *file, *dirfile;
-	WMPixmap *pixmap;
-	WMColor *back;
+	IconThumbnail *thumb;
+	WMPixmap *pixmap = NULL;
+	WMColor *back, *color;
 	WMSize size;
 	WMScreen *wmscr = WMWidgetScreen(panel->win);
-	RColor color;
 	int x, y, width, height, len;
 
 	/* Parameter not used, but tell the compiler that it is ok */
@@ -728,26 +904,33 @@ static void drawIconProc(WMList *lPtr, int index, Drawable d, char *text, int st
 	snprintf(file, len, "%s/%s", dirfile, text);
 	wfree(dirfile);
 
-	color.red = WMRedComponentOfColor(back) >> 8;
-	color.green = WMGreenComponentOfColor(back) >> 8;
-	color.blue = WMBlueComponentOfColor(back) >> 8;
-	color.alpha = WMGetColorAlpha(back) >> 8;
-
-	pixmap = WMCreateScaledBlendedPixmapFromFile(wmscr, file, &color, width - 2, height - 2);
+	thumb = getThumbnail(panel, file, height - 2);
 	wfree(file);
 
-	if (!pixmap)
+	if (!thumb)
 		return;
 
+	/* the name is drawn alone until the image is loaded */
+	if (!thumb->loading && thumb->image) {
+		pixmap = getThumbnailPixmap(panel, thumb, back, (state & WLDSSelected) ? 1 : 0);
+		if (!pixmap)
+			return;
+	}
+
+	/* the files which could not be read or decoded are greyed out */
+	color = (thumb->loading || thumb->image) ? scr->black : scr->darkGray;
+
 	XFillRectangle(dpy, d, WMColorGC(back), x, y, width, height);
 	XSetClipMask(dpy, gc, None);
 	XDrawLine(dpy, d, WMColorGC(scr->white), x, y + height - 1, x + width, y + height - 1);
-	size = WMGetPixmapSize(pixmap);
-	XSetClipMask(dpy, copygc, WMGetPixmapMaskXID(pixmap));
-	XSetClipOrigin(dpy, copygc, x + (width - size.width) / 2, y + 2);
-	XCopyArea(dpy, WMGetPixmapXID(pixmap), d, copygc, 0, 0,
-		  size.width > 100 ? 100 : size.width, size.height > 64 ? 64 : size.height,
-		  x + (width - size.width) / 2, y + 2);
+	if (pixmap) {
+		size = WMGetPixmapSize(pixmap);
+		XSetClipMask(dpy, copygc, WMGetPixmapMaskXID(pixmap));
+		XSetClipOrigin(dpy, copygc, x + (width - size.width) / 2, y + 2);
+		XCopyArea(dpy, WMGetPixmapXID(pixmap), d, copygc, 0, 0,
+			  size.width > 100 ? 100 : size.width, size.height > 64 ? 64 : size.height,
+			  x + (width - size.width) / 2, y + 2);
+	}
 
 	{
 		int i, j;
@@ -764,11 +947,9 @@ static void drawIconProc(WMList *lPtr, int index, Drawable d, char *text, int st
 				WMDrawString(wmscr, d, scr->white, panel->normalfont,
 					     ofx + i, ofy + j, text, tlen);
 
-		WMDrawString(wmscr, d, scr->black, panel->normalfont, ofx, ofy, text, tlen);
+		WMDrawString(wmscr, d, color, panel->normalfont, ofx, ofy, text, tlen);
 	}
 
-	WMReleasePixmap(pixmap);
-	/* I hope it is better to do not use cache / on my box it is fast nuff */
 	XFlush(dpy);
 }
 
@@ -1000,6 +1181,13 @@ static char *create_dialog_iconchooser_title(const char *instance, const char *c
 
 static void destroy_dialog_iconchooser(IconPanel *panel, Window parent)
 {
+	if (panel->redisplay)
+		WMDeleteIdleHandler(panel->redisplay);
+	if (panel->thumbnails) {
+		cancelThumbnails(panel, True);
+		WMFreeHashTable(panel->thumbnails);
+	}
+
 	WMReleaseFont(panel->normalfont);
 	WMUnmapWidget(panel->win);
 	WMDestroyWidget(panel->win);
@@ -64,6 +64,9 @@ struct IconPanel {
 	short done;
 	short result;
 	short preview;
+
+	WMHashTable *thumbnails;	/* previews of the icon list, by file path */
+	WMHandlerID redisplay;		/* idle handler to redraw the icon list */
 };
 
 struct Panel {
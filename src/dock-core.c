@@ -51,6 +51,7 @@
 #include "dockedapp.h"
 #include "dialog.h"
 #include "shell.h"
+#include "launchqueue.h"
 #include "properties.h"
 #include "menu.h"
 #include "client.h"
@@ -919,9 +920,7 @@ void wDockDoAutoLaunch(WDock *dock, int workspace)
 
 		state = wmalloc(sizeof(WSavedState));
 		state->workspace = workspace;
-		/* TODO: this is klugy and is very difficult to understand
-		 * what's going on. Try to clean up */
-		wDockLaunchWithState(btn, state);
+		wLaunchQueueDockIcon(btn, state);
 	}
 }
 
@@ -1038,10 +1037,12 @@ void wDockReattachIcon(WDock *dock, WAppIcon *icon, int x, int y)
 			break;
 	}
 
+	wDockReleaseSlot(dock, icon);
 	icon->yindex = y;
 	icon->xindex = x;
 	icon->x_pos = dock->x_pos + x * ICON_SIZE;
 	icon->y_pos = dock->y_pos + y * ICON_SIZE;
+	wDockOccupySlot(dock, icon);
 }
 
 Bool wDockMoveIconBetweenDocks(WDock *src, WDock *dest, WAppIcon *icon, int x, int y)
@@ -1108,6 +1109,7 @@ Bool wDockMoveIconBetweenDocks(WDock *src, WDock *dest, WAppIcon *icon, int x, i
 		if (src->icon_array[index] == icon)
 			break;
 
+	wDockReleaseSlot(src, icon);
 	src->icon_array[index] = NULL;
 	src->icon_count--;
 
@@ -1180,6 +1182,7 @@ Bool wDockMoveIconBetweenDocks(WDock *src, WDock *dest, WAppIcon *icon, int x, i
 
 	icon->x_pos = dest->x_pos + x * ICON_SIZE;
 	icon->y_pos = dest->y_pos + y * ICON_SIZE;
+	wDockOccupySlot(dest, icon);
 
 	dest->icon_count++;
 
@@ -1245,6 +1248,7 @@ void wDockDetach(WDock *dock, WAppIcon *icon)
 		if (dock->icon_array[index] == icon)
 			break;
 
+	wDockReleaseSlot(dock, icon);
 	dock->icon_array[index] = NULL;
 	icon->yindex = -1;
 	icon->xindex = -1;
@@ -1328,6 +1332,181 @@ int onScreen(virtual_screen *vscr, int x, int y)
 	return !(flags & (XFLAG_DEAD | XFLAG_PARTIAL));
 }
 
+/*
+ * Slot occupancy
+ *
+ * Docks and clips keep the number of icons in each of their slots, so
+ * that finding a free slot, or what is under an icon being dragged, does
+ * not go through all the icons each time. The map covers the slots that
+ * can be on the screen. It is updated when an icon is attached, moved or
+ * detached, and built again from the icons after the operations which
+ * change many of them at once, like restoring the state. The omnipresent
+ * icons have a map of their own, shared by the clips of all workspaces.
+ *
+ * Drawers do not use it, their icons are always in a row.
+ */
+static unsigned char *slotCount(WDockSlots *slots, int x, int y)
+{
+	if (x < -slots->columns || x > slots->columns || y < -slots->rows || y > slots->rows)
+		return NULL;
+
+	return &slots->used[(y + slots->rows) * (2 * slots->columns + 1) + x + slots->columns];
+}
+
+static void slotsAddIcon(WDockSlots *slots, WAppIcon *icon, int delta)
+{
+	unsigned char *used;
+
+	if (!slots || !slots->valid)
+		return;
+
+	used = slotCount(slots, icon->xindex, icon->yindex);
+	if (!used)
+		return;
+
+	if (delta > 0 && *used < 255)
+		(*used)++;
+	else if (delta < 0 && *used > 0)
+		(*used)--;
+}
+
+static Bool slotsAreCurrent(WDockSlots *slots, WScreen *scr)
+{
+	return slots->valid && slots->scr_width == scr->scr_width && slots->scr_height == scr->scr_height;
+}
+
+static void slotsClear(WDockSlots *slots, WScreen *scr)
+{
+	int columns = scr->scr_width / ICON_SIZE + 1;
+	int rows = scr->scr_height / ICON_SIZE + 1;
+
+	if (!slots->used || slots->columns != columns || slots->rows != rows) {
+		if (slots->used)
+			wfree(slots->used);
+
+		slots->columns = columns;
+		slots->rows = rows;
+		slots->used = wmalloc((2 * columns + 1) * (2 * rows + 1));
+	} else {
+		memset(slots->used, 0, (2 * columns + 1) * (2 * rows + 1));
+	}
+
+	slots->scr_width = scr->scr_width;
+	slots->scr_height = scr->scr_height;
+	slots->valid = 1;
+}
+
+static WDockSlots *dockSlots(WDock *dock)
+{
+	WScreen *scr = dock->vscr->screen_ptr;
+	int i;
+
+	if (!slotsAreCurrent(&dock->slots, scr)) {
+		slotsClear(&dock->slots, scr);
+		for (i = 0; i < dock->max_icons; i++)
+			if (dock->icon_array[i])
+				slotsAddIcon(&dock->slots, dock->icon_array[i], 1);
+	}
+
+	return &dock->slots;
+}
+
+static WDockSlots *globalSlots(virtual_screen *vscr)
+{
+	WAppIconChain *chain;
+
+	if (!vscr->clip.global_slots)
+		vscr->clip.global_slots = wmalloc(sizeof(WDockSlots));
+
+	if (!slotsAreCurrent(vscr->clip.global_slots, vscr->screen_ptr)) {
+		slotsClear(vscr->clip.global_slots, vscr->screen_ptr);
+		for (chain = vscr->clip.global_icons; chain != NULL; chain = chain->next)
+			slotsAddIcon(vscr->clip.global_slots, chain->aicon, 1);
+	}
+
+	return vscr->clip.global_slots;
+}
+
+/* The icon was put in the dock, at its xindex and yindex */
+void wDockOccupySlot(WDock *dock, WAppIcon *icon)
+{
+	if (dock->type == WM_DRAWER)
+		return;
+
+	slotsAddIcon(&dock->slots, icon, 1);
+	if (dock->type == WM_CLIP && icon->omnipresent)
+		slotsAddIcon(dock->vscr->clip.global_slots, icon, 1);
+}
+
+/* The icon is about to leave its slot, or the dock */
+void wDockReleaseSlot(WDock *dock, WAppIcon *icon)
+{
+	if (dock->type == WM_DRAWER)
+		return;
+
+	slotsAddIcon(&dock->slots, icon, -1);
+	if (dock->type == WM_CLIP && icon->omnipresent)
+		slotsAddIcon(dock->vscr->clip.global_slots, icon, -1);
+}
+
+/* The icons of the dock were changed directly, the map will be built again */
+void wDockInvalidateSlots(WDock *dock)
+{
+	dock->slots.valid = 0;
+}
+
+void wDockInvalidateGlobalSlots(virtual_screen *vscr)
+{
+	if (vscr->clip.global_slots)
+		vscr->clip.global_slots->valid = 0;
+}
+
+static int slotUsers(WDockSlots *slots, int x, int y, WAppIcon *ignore)
+{
+	unsigned char *used;
+	int count;
+
+	used = slotCount(slots, x, y);
+	if (!used)
+		return 0;
+
+	count = *used;
+	if (ignore && ignore->xindex == x && ignore->yindex == y && count > 0)
+		count--;
+
+	return count;
+}
+
+/*
+ * Returns True if the slot is used by an icon of the dock other than
+ * 'ignore'. The omnipresent icons are in all the clips.
+ */
+Bool wDockSlotIsUsed(WDock *dock, int x, int y, WAppIcon *ignore)
+{
+	virtual_screen *vscr = dock->vscr;
+	int i;
+
+	if (dock->type == WM_DRAWER) {
+		for (i = 0; i < dock->max_icons; i++) {
+			WAppIcon *btn = dock->icon_array[i];
+
+			if (btn && btn != ignore && btn->xindex == x && btn->yindex == y)
+				return True;
+		}
+
+		return False;
+	}
+
+	if (slotUsers(dockSlots(dock), x, y, (ignore && ignore->dock == dock) ? ignore : NULL) > 0)
+		return True;
+
+	if (dock->type == WM_CLIP && vscr->clip.global_icons &&
+	    slotUsers(globalSlots(vscr), x, y, (ignore && ignore->omnipresent) ? ignore : NULL) > 0)
+		return True;
+
+	return False;
+}
+
 /*
  * returns true if it can find a free slot in the dock,
  * in which case it changes x_pos and y_pos accordingly.
@@ -1337,10 +1516,7 @@ Bool wDockFindFreeSlot(WDock *dock, int *x_pos, int *y_pos)
 {
 	virtual_screen *vscr = dock->vscr;
 	WScreen *scr = vscr->screen_ptr;
-	WAppIcon *btn;
-	WAppIconChain *chain;
-	unsigned char *slot_map;
-	int mwidth, r, x, y, corner;
+	int r, x, y, corner;
 	int i, done = False;
 	int ex = scr->scr_width, ey = scr->scr_height;
 	int extra_count = 0;
@@ -1392,166 +1568,34 @@ Bool wDockFindFreeSlot(WDock *dock, int *x_pos, int *y_pos)
 	/* If the clip is in the corner, use only slots that are in the border
 	 * of the screen */
 	if (corner != C_NONE) {
-		char *hmap, *vmap;
-		int hcount, vcount;
+		int hcount, vcount, xdir, ydir;
 
 		hcount = WMIN(dock->max_icons, vscr->screen_ptr->scr_width / ICON_SIZE);
 		vcount = WMIN(dock->max_icons, vscr->screen_ptr->scr_height / ICON_SIZE);
-		hmap = wmalloc(hcount + 1);
-		vmap = wmalloc(vcount + 1);
-
-		/* mark used positions */
-		switch (corner) {
-		case C_NE:
-			for (i = 0; i < dock->max_icons; i++) {
-				btn = dock->icon_array[i];
-				if (!btn)
-					continue;
-
-				if (btn->xindex == 0 && btn->yindex > 0 && btn->yindex < vcount)
-					vmap[btn->yindex] = 1;
-				else if (btn->yindex == 0 && btn->xindex > 0 && btn->xindex < hcount)
-					hmap[btn->xindex] = 1;
-			}
-
-			for (chain = vscr->clip.global_icons; chain != NULL; chain = chain->next) {
-				btn = chain->aicon;
-				if (btn->xindex == 0 && btn->yindex > 0 && btn->yindex < vcount)
-					vmap[btn->yindex] = 1;
-				else if (btn->yindex == 0 && btn->xindex > 0 && btn->xindex < hcount)
-					hmap[btn->xindex] = 1;
-			}
-
-			break;
-		case C_NW:
-			for (i = 0; i < dock->max_icons; i++) {
-				btn = dock->icon_array[i];
-				if (!btn)
-					continue;
-
-				if (btn->xindex == 0 && btn->yindex > 0 && btn->yindex < vcount)
-					vmap[btn->yindex] = 1;
-				else if (btn->yindex == 0 && btn->xindex < 0 && btn->xindex > -hcount)
-					hmap[-btn->xindex] = 1;
-			}
-
-			for (chain = vscr->clip.global_icons; chain != NULL; chain = chain->next) {
-				btn = chain->aicon;
-				if (btn->xindex == 0 && btn->yindex > 0 && btn->yindex < vcount)
-					vmap[btn->yindex] = 1;
-				else if (btn->yindex == 0 && btn->xindex < 0 && btn->xindex > -hcount)
-					hmap[-btn->xindex] = 1;
-			}
-
-			break;
-		case C_SE:
-			for (i = 0; i < dock->max_icons; i++) {
-				btn = dock->icon_array[i];
-				if (!btn)
-					continue;
-
-				if (btn->xindex == 0 && btn->yindex < 0 && btn->yindex > -vcount)
-					vmap[-btn->yindex] = 1;
-				else if (btn->yindex == 0 && btn->xindex > 0 && btn->xindex < hcount)
-					hmap[btn->xindex] = 1;
-			}
-
-			for (chain = vscr->clip.global_icons; chain != NULL; chain = chain->next) {
-				btn = chain->aicon;
-				if (btn->xindex == 0 && btn->yindex < 0 && btn->yindex > -vcount)
-					vmap[-btn->yindex] = 1;
-				else if (btn->yindex == 0 && btn->xindex > 0 && btn->xindex < hcount)
-					hmap[btn->xindex] = 1;
-			}
-
-			break;
-		case C_SW:
-		default:
-			for (i = 0; i < dock->max_icons; i++) {
-				btn = dock->icon_array[i];
-				if (!btn)
-					continue;
-
-				if (btn->xindex == 0 && btn->yindex < 0 && btn->yindex > -vcount)
-					vmap[-btn->yindex] = 1;
-				else if (btn->yindex == 0 && btn->xindex < 0 && btn->xindex > -hcount)
-					hmap[-btn->xindex] = 1;
-
-			}
+		xdir = (corner == C_NE || corner == C_SE) ? 1 : -1;
+		ydir = (corner == C_NW || corner == C_NE) ? 1 : -1;
 
-			for (chain = vscr->clip.global_icons; chain != NULL; chain = chain->next) {
-				btn = chain->aicon;
-				if (btn->xindex == 0 && btn->yindex < 0 && btn->yindex > -vcount)
-					vmap[-btn->yindex] = 1;
-				else if (btn->yindex == 0 && btn->xindex < 0 && btn->xindex > -hcount)
-					hmap[-btn->xindex] = 1;
-			}
-		}
-
-		x = 0;
-		y = 0;
-		done = 0;
 		/* search a vacant slot */
 		for (i = 1; i < WMAX(vcount, hcount); i++) {
-			if (i < vcount && vmap[i] == 0) {
-				/* found a slot */
-				x = 0;
-				y = i;
-				done = 1;
-				break;
-			} else if (i < hcount && hmap[i] == 0) {
-				/* found a slot */
-				x = i;
-				y = 0;
-				done = 1;
-				break;
+			if (i < vcount && !wDockSlotIsUsed(dock, 0, ydir * i, NULL)) {
+				*x_pos = 0;
+				*y_pos = ydir * i;
+				return True;
+			} else if (i < hcount && !wDockSlotIsUsed(dock, xdir * i, 0, NULL)) {
+				*x_pos = xdir * i;
+				*y_pos = 0;
+				return True;
 			}
 		}
-		wfree(vmap);
-		wfree(hmap);
-		/* If found a slot, translate and return */
-		if (done) {
-			if (corner == C_NW || corner == C_NE)
-				*y_pos = y;
-			else
-				*y_pos = -y;
-
-			if (corner == C_NE || corner == C_SE)
-				*x_pos = x;
-			else
-				*x_pos = -x;
-
-			return True;
-		}
 		/* else, try to find a slot somewhere else */
 	}
 
-	/* a map of mwidth x mwidth would be enough if we allowed icons to be
-	 * placed outside of screen */
-	mwidth = (int)ceil(sqrt(dock->max_icons));
-
-	/* In the worst case (the clip is in the corner of the screen),
-	 * the amount of icons that fit in the clip is smaller.
-	 * Double the map to get a safe value.
+	/* Search within a square of the size that would be enough if we
+	 * allowed icons to be placed outside of screen. In the worst case
+	 * (the clip is in the corner of the screen), the amount of icons that
+	 * fit in the clip is smaller, so it is doubled to get a safe value.
 	 */
-	mwidth += mwidth;
-
-	r = (mwidth - 1) / 2;
-
-	slot_map = wmalloc(mwidth * mwidth);
-
-#define XY2OFS(x,y) (WMAX(abs(x),abs(y)) > r) ? 0 : (((y)+r)*(mwidth)+(x)+r)
-
-	/* mark used slots in the map. If the slot falls outside the map
-	 * (for example, when all icons are placed in line), ignore them. */
-	for (i = 0; i < dock->max_icons; i++) {
-		btn = dock->icon_array[i];
-		if (btn)
-			slot_map[XY2OFS(btn->xindex, btn->yindex)] = 1;
-	}
-
-	for (chain = vscr->clip.global_icons; chain != NULL; chain = chain->next)
-		slot_map[XY2OFS(chain->aicon->xindex, chain->aicon->yindex)] = 1;
+	r = (2 * (int)ceil(sqrt(dock->max_icons)) - 1) / 2;
 
 	/* Find closest slot from the center that is free by scanning the
 	 * map from the center to outward in circular passes.
@@ -1567,7 +1611,7 @@ Bool wDockFindFreeSlot(WDock *dock, int *x_pos, int *y_pos)
 			tx = dock->x_pos + x * ICON_SIZE;
 			y = -i;
 			ty = dock->y_pos + y * ICON_SIZE;
-			if (slot_map[XY2OFS(x, y)] == 0 && onScreen(vscr, tx, ty)) {
+			if (!wDockSlotIsUsed(dock, x, y, NULL) && onScreen(vscr, tx, ty)) {
 				*x_pos = x;
 				*y_pos = y;
 				done = 1;
@@ -1576,7 +1620,7 @@ Bool wDockFindFreeSlot(WDock *dock, int *x_pos, int *y_pos)
 
 			y = i;
 			ty = dock->y_pos + y * ICON_SIZE;
-			if (slot_map[XY2OFS(x, y)] == 0 && onScreen(vscr, tx, ty)) {
+			if (!wDockSlotIsUsed(dock, x, y, NULL) && onScreen(vscr, tx, ty)) {
 				*x_pos = x;
 				*y_pos = y;
 				done = 1;
@@ -1589,7 +1633,7 @@ Bool wDockFindFreeSlot(WDock *dock, int *x_pos, int *y_pos)
 			ty = dock->y_pos + y * ICON_SIZE;
 			x = -i;
 			tx = dock->x_pos + x * ICON_SIZE;
-			if (slot_map[XY2OFS(x, y)] == 0 && onScreen(vscr, tx, ty)) {
+			if (!wDockSlotIsUsed(dock, x, y, NULL) && onScreen(vscr, tx, ty)) {
 				*x_pos = x;
 				*y_pos = y;
 				done = 1;
@@ -1598,7 +1642,7 @@ Bool wDockFindFreeSlot(WDock *dock, int *x_pos, int *y_pos)
 
 			x = i;
 			tx = dock->x_pos + x * ICON_SIZE;
-			if (slot_map[XY2OFS(x, y)] == 0 && onScreen(vscr, tx, ty)) {
+			if (!wDockSlotIsUsed(dock, x, y, NULL) && onScreen(vscr, tx, ty)) {
 				*x_pos = x;
 				*y_pos = y;
 				done = 1;
@@ -1607,10 +1651,6 @@ Bool wDockFindFreeSlot(WDock *dock, int *x_pos, int *y_pos)
 		}
 	}
 
-	wfree(slot_map);
-
-#undef XY2OFS
-
 	return done;
 }
 
@@ -2095,7 +2135,7 @@ void handleDockMove(WDock *dock, WAppIcon *aicon, XEvent *event)
 				moveDock(dock, dock->x_pos, y);
 				if (wPreferences.flags.wrap_appicons_in_dock) {
 					for (i = 0; i < dock->max_icons; i++) {
-						int new_y, new_index, j, ok;
+						int new_y, new_index;
 						tmpaicon = dock->icon_array[i];
 						if (tmpaicon == NULL)
 							continue;
@@ -2108,23 +2148,15 @@ void handleDockMove(WDock *dock, WAppIcon *aicon, XEvent *event)
 						if (!onScreen(vscr, tmpaicon->x_pos, new_y))
 							continue;
 
-						ok = 1;
-						for (j = 0; j < dock->max_icons; j++) {
-							if (dock->icon_array[j] != NULL &&
-							    dock->icon_array[j]->yindex == new_index) {
-								ok = 0;
-								break;
-							}
-						}
-
-						if (!ok || getDrawer(vscr, new_index) != NULL)
+						if (wDockSlotIsUsed(dock, 0, new_index, NULL) ||
+						    getDrawer(vscr, new_index) != NULL)
 							continue;
 
 						wDockReattachIcon(dock, tmpaicon, tmpaicon->xindex, new_index);
 					}
 
 					for (dc = vscr->drawer.drawers; dc != NULL; dc = dc->next) {
-						int new_y, new_index, j, ok;
+						int new_y, new_index;
 						tmpaicon = dc->adrawer->icon_array[0];
 						if (onScreen(vscr, tmpaicon->x_pos, tmpaicon->y_pos))
 							continue;
@@ -2134,16 +2166,8 @@ void handleDockMove(WDock *dock, WAppIcon *aicon, XEvent *event)
 						if (!onScreen(vscr, tmpaicon->x_pos, new_y))
 							continue;
 
-						ok = 1;
-						for (j = 0; j < dock->max_icons; j++) {
-							if (dock->icon_array[j] != NULL &&
-							    dock->icon_array[j]->yindex == new_index) {
-								ok = 0;
-								break;
-							}
-						}
-
-						if (!ok || getDrawer(vscr, new_index) != NULL)
+						if (wDockSlotIsUsed(dock, 0, new_index, NULL) ||
+						    getDrawer(vscr, new_index) != NULL)
 							continue;
 
 						moveDock(dc->adrawer, tmpaicon->x_pos, new_y);
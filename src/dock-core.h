@@ -25,6 +25,14 @@
 
 #include "appicon.h"
 
+/* Number of icons in each slot of a dock, see dock-core.c */
+typedef struct WDockSlots {
+    unsigned char *used;
+    int columns, rows;          /* the slots go from -columns to columns */
+    int scr_width, scr_height;  /* size of the screen the map was made for */
+    unsigned int valid:1;
+} WDockSlots;
+
 typedef struct WDock {
     virtual_screen *vscr;	/* pointer to the virtual_screen for the dock */
     int x_pos, y_pos;		/* position of the first icon */
@@ -34,6 +42,8 @@ typedef struct WDock {
 
     int icon_count;
 
+    WDockSlots slots;		/* occupancy of the slots, not for drawers */
+
 #define WM_DOCK        0
 #define WM_CLIP        1
 #define WM_DRAWER      2
@@ -77,6 +87,12 @@ void wDockDetach(WDock *dock, WAppIcon *icon);
 Bool wDockMoveIconBetweenDocks(WDock *src, WDock *dest, WAppIcon *icon, int x, int y);
 void wDockReattachIcon(WDock *dock, WAppIcon *icon, int x, int y);
 
+void wDockOccupySlot(WDock *dock, WAppIcon *icon);
+void wDockReleaseSlot(WDock *dock, WAppIcon *icon);
+void wDockInvalidateSlots(WDock *dock);
+void wDockInvalidateGlobalSlots(virtual_screen *vscr);
+Bool wDockSlotIsUsed(WDock *dock, int x, int y, WAppIcon *ignore);
+
 void wSlideAppicons(WAppIcon **appicons, int n, int to_the_left);
 
 void wDockFinishLaunch(WAppIcon *icon);
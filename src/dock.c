@@ -676,8 +676,8 @@ void dock_icon_expose(WObjDescriptor *desc, XEvent *event)
 {
 	WAppIcon *aicon = desc->parent;
 
-	/* Parameter not used, but tell the compiler that it is ok */
-	(void) event;
+	if (!wAppIconExposeNeedsPaint(aicon, event))
+		return;
 
 	wIconPaint(aicon->icon);
 	wAppIconPaint(aicon);
@@ -740,6 +740,8 @@ static void dock_set_attacheddocks(WDock *dock, WMPropList *state)
 	if (dock_set_attacheddocks_do(dock, apps))
 		return;
 
+	wDockInvalidateSlots(dock);
+
 	set_attacheddocks_map(dock);
 
 	/* if the first icon is not defined, use the default */
@@ -934,6 +936,7 @@ Bool dock_attach_icon(WDock *dock, WAppIcon *icon, int x, int y, Bool update_ico
 	icon->xindex = x;
 
 	icon->omnipresent = 0;
+	wDockOccupySlot(dock, icon);
 
 	icon->x_pos = dock->x_pos + x * ICON_SIZE;
 	icon->y_pos = dock->y_pos + y * ICON_SIZE;
@@ -1000,8 +1003,7 @@ Bool dock_snap_icon(WDock *dock, WAppIcon *icon, int req_x, int req_y, int *ret_
 	int dx, dy;
 	int ex_x, ex_y;
 	int i, offset = ICON_SIZE / 2;
-	WAppIcon *aicon = NULL;
-	WAppIcon *nicon = NULL;
+	Bool used;
 
 	if (wPreferences.flags.noupdates)
 		return False;
@@ -1043,14 +1045,7 @@ Bool dock_snap_icon(WDock *dock, WAppIcon *icon, int req_x, int req_y, int *ret_
 	if (getDrawer(vscr, ex_y)) /* Return false so that the drawer gets it. */
 		return False;
 
-	aicon = NULL;
-	for (i = 0; i < dock->max_icons; i++) {
-		nicon = dock->icon_array[i];
-		if (nicon && nicon->yindex == ex_y) {
-			aicon = nicon;
-			break;
-		}
-	}
+	used = wDockSlotIsUsed(dock, 0, ex_y, redocking ? icon : NULL);
 
 	if (redocking) {
 		int sig, done, closest;
@@ -1066,7 +1061,7 @@ Bool dock_snap_icon(WDock *dock, WAppIcon *icon, int req_x, int req_y, int *ret_
 		if (abs(ex_x) > DOCK_DETTACH_THRESHOLD)
 			return False;
 
-		if (aicon == icon || !aicon) {
+		if (!used) {
 			*ret_x = 0;
 			*ret_y = ex_y;
 			return True;
@@ -1081,23 +1076,11 @@ Bool dock_snap_icon(WDock *dock, WAppIcon *icon, int req_x, int req_y, int *ret_
 		done = 0;
 		/* look for closest free slot */
 		for (i = 0; i < (DOCK_DETTACH_THRESHOLD + 1) * 2 && !done; i++) {
-			int j;
-
-			done = 1;
 			closest = sig * (i / 2) + ex_y;
 			/* check if this slot is fully on the screen and not used */
 			if (onScreen(vscr, dx, dy + closest * ICON_SIZE)) {
-				for (j = 0; j < dock->max_icons; j++) {
-					if (dock->icon_array[j]
-						&& dock->icon_array[j]->yindex == closest) {
-						/* slot is used by someone else */
-						if (dock->icon_array[j] != icon)
-							done = 0;
-						break;
-					}
-				}
-				/* slot is used by a drawer */
-				done = done && !getDrawer(vscr, closest);
+				/* slot is used by someone else, or by a drawer */
+				done = !wDockSlotIsUsed(dock, 0, closest, icon) && !getDrawer(vscr, closest);
 			} else {
 				/* !onScreen */
 				done = 0;
@@ -1115,7 +1098,7 @@ Bool dock_snap_icon(WDock *dock, WAppIcon *icon, int req_x, int req_y, int *ret_
 		}
 	} else {	/* !redocking */
 		/* if slot is free and the icon is close enough, return it */
-		if (!aicon && ex_x == 0) {
+		if (!used && ex_x == 0) {
 			*ret_x = 0;
 			*ret_y = ex_y;
 			return True;
@@ -1101,8 +1101,8 @@ static void drawer_icon_expose(WObjDescriptor *desc, XEvent *event)
 {
 	WAppIcon *aicon = desc->parent;
 
-	/* Parameter not used, but tell the compiler that it is ok */
-	(void) event;
+	if (!wAppIconExposeNeedsPaint(aicon, event))
+		return;
 
 	wIconPaint(aicon->icon);
 	wAppIconPaint(aicon);
@@ -80,6 +80,8 @@
 #include "winmenu.h"
 #include "switchmenu.h"
 #include "wsmap.h"
+#include "thumbnail.h"
+#include "launchqueue.h"
 
 /************ Local stuff ***********/
 static void saveTimestamp(XEvent *event);
@@ -197,6 +199,7 @@ void DispatchEvent(XEvent *event)
 		return;
 
 	saveTimestamp(event);
+	wThumbnailHandleEvent(event);
 	switch (event->type) {
 	case MapRequest:
 		handleMapRequest(event);
@@ -626,6 +629,7 @@ static void handleMapRequest(XEvent *ev)
 	}
 
 	if (wwin) {
+		wLaunchQueueWindowMapped(wwin);
 		wClientSetState(wwin, NormalState, None);
 		if (wwin->flags.maximized)
 			wMaximizeWindow(wwin, wwin->flags.maximized,
@@ -704,12 +708,33 @@ static void handleDestroyNotify(XEvent *event)
 	}
 }
 
+/*
+ * The handlers get a single event for all the exposures waiting for the
+ * window, with the smallest rectangle holding all of them.
+ */
 static void handleExpose(XEvent *event)
 {
 	WObjDescriptor *desc;
 	XEvent ev;
+	int x1, y1, x2, y2;
+
+	x1 = event->xexpose.x;
+	y1 = event->xexpose.y;
+	x2 = x1 + event->xexpose.width;
+	y2 = y1 + event->xexpose.height;
+
+	while (XCheckTypedWindowEvent(dpy, event->xexpose.window, Expose, &ev)) {
+		x1 = WMIN(x1, ev.xexpose.x);
+		y1 = WMIN(y1, ev.xexpose.y);
+		x2 = WMAX(x2, ev.xexpose.x + ev.xexpose.width);
+		y2 = WMAX(y2, ev.xexpose.y + ev.xexpose.height);
+	}
 
-	while (XCheckTypedWindowEvent(dpy, event->xexpose.window, Expose, &ev)) ;
+	event->xexpose.x = x1;
+	event->xexpose.y = y1;
+	event->xexpose.width = x2 - x1;
+	event->xexpose.height = y2 - y1;
+	event->xexpose.count = 0;
 
 	if (XFindContext(dpy, event->xexpose.window, w_global.context.client_win, (XPointer *) & desc) == XCNOENT)
 		return;
@@ -718,6 +743,13 @@ static void handleExpose(XEvent *event)
 		(*desc->handle_expose) (desc, event);
 }
 
+/* tells if the area exposed by the event meets the rectangle */
+Bool wExposeIntersects(XEvent *event, int x, int y, int width, int height)
+{
+	return (event->xexpose.x < x + width && x < event->xexpose.x + event->xexpose.width &&
+		event->xexpose.y < y + height && y < event->xexpose.y + event->xexpose.height);
+}
+
 static void executeWheelAction(virtual_screen *vscr, XEvent *event, int action)
 {
 	WWindow *wwin;
@@ -1880,6 +1912,8 @@ static void handleVisibilityNotify(XEvent *event)
 		return;
 
 	wwin->flags.obscured = (event->xvisibility.state == VisibilityFullyObscured);
+	wwin->flags.fully_visible = (event->xvisibility.state == VisibilityUnobscured);
+	wThumbnailVisibilityChanged(wwin);
 }
 
 static void handle_selection_request(XSelectionRequestEvent *event)
@@ -35,6 +35,7 @@ void DispatchEvent(XEvent *event);
 void ProcessPendingEvents(void);
 WMagicNumber wAddDeathHandler(pid_t pid, WDeathHandler *callback, void *cdata);
 Bool IsDoubleClick(virtual_screen *vscr, XEvent *event);
+Bool wExposeIntersects(XEvent *event, int x, int y, int width, int height);
 
 /* called from the signal handler */
 void NotifyDeadProcess(pid_t pid, unsigned char status);
@@ -1499,8 +1499,14 @@ static void handleExpose(WObjDescriptor *desc, XEvent *event)
 	if (fwin->titlebar && fwin->flags.titlebar && fwin->titlebar->window == event->xexpose.window)
 		fwin->flags.repaint_only_titlebar = 1;
 
-	if (fwin->resizebar && fwin->resizebar->window == event->xexpose.window)
+	if (fwin->resizebar && fwin->resizebar->window == event->xexpose.window) {
+		/* a textured resize bar is the background of its window */
+		if (fwin->resizebar_texture[0]->any.type != WTEX_SOLID &&
+		    !fwin->flags.need_texture_remake && !fwin->flags.need_texture_change)
+			return;
+
 		fwin->flags.repaint_only_resizebar = 1;
+	}
 
 	wFrameWindowPaint(fwin);
 	fwin->flags.repaint_only_titlebar = 0;
@@ -37,6 +37,7 @@
 #include "texture.h"
 #include "window.h"
 #include "icon.h"
+#include "iconloader.h"
 #include "actions.h"
 #include "stacking.h"
 #include "application.h"
@@ -268,15 +269,21 @@ static void icon_update_pixmap(WIcon *icon, RImage *image)
 	icon->pixmap = pixmap;
 }
 
-void wIconChangeTitle(WIcon *icon, WWindow *wwin)
+/* returns True if the title is not the same as before */
+Bool wIconChangeTitle(WIcon *icon, WWindow *wwin)
 {
 	if (!icon || !wwin || !wwin->title)
-		return;
+		return False;
+
+	if (icon->title) {
+		if (strcmp(icon->title, wwin->title) == 0)
+			return False;
 
-	if (icon->title)
 		wfree(icon->title);
+	}
 
 	icon->title = wstrdup(wwin->title);
+	return True;
 }
 
 RImage *wIconValidateIconSize(RImage *icon, int max_size)
@@ -545,8 +552,18 @@ static void unset_icon_file_image(WIcon *icon)
 	}
 }
 
+static void cancel_icon_loading(WIcon *icon)
+{
+	if (icon->loading) {
+		wIconLoaderCancel(icon);
+		icon->loading = 0;
+	}
+}
+
 static void unset_icon_image(WIcon *icon)
 {
+	cancel_icon_loading(icon);
+
 	if (icon->file_name) {
 		wfree(icon->file_name);
 		icon->file_name = NULL;
@@ -603,11 +620,11 @@ void wIconUpdate(WIcon *icon)
 
 	/* Block if the icon is set by the user */
 	if (wwin && WFLAGP(wwin, always_user_icon)) {
-		if (!icon->file_image)
+		if (!icon->file_image && !icon->loading)
 			icon->file_image = get_rimage_from_file(vscr, icon->file_name, wPreferences.icon_size);
 
 		/* If is empty, then get the default image */
-		if (!icon->file_image) {
+		if (!icon->file_image && !icon->loading) {
 			get_rimage_icon_from_default_icon(icon);
 			icon->file_image = RRetainImage(scr->def_icon_rimage);
 		}
@@ -630,7 +647,7 @@ void wIconUpdate(WIcon *icon)
 		icon->file_image = get_rimage_icon_from_wm_hints(wwin);
 	}
 
-	if (!icon->file_image) {
+	if (!icon->file_image && !icon->loading) {
 		get_rimage_icon_from_default_icon(icon);
 		icon->file_image = RRetainImage(scr->def_icon_rimage);
 	}
@@ -645,8 +662,8 @@ void update_icon_pixmap(WIcon *icon)
 
 	icon->pixmap = None;
 
-	/* Create the pixmap */
-	if (icon->file_image)
+	/* Create the pixmap, only the tile while the image is being loaded */
+	if (icon->file_image || icon->loading)
 		icon_update_pixmap(icon, icon->file_image);
 
 	/* If dockapp, put inside the icon */
@@ -730,27 +747,145 @@ RImage *get_rimage_icon_from_wm_hints(WWindow *wwin)
 	return image;
 }
 
+/*
+ * Drawing the text is the slow part of painting an icon, and the same
+ * titles are painted again and again when icons are arranged or windows
+ * iconified. The title strips, background and text, of the titles last
+ * painted are kept in pixmaps, so that painting one is a single copy.
+ */
+typedef struct IconTitle {
+	struct IconTitle *prev, *next;	/* the most recently used first */
+	char *text;
+	Pixmap pixmap;
+} IconTitle;
+
+typedef struct WIconTitleCache {
+	WMHashTable *titles;
+	IconTitle *first, *last;
+	int count;
+} WIconTitleCache;
+
+static void unlinkIconTitle(WIconTitleCache *cache, IconTitle *title)
+{
+	if (title->prev)
+		title->prev->next = title->next;
+	else
+		cache->first = title->next;
+
+	if (title->next)
+		title->next->prev = title->prev;
+	else
+		cache->last = title->prev;
+
+	title->prev = title->next = NULL;
+}
+
+static void linkIconTitle(WIconTitleCache *cache, IconTitle *title)
+{
+	title->next = cache->first;
+	if (cache->first)
+		cache->first->prev = title;
+	else
+		cache->last = title;
+	cache->first = title;
+}
+
+static void freeIconTitle(WIconTitleCache *cache, IconTitle *title)
+{
+	WMHashRemove(cache->titles, title->text);
+	unlinkIconTitle(cache, title);
+	cache->count--;
+
+	XFreePixmap(dpy, title->pixmap);
+	wfree(title->text);
+	wfree(title);
+}
+
+/* to be called when the font, color or background of the titles change */
+void wIconTitleCacheFlush(WScreen *scr)
+{
+	WIconTitleCache *cache = scr->icon_title_cache;
+
+	if (!cache)
+		return;
+
+	while (cache->first)
+		freeIconTitle(cache, cache->first);
+}
+
+/* to be called when the screen is torn down */
+void wIconTitleCacheDestroy(WScreen *scr)
+{
+	WIconTitleCache *cache = scr->icon_title_cache;
+
+	if (!cache)
+		return;
+
+	wIconTitleCacheFlush(scr);
+	WMFreeHashTable(cache->titles);
+	wfree(cache);
+	scr->icon_title_cache = NULL;
+}
+
+static Pixmap getIconTitlePixmap(WScreen *scr, const char *text)
+{
+	WIconTitleCache *cache = scr->icon_title_cache;
+	IconTitle *title;
+	int x, l, w, height;
+	char *tmp;
+
+	if (!cache) {
+		cache = wmalloc(sizeof(WIconTitleCache));
+		cache->titles = WMCreateHashTable(WMStringPointerHashCallbacks);
+		scr->icon_title_cache = cache;
+	}
+
+	title = WMHashGet(cache->titles, text);
+	if (title) {
+		unlinkIconTitle(cache, title);
+		linkIconTitle(cache, title);
+		return title->pixmap;
+	}
+
+	if (cache->count >= ICON_TITLE_CACHE_SIZE)
+		freeIconTitle(cache, cache->last);
+
+	height = WMFontHeight(scr->icon_title_font);
+
+	title = wmalloc(sizeof(IconTitle));
+	title->text = wstrdup(text);
+	title->pixmap = XCreatePixmap(dpy, scr->w_win, wPreferences.icon_size, height + 1, scr->w_depth);
+
+	drawIconTitleBackground(scr, title->pixmap, height);
+
+	tmp = ShrinkString(scr->icon_title_font, text, wPreferences.icon_size - 4);
+	w = WMWidthOfString(scr->icon_title_font, tmp, l = strlen(tmp));
+
+	if (w > wPreferences.icon_size - 4)
+		x = (wPreferences.icon_size - 4) - w;
+	else
+		x = (wPreferences.icon_size - w) / 2;
+
+	WMDrawString(scr->wmscreen, title->pixmap, scr->icon_title_color,
+		     scr->icon_title_font, x, 1, tmp, l);
+	wfree(tmp);
+
+	WMHashInsert(cache->titles, title->text, title);
+	linkIconTitle(cache, title);
+	cache->count++;
+
+	return title->pixmap;
+}
+
 /* This function updates in the screen the icon title */
 static void update_icon_title(WIcon *icon)
 {
 	WScreen *scr = icon->vscr->screen_ptr;
-	int x, l, w;
-	char *tmp;
 
 	/* draw the icon title */
-	if (icon->show_title && icon->title != NULL) {
-		tmp = ShrinkString(scr->icon_title_font, icon->title, wPreferences.icon_size - 4);
-		w = WMWidthOfString(scr->icon_title_font, tmp, l = strlen(tmp));
-
-		if (w > wPreferences.icon_size - 4)
-			x = (wPreferences.icon_size - 4) - w;
-		else
-			x = (wPreferences.icon_size - w) / 2;
-
-		WMDrawString(scr->wmscreen, icon->core->window, scr->icon_title_color,
-			     scr->icon_title_font, x, 1, tmp, l);
-		wfree(tmp);
-	}
+	if (icon->show_title && icon->title != NULL)
+		XCopyArea(dpy, getIconTitlePixmap(scr, icon->title), icon->core->window, scr->draw_gc,
+			  0, 0, wPreferences.icon_size, WMFontHeight(scr->icon_title_font) + 1, 0, 0);
 }
 
 
@@ -772,6 +907,25 @@ void wIconPaint(WIcon *icon)
 				       wPreferences.icon_size - 1, wPreferences.icon_size - 1);
 }
 
+/*
+ * The image of the icon is the background of its window, so the server
+ * has already put it back in the exposed area. Only the title and the
+ * selection frame, drawn over it, may have to be painted again.
+ */
+Bool wIconExposeNeedsPaint(WIcon *icon, XEvent *event)
+{
+	WScreen *scr = icon->vscr->screen_ptr;
+
+	if (icon->pixmap == None || icon->selected)
+		return True;
+
+	if (icon->show_title && icon->title != NULL &&
+	    wExposeIntersects(event, 0, 0, wPreferences.icon_size, WMFontHeight(scr->icon_title_font) + 2))
+		return True;
+
+	return False;
+}
+
 /******************************************************************/
 
 void set_icon_image_from_database(WIcon *icon, const char *wm_instance, const char *wm_class, const char *command)
@@ -789,9 +943,34 @@ RImage *get_icon_image(virtual_screen *vscr, const char *winstance, const char *
 	return get_rimage_from_file(vscr, file_name, max_size);
 }
 
+static void icon_image_loaded(RImage *image, void *data)
+{
+	WIcon *icon = (WIcon *) data;
+
+	icon->loading = 0;
+	unset_icon_file_image(icon);
+	icon->file_image = image;
+
+	/* Update the icon, because icon could be NULL */
+	wIconUpdate(icon);
+
+	/* so that the expose handlers paint the icon and the appicon
+	 * specific stuff */
+	XClearArea(dpy, icon->core->window, 0, 0,
+		   wPreferences.icon_size, wPreferences.icon_size, True);
+}
+
 void map_icon_image(WIcon *icon)
 {
-	icon->file_image = get_rimage_from_file(icon->vscr, icon->file_name, wPreferences.icon_size);
+	cancel_icon_loading(icon);
+	unset_icon_file_image(icon);
+
+	/* The icon shows its tile until the image file is decoded */
+	if (icon->file_name) {
+		icon->loading = 1;
+		wIconLoaderRequest(icon->vscr->screen_ptr->rcontext, icon->file_name,
+				   wPreferences.icon_size, icon_image_loaded, icon);
+	}
 
 	/* Update the icon, because icon could be NULL */
 	wIconUpdate(icon);
@@ -803,6 +982,7 @@ void unmap_icon_image(WIcon *icon)
 	if (icon->pixmap != None)
 		XFreePixmap(dpy, icon->pixmap);
 
+	cancel_icon_loading(icon);
 	unset_icon_file_image(icon);
 }
 
@@ -50,6 +50,7 @@ typedef struct WIcon {
 	unsigned int	shadowed:1;	/* If the icon is to be blured */
 	unsigned int 	mapped:1;
 	unsigned int	highlighted:1;
+	unsigned int	loading:1;	/* the image file is being loaded */
 
 	Pixmap		pixmap;
 	Pixmap		mini_preview;
@@ -63,9 +64,12 @@ WIcon *icon_create_core(virtual_screen *vscr);
 void set_icon_image_from_database(WIcon *icon, const char *wm_instance, const char *wm_class, const char *command);
 void wIconDestroy(WIcon *icon);
 void wIconPaint(WIcon *icon);
+Bool wIconExposeNeedsPaint(WIcon *icon, XEvent *event);
 void wIconUpdate(WIcon *icon);
 void wIconSelect(WIcon *icon);
-void wIconChangeTitle(WIcon *icon, WWindow *wwin);
+Bool wIconChangeTitle(WIcon *icon, WWindow *wwin);
+void wIconTitleCacheFlush(WScreen *scr);
+void wIconTitleCacheDestroy(WScreen *scr);
 void update_icon_pixmap(WIcon *icon);
 
 int wIconChangeImageFile(WIcon *icon, const char *file);
@@ -0,0 +1,354 @@
+/* iconloader.c - decode icon image files outside of the event loop
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Decoding a large PNG or JPEG icon takes long enough to be noticed when
+ * many icons are shown at once, at startup or when the dock is loaded.
+ * The files are decoded by a few worker threads instead, and the icon
+ * shows its tile until the image is ready.
+ *
+ * The workers only run the decoders which do not talk to the X server.
+ * XPM files need the display to parse the colors, and the formats which
+ * wrlib does not recognize may be handled by ImageMagick, so these are
+ * handed back to the main thread and decoded there.
+ *
+ * A finished job is announced by writing its address on a pipe which is
+ * watched by the event loop, so the callbacks are always called from the
+ * main thread. Requests for a file which is already being loaded share the
+ * same job.
+ */
+
+#include "wconfig.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <WINGs/WUtil.h>
+#include <wraster.h>
+
+#include "WindowMaker.h"
+#include "icon.h"
+#include "iconloader.h"
+
+#ifdef HAVE_PTHREAD
+
+typedef struct LoadWaiter {
+	WIconLoaderCallback *callback;
+	void *client_data;
+} LoadWaiter;
+
+typedef struct LoadJob {
+	struct LoadJob *next;		/* in the queue of the workers */
+
+	char *path;
+	int max_size;
+	RContext *context;
+
+	/* set by the worker */
+	Bool started;
+	Bool main_thread;		/* must be decoded by the main thread */
+	RImage *image;
+	int error;
+
+	WMArray *waiters;		/* only used by the main thread */
+} LoadJob;
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	LoadJob *queue_head, *queue_tail;
+
+	Bool initialized;
+	int threads;			/* number of workers running */
+	int pipe[2];
+
+	WMArray *jobs;			/* the jobs not yet completed, main thread only */
+} loader = {
+	PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_COND_INITIALIZER,
+	NULL, NULL,
+	False, 0, { -1, -1 },
+	NULL
+};
+
+
+static void freeJob(LoadJob *job)
+{
+	if (job->image)
+		RReleaseImage(job->image);
+	WMFreeArray(job->waiters);
+	wfree(job->path);
+	wfree(job);
+}
+
+static void *loaderThread(void *data)
+{
+	LoadJob *job;
+	char *format;
+
+	/* Parameter not used, but tell the compiler that it is ok */
+	(void) data;
+
+	for (;;) {
+		pthread_mutex_lock(&loader.lock);
+		while (!loader.queue_head)
+			pthread_cond_wait(&loader.cond, &loader.lock);
+
+		job = loader.queue_head;
+		loader.queue_head = job->next;
+		if (!loader.queue_head)
+			loader.queue_tail = NULL;
+		job->next = NULL;
+		job->started = True;
+		pthread_mutex_unlock(&loader.lock);
+
+		format = RGetImageFileFormat(job->path);
+		if (!format || strcmp(format, "XPM") == 0) {
+			job->main_thread = True;
+		} else {
+			job->image = RLoadImage(job->context, job->path, 0);
+			if (job->image)
+				job->image = wIconValidateIconSize(job->image, job->max_size);
+			else
+				job->error = RErrorCode;
+		}
+
+		while (write(loader.pipe[1], &job, sizeof(job)) < 0 && errno == EINTR)
+			;
+	}
+
+	return NULL;
+}
+
+static void completeJob(LoadJob *job)
+{
+	LoadWaiter *waiter;
+
+	if (job->main_thread) {
+		job->image = RLoadImage(job->context, job->path, 0);
+		if (job->image)
+			job->image = wIconValidateIconSize(job->image, job->max_size);
+		else
+			job->error = RErrorCode;
+	}
+
+	if (!job->image && WMGetArrayItemCount(job->waiters) > 0)
+		wwarning(_("error loading image file \"%s\": %s"), job->path,
+			 RMessageForError(job->error));
+
+	/*
+	 * The job stays in the list while the callbacks run, so that
+	 * a cancellation made by one of them is seen by the loop
+	 */
+	while ((waiter = WMPopFromArray(job->waiters)) != NULL) {
+		waiter->callback(job->image ? RRetainImage(job->image) : NULL, waiter->client_data);
+		wfree(waiter);
+	}
+
+	WMRemoveFromArray(loader.jobs, job);
+	freeJob(job);
+}
+
+static void readCompletedJobs(int fd, int mask, void *data)
+{
+	LoadJob *job;
+	ssize_t count;
+
+	/* Parameters not used, but tell the compiler that it is ok */
+	(void) mask;
+	(void) data;
+
+	for (;;) {
+		count = read(fd, &job, sizeof(job));
+		if (count == sizeof(job)) {
+			completeJob(job);
+			continue;
+		}
+
+		if (count < 0 && errno == EINTR)
+			continue;
+
+		if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return;
+
+		if (count != 0)
+			werror(_("error reading the results of the icon loader: %s"), strerror(errno));
+		return;
+	}
+}
+
+static void startLoader(void)
+{
+	sigset_t all, old;
+	pthread_t thread;
+	int i;
+
+	loader.initialized = True;
+
+	if (pipe(loader.pipe) < 0) {
+		werror(_("could not create the pipe of the icon loader: %s"), strerror(errno));
+		return;
+	}
+	fcntl(loader.pipe[0], F_SETFD, FD_CLOEXEC);
+	fcntl(loader.pipe[1], F_SETFD, FD_CLOEXEC);
+	fcntl(loader.pipe[0], F_SETFL, O_NONBLOCK);
+
+	/* the signals are handled by the main thread */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	for (i = 0; i < ICON_LOADER_THREADS; i++) {
+		if (pthread_create(&thread, NULL, loaderThread, NULL) != 0)
+			break;
+		pthread_detach(thread);
+		loader.threads++;
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (loader.threads == 0) {
+		wwarning(_("could not start the icon loader threads, icons will be loaded synchronously"));
+		close(loader.pipe[0]);
+		close(loader.pipe[1]);
+		return;
+	}
+
+	loader.jobs = WMCreateArray(16);
+	WMAddInputHandler(loader.pipe[0], WIReadMask, readCompletedJobs, NULL);
+}
+
+#endif /* HAVE_PTHREAD */
+
+void wIconLoaderRequest(RContext *context, const char *path, int max_size,
+			WIconLoaderCallback *callback, void *client_data)
+{
+	RImage *image;
+
+#ifdef HAVE_PTHREAD
+	LoadWaiter *waiter;
+	LoadJob *job = NULL;
+	int i;
+
+	if (!loader.initialized)
+		startLoader();
+
+	if (loader.threads > 0) {
+		for (i = 0; i < WMGetArrayItemCount(loader.jobs); i++) {
+			LoadJob *tmp = WMGetFromArray(loader.jobs, i);
+
+			if (tmp->context == context && tmp->max_size == max_size &&
+			    strcmp(tmp->path, path) == 0) {
+				job = tmp;
+				break;
+			}
+		}
+
+		if (!job) {
+			job = wmalloc(sizeof(LoadJob));
+			job->path = wstrdup(path);
+			job->max_size = max_size;
+			job->context = context;
+			job->waiters = WMCreateArray(1);
+			WMAddToArray(loader.jobs, job);
+
+			pthread_mutex_lock(&loader.lock);
+			if (loader.queue_tail)
+				loader.queue_tail->next = job;
+			else
+				loader.queue_head = job;
+			loader.queue_tail = job;
+			pthread_cond_signal(&loader.cond);
+			pthread_mutex_unlock(&loader.lock);
+		}
+
+		waiter = wmalloc(sizeof(LoadWaiter));
+		waiter->callback = callback;
+		waiter->client_data = client_data;
+		WMAddToArray(job->waiters, waiter);
+		return;
+	}
+#endif
+
+	image = RLoadImage(context, path, 0);
+	if (!image)
+		wwarning(_("error loading image file \"%s\": %s"), path,
+			 RMessageForError(RErrorCode));
+
+	(*callback) (wIconValidateIconSize(image, max_size), client_data);
+}
+
+void wIconLoaderCancel(void *client_data)
+{
+#ifdef HAVE_PTHREAD
+	LoadJob *job, *last, **prev;
+	LoadWaiter *waiter;
+	Bool removed;
+	int i, j;
+
+	if (!loader.jobs)
+		return;
+
+	for (i = WMGetArrayItemCount(loader.jobs) - 1; i >= 0; i--) {
+		job = WMGetFromArray(loader.jobs, i);
+
+		for (j = WMGetArrayItemCount(job->waiters) - 1; j >= 0; j--) {
+			waiter = WMGetFromArray(job->waiters, j);
+			if (waiter->client_data == client_data) {
+				WMDeleteFromArray(job->waiters, j);
+				wfree(waiter);
+			}
+		}
+
+		if (WMGetArrayItemCount(job->waiters) > 0)
+			continue;
+
+		/* nobody wants the image anymore, drop the job if no worker has it */
+		removed = False;
+		pthread_mutex_lock(&loader.lock);
+		if (!job->started) {
+			last = NULL;
+			for (prev = &loader.queue_head; *prev && *prev != job; prev = &(*prev)->next)
+				last = *prev;
+
+			if (*prev) {
+				*prev = job->next;
+				if (loader.queue_tail == job)
+					loader.queue_tail = last;
+				removed = True;
+			}
+		}
+		pthread_mutex_unlock(&loader.lock);
+
+		if (removed) {
+			WMDeleteFromArray(loader.jobs, i);
+			freeJob(job);
+		}
+	}
+#else
+	/* Parameter not used, but tell the compiler that it is ok */
+	(void) client_data;
+#endif
+}
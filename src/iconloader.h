@@ -0,0 +1,37 @@
+/*
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef WMICONLOADER_H_
+#define WMICONLOADER_H_
+
+#include <wraster.h>
+
+/*
+ * Called from the event loop once the image is decoded. The image belongs
+ * to the callback, it is NULL if the file could not be loaded.
+ */
+typedef void WIconLoaderCallback(RImage *image, void *client_data);
+
+void wIconLoaderRequest(RContext *context, const char *path, int max_size,
+			WIconLoaderCallback *callback, void *client_data);
+
+void wIconLoaderCancel(void *client_data);
+
+#endif /* WMICONLOADER_H_ */
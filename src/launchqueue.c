@@ -0,0 +1,379 @@
+/* launchqueue.c - start the restored applications a few at a time
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * The applications of the saved session and the autolaunched ones of the
+ * docks used to be started all at once, which loads the machine and makes
+ * us handle their windows while still restoring. They are queued instead,
+ * and only MaxConcurrentLaunches of them are starting at any time.
+ *
+ * An application has finished starting when one of its windows is mapped,
+ * when its process exits (it may have forked) or after LAUNCH_READY_TIMEOUT.
+ * The applications of the current workspace and the ones which appear on
+ * all workspaces are started first.
+ */
+
+#include "wconfig.h"
+
+#include <sys/time.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <WINGs/WUtil.h>
+
+#include "WindowMaker.h"
+#include "window.h"
+#include "appicon.h"
+#include "dock-core.h"
+#include "event.h"
+#include "shell.h"
+#include "wmspec.h"
+#include "launchqueue.h"
+
+typedef struct LaunchEntry {
+	virtual_screen *vscr;
+	WAppIcon *btn;			/* NULL for the applications not docked */
+	char *instance;
+	char *class;
+	char *command;
+	WSavedState *state;
+
+	pid_t pid;
+	WMHandlerID timer;
+} LaunchEntry;
+
+static struct {
+	WMArray *queue;			/* not started yet */
+	WMArray *running;		/* started, no window seen yet */
+	int hold;
+	WMHandlerID idle;
+
+	/* timing of the last restore */
+	struct timeval start, released, started, ready;
+	int launched;
+	int timed_out;
+} launcher;
+
+
+#ifdef DEBUG_LAUNCHQUEUE
+static int elapsedTime(const struct timeval *from, const struct timeval *to)
+{
+	return (to->tv_sec - from->tv_sec) * 1000 + (to->tv_usec - from->tv_usec) / 1000;
+}
+#endif
+
+static void freeEntry(LaunchEntry *entry)
+{
+	if (entry->timer)
+		WMDeleteTimerHandler(entry->timer);
+	if (entry->state)
+		wfree(entry->state);
+	if (entry->instance)
+		wfree(entry->instance);
+	if (entry->class)
+		wfree(entry->class);
+	if (entry->command)
+		wfree(entry->command);
+	wfree(entry);
+}
+
+static void launchNext(void *data);
+
+static void scheduleLaunch(void)
+{
+	if (!launcher.idle && !launcher.hold)
+		launcher.idle = WMAddIdleHandler(launchNext, NULL);
+}
+
+static void launchReady(LaunchEntry *entry)
+{
+	WMRemoveFromArray(launcher.running, entry);
+	freeEntry(entry);
+
+	if (WMGetArrayItemCount(launcher.queue) > 0)
+		scheduleLaunch();
+	else if (WMGetArrayItemCount(launcher.running) == 0 && launcher.launched > 0) {
+		gettimeofday(&launcher.ready, NULL);
+#ifdef DEBUG_LAUNCHQUEUE
+		wmessage("restored %i applications: queued in %i ms, started in %i ms, ready in %i ms, %i timed out",
+			 launcher.launched, elapsedTime(&launcher.start, &launcher.released),
+			 elapsedTime(&launcher.released, &launcher.started),
+			 elapsedTime(&launcher.released, &launcher.ready), launcher.timed_out);
+#endif
+		launcher.launched = 0;
+		launcher.timed_out = 0;
+	}
+}
+
+static void launchTimeout(void *data)
+{
+	LaunchEntry *entry = data;
+
+	entry->timer = NULL;
+	launcher.timed_out++;
+	launchReady(entry);
+}
+
+static void launchReadyForPid(pid_t pid)
+{
+	LaunchEntry *entry;
+	int i;
+
+	for (i = 0; i < WMGetArrayItemCount(launcher.running); i++) {
+		entry = WMGetFromArray(launcher.running, i);
+		if (entry->pid == pid) {
+			launchReady(entry);
+			return;
+		}
+	}
+}
+
+static void launchedProcessDied(pid_t pid, unsigned int status, void *data)
+{
+	/* Parameters not used, but tell the compiler that it is ok */
+	(void) status;
+	(void) data;
+
+	launchReadyForPid(pid);
+}
+
+static pid_t execCommand(virtual_screen *vscr, char *command)
+{
+	pid_t pid;
+	char **argv;
+	int argc;
+
+	wtokensplit(command, &argv, &argc);
+
+	if (!argc)
+		return 0;
+
+	pid = execute_command2(vscr, argv, argc);
+	wtokenfree(argv, argc);
+
+	return pid;
+}
+
+static void startEntry(LaunchEntry *entry)
+{
+	WAppIcon *btn = entry->btn;
+	Bool idle;
+
+	if (btn) {
+		/* the state is freed if the icon is already running */
+		idle = !btn->running && !btn->launching;
+		wDockLaunchWithState(btn, entry->state);
+		entry->pid = idle ? btn->pid : 0;
+	} else {
+		entry->pid = execCommand(entry->vscr, entry->command);
+		if (entry->pid > 0)
+			wWindowAddSavedState(entry->instance, entry->class, entry->command,
+					     entry->pid, entry->state);
+		else
+			wfree(entry->state);
+	}
+	entry->state = NULL;
+
+	if (entry->pid <= 0) {
+		freeEntry(entry);
+		return;
+	}
+
+	launcher.launched++;
+	WMAddToArray(launcher.running, entry);
+	entry->timer = WMAddTimerHandler(LAUNCH_READY_TIMEOUT, launchTimeout, entry);
+	wAddDeathHandler(entry->pid, launchedProcessDied, NULL);
+}
+
+static Bool isForCurrentWorkspace(LaunchEntry *entry)
+{
+	WAppIcon *btn = entry->btn;
+
+	if (btn && (btn->dock->type != WM_CLIP || btn->omnipresent))
+		return True;
+
+	return (!entry->state || entry->state->workspace < 0 ||
+		entry->state->workspace == entry->vscr->workspace.current);
+}
+
+static void launchNext(void *data)
+{
+	LaunchEntry *entry;
+	int i, count;
+
+	/* Parameter not used, but tell the compiler that it is ok */
+	(void) data;
+
+	launcher.idle = NULL;
+
+	while ((count = WMGetArrayItemCount(launcher.queue)) > 0) {
+		if (wPreferences.max_concurrent_launches > 0 &&
+		    WMGetArrayItemCount(launcher.running) >= wPreferences.max_concurrent_launches)
+			break;
+
+		/* looked for each time, the user may have changed workspace */
+		for (i = 0; i < count; i++) {
+			if (isForCurrentWorkspace(WMGetFromArray(launcher.queue, i)))
+				break;
+		}
+		if (i == count)
+			i = 0;
+
+		entry = WMGetFromArray(launcher.queue, i);
+		WMDeleteFromArray(launcher.queue, i);
+		startEntry(entry);
+	}
+
+	if (WMGetArrayItemCount(launcher.queue) == 0)
+		gettimeofday(&launcher.started, NULL);
+}
+
+static void queueEntry(LaunchEntry *entry)
+{
+	if (!launcher.queue) {
+		launcher.queue = WMCreateArray(16);
+		launcher.running = WMCreateArray(16);
+	}
+
+	/* not part of a restore, time it on its own */
+	if (!launcher.hold && launcher.launched == 0 && WMGetArrayItemCount(launcher.queue) == 0) {
+		gettimeofday(&launcher.start, NULL);
+		launcher.released = launcher.start;
+	}
+
+	WMAddToArray(launcher.queue, entry);
+	scheduleLaunch();
+}
+
+void wLaunchQueueHold(void)
+{
+	if (launcher.hold++ == 0)
+		gettimeofday(&launcher.start, NULL);
+}
+
+void wLaunchQueueRelease(void)
+{
+	if (launcher.hold == 0 || --launcher.hold > 0)
+		return;
+
+	gettimeofday(&launcher.released, NULL);
+	if (launcher.queue && WMGetArrayItemCount(launcher.queue) > 0)
+		scheduleLaunch();
+}
+
+void wLaunchQueueCommand(virtual_screen *vscr, const char *instance, const char *class,
+			 const char *command, WSavedState *state)
+{
+	LaunchEntry *entry;
+
+	entry = wmalloc(sizeof(LaunchEntry));
+	entry->vscr = vscr;
+	entry->instance = instance ? wstrdup(instance) : NULL;
+	entry->class = class ? wstrdup(class) : NULL;
+	entry->command = wstrdup(command);
+	entry->state = state;
+
+	queueEntry(entry);
+}
+
+void wLaunchQueueDockIcon(WAppIcon *btn, WSavedState *state)
+{
+	LaunchEntry *entry;
+
+	entry = wmalloc(sizeof(LaunchEntry));
+	entry->vscr = btn->icon->vscr;
+	entry->btn = btn;
+	entry->instance = btn->wm_instance ? wstrdup(btn->wm_instance) : NULL;
+	entry->class = btn->wm_class ? wstrdup(btn->wm_class) : NULL;
+	entry->state = state;
+
+	queueEntry(entry);
+}
+
+Bool wLaunchQueueHasIcon(WAppIcon *btn)
+{
+	LaunchEntry *entry;
+	int i;
+
+	if (!launcher.queue)
+		return False;
+
+	for (i = 0; i < WMGetArrayItemCount(launcher.queue); i++) {
+		entry = WMGetFromArray(launcher.queue, i);
+		if (entry->btn == btn)
+			return True;
+	}
+
+	return False;
+}
+
+void wLaunchQueueRemoveIcon(WAppIcon *btn)
+{
+	LaunchEntry *entry;
+	int i;
+
+	if (!launcher.queue)
+		return;
+
+	for (i = WMGetArrayItemCount(launcher.queue) - 1; i >= 0; i--) {
+		entry = WMGetFromArray(launcher.queue, i);
+		if (entry->btn == btn) {
+			WMDeleteFromArray(launcher.queue, i);
+			freeEntry(entry);
+		}
+	}
+
+	/* the started ones are still waited for */
+	for (i = 0; i < WMGetArrayItemCount(launcher.running); i++) {
+		entry = WMGetFromArray(launcher.running, i);
+		if (entry->btn == btn)
+			entry->btn = NULL;
+	}
+}
+
+void wLaunchQueueWindowMapped(WWindow *wwin)
+{
+	LaunchEntry *entry;
+	pid_t pid;
+	int i;
+
+	if (!launcher.running || WMGetArrayItemCount(launcher.running) == 0)
+		return;
+
+	for (i = 0; i < WMGetArrayItemCount(launcher.running); i++) {
+		entry = WMGetFromArray(launcher.running, i);
+		if (!entry->instance && !entry->class)
+			continue;
+
+		if (entry->instance && (!wwin->wm_instance || strcmp(entry->instance, wwin->wm_instance) != 0))
+			continue;
+
+		if (entry->class && (!wwin->wm_class || strcmp(entry->class, wwin->wm_class) != 0))
+			continue;
+
+		launchReady(entry);
+		return;
+	}
+
+	pid = wNETWMGetPidForWindow(wwin->client_win);
+	if (pid > 0)
+		launchReadyForPid(pid);
+}
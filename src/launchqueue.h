@@ -0,0 +1,44 @@
+/*
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef WMLAUNCHQUEUE_H_
+#define WMLAUNCHQUEUE_H_
+
+#include "window.h"
+#include "appicon.h"
+
+/* keep the queued applications until wLaunchQueueRelease() */
+void wLaunchQueueHold(void);
+void wLaunchQueueRelease(void);
+
+/* the state belongs to the queue */
+void wLaunchQueueCommand(virtual_screen *vscr, const char *instance, const char *class,
+			 const char *command, WSavedState *state);
+void wLaunchQueueDockIcon(WAppIcon *btn, WSavedState *state);
+
+/* tells if the icon is waiting to be started */
+Bool wLaunchQueueHasIcon(WAppIcon *btn);
+
+/* forget the queued launches of an icon being destroyed */
+void wLaunchQueueRemoveIcon(WAppIcon *btn);
+
+void wLaunchQueueWindowMapped(WWindow *wwin);
+
+#endif /* WMLAUNCHQUEUE_H_ */
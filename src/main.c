@@ -57,6 +57,7 @@
 #include "main.h"
 #include "monitor.h"
 #include "shell.h"
+#include "statefile.h"
 
 #include <WINGs/WUtil.h>
 
@@ -194,6 +195,8 @@ static int initWVisualID(const char *user_str)
 
 noreturn void Exit(int status)
 {
+	wStateFileFlush();
+
 	if (dpy)
 		XCloseDisplay(dpy);
 
@@ -217,6 +220,8 @@ void Restart(char *manager, Bool abortOnFailure)
 				break;
 		}
 	}
+	wStateFileFlush();
+
 	if (dpy) {
 		XCloseDisplay(dpy);
 		dpy = NULL;
@@ -116,6 +116,8 @@ static void menuTitleMouseDown(WCoreWindow * sender, void *data, XEvent * event)
 static void menuTitleMouseDown(WCoreWindow *sender, void *data, XEvent *event);
 static void move_menus(WMenu *menu, int x, int y);
 static void paintEntry(WMenu *menu, int index, int selected);
+static void destroyEntryPixmaps(WMenu *menu);
+static Bool drawEntry(WMenu *menu, int index, int selected);
 static void raiseMenus(WMenu *menu, int submenus);
 static void restore_rootmenu_map(virtual_screen *vscr);
 static void restore_rootmenu(virtual_screen *vscr, WMPropList *menus);
@@ -158,6 +160,8 @@ static void appearanceObserver(void *self, WMNotification *notif)
 
 	if (WMGetNotificationName(notif) == WNMenuAppearanceSettingsChanged) {
 		if (flags & WFontSettings) {
+			/* the state of the entries does not include the font */
+			destroyEntryPixmaps(menu);
 			menu->flags.realized = 0;
 			wMenuRealize(menu);
 		}
@@ -165,8 +169,10 @@ static void appearanceObserver(void *self, WMNotification *notif)
 		if (flags & WTextureSettings)
 			updateTexture(menu);
 
-		if (flags & (WTextureSettings | WColorSettings))
+		if (flags & (WTextureSettings | WColorSettings)) {
+			destroyEntryPixmaps(menu);
 			wMenuPaint(menu);
+		}
 
 	} else if (menu->flags.titled) {
 		if (flags & WFontSettings) {
@@ -258,6 +264,7 @@ WMenu *menu_create(virtual_screen *vscr, const char *title)
 void menu_unmap(WMenu *menu)
 {
 	destroy_pixmap(menu->menu_texture_data);
+	destroyEntryPixmaps(menu);
 
 	XDeleteContext(dpy, menu->core->window, w_global.context.client_win);
 	XDestroyWindow(dpy, menu->core->window);
@@ -329,6 +336,8 @@ void menu_map(WMenu *menu)
 	menu->core->descriptor.handle_mousedown = menuMouseDown;
 
 	menu->menu_texture_data = None;
+	menu->entry_pixmap[0] = None;
+	menu->entry_pixmap[1] = None;
 
 	XMapWindow(dpy, menu->core->window);
 
@@ -509,6 +518,9 @@ static void updateTexture(WMenu *menu)
 {
 	WScreen *scr = menu->vscr->screen_ptr;
 
+	/* the entries must be drawn again over the new background */
+	destroyEntryPixmaps(menu);
+
 	/* setup background texture */
 	if (scr->menu_item_texture->any.type != WTEX_SOLID) {
 		destroy_pixmap(menu->menu_texture_data);
@@ -708,28 +720,90 @@ static void drawFrame(WMenu *menu, Drawable win, int y, int w, int h, int type)
 		XDrawLine(dpy, win, vscr->screen_ptr->menu_item_auxtexture->dark_gc, 0, y + h - 1, w - 1, y + h - 1);
 }
 
-static void paintEntry(WMenu *menu, int index, int selected)
+static void destroyEntryPixmaps(WMenu *menu)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		if (menu->entry_pixmap[i] != None) {
+			XFreePixmap(dpy, menu->entry_pixmap[i]);
+			menu->entry_pixmap[i] = None;
+		}
+
+		if (menu->entry_drawn[i]) {
+			wfree(menu->entry_drawn[i]);
+			menu->entry_drawn[i] = NULL;
+		}
+	}
+}
+
+/*
+ * What an entry looks like, to know whether what was drawn of it before can
+ * still be used. The strings are hashed as they may be replaced by others
+ * which happen to be allocated at the same place.
+ */
+static unsigned int entryState(WMenu *menu, int index, int type)
+{
+	WMenuEntry *entry = menu->entries[index];
+	unsigned int state = 5381;
+	const char *c;
+
+	for (c = entry->text; c && *c; c++)
+		state = state * 33 + (unsigned char)*c;
+
+	state = state * 33 + 1;
+	for (c = entry->rtext; c && *c; c++)
+		state = state * 33 + (unsigned char)*c;
+
+	state = state * 33 + entry->flags.enabled;
+	state = state * 33 + entry->flags.indicator;
+	state = state * 33 + entry->flags.indicator_on;
+	state = state * 33 + entry->flags.indicator_type;
+	state = state * 33 + (entry->cascade >= 0);
+	state = state * 33 + type;
+
+	/* 0 is for the entries not drawn yet */
+	return state ? state : 1;
+}
+
+/*
+ * Draw an entry off screen, in the pixmap holding the normal or the selected
+ * entries, unless it is already there. Returns False if there is nothing to
+ * draw on.
+ */
+static Bool drawEntry(WMenu *menu, int index, int selected)
 {
 	virtual_screen *vscr = menu->vscr;
 	WScreen *scr = vscr->screen_ptr;
-	Window win = menu->core->window;
 	WMenuEntry *entry = menu->entries[index];
+	Pixmap pixmap;
 	GC light, dim, dark;
 	WMColor *color;
 	int x, y, w, h, tw, iw, ih;
 	int type = F_NORMAL;
+	unsigned int state;
 	WPixmap *indicator;
 
-	if (!menu->flags.realized)
-		return;
-
 	h = menu->entry_height;
 	w = menu->width;
 	y = index * h;
 
-	light = scr->menu_item_auxtexture->light_gc;
-	dim = scr->menu_item_auxtexture->dim_gc;
-	dark = scr->menu_item_auxtexture->dark_gc;
+	/* the menu changed size since the pixmaps were made */
+	if (menu->pixmap_width != w || menu->pixmap_entry_height != h || menu->pixmap_rows < menu->entry_no)
+		destroyEntryPixmaps(menu);
+
+	if (menu->entry_pixmap[selected] == None) {
+		if (w <= 0 || h <= 0 || menu->entry_no <= 0)
+			return False;
+
+		menu->entry_pixmap[selected] = XCreatePixmap(dpy, menu->core->window, w, h * menu->entry_no,
+							     scr->w_depth);
+		menu->entry_drawn[selected] = wmalloc(menu->entry_no * sizeof(unsigned int));
+		menu->pixmap_width = w;
+		menu->pixmap_rows = menu->entry_no;
+		menu->pixmap_entry_height = h;
+	}
+	pixmap = menu->entry_pixmap[selected];
 
 	if (wPreferences.menu_style == MS_FLAT && menu->entry_no > 1) {
 		if (index == 0)
@@ -740,19 +814,31 @@ static void paintEntry(WMenu *menu, int index, int selected)
 			type = F_NONE;
 	}
 
-	/* paint background */
+	state = entryState(menu, index, type);
+	if (menu->entry_drawn[selected][index] == state)
+		return True;
+	menu->entry_drawn[selected][index] = state;
+
+	light = scr->menu_item_auxtexture->light_gc;
+	dim = scr->menu_item_auxtexture->dim_gc;
+	dark = scr->menu_item_auxtexture->dark_gc;
+
+	/* paint background, as the window background would show it */
+	if (scr->menu_item_texture->any.type != WTEX_SOLID && menu->menu_texture_data != None) {
+		XCopyArea(dpy, menu->menu_texture_data, pixmap, scr->draw_gc,
+			  0, (wPreferences.menu_style == MS_NORMAL) ? 0 : y, w, h, 0, y);
+	} else {
+		XSetForeground(dpy, scr->draw_gc, scr->menu_item_texture->any.color.pixel);
+		XFillRectangle(dpy, pixmap, scr->draw_gc, 0, y, w, h);
+	}
+
+	if (scr->menu_item_texture->any.type == WTEX_SOLID)
+		drawFrame(menu, pixmap, y, w, h, type);
+
 	if (selected) {
-		XFillRectangle(dpy, win, WMColorGC(scr->select_color), 1, y + 1, w - 2, h - 3);
+		XFillRectangle(dpy, pixmap, WMColorGC(scr->select_color), 1, y + 1, w - 2, h - 3);
 		if (scr->menu_item_texture->any.type == WTEX_SOLID)
-			drawFrame(menu, win, y, w, h, type);
-	} else {
-		if (scr->menu_item_texture->any.type == WTEX_SOLID) {
-			XClearArea(dpy, win, 0, y + 1, w - 1, h - 3, False);
-			/* draw the frame */
-			drawFrame(menu, win, y, w, h, type);
-		} else {
-			XClearArea(dpy, win, 0, y, w, h, False);
-		}
+			drawFrame(menu, pixmap, y, w, h, type);
 	}
 
 	if (selected) {
@@ -771,14 +857,14 @@ static void paintEntry(WMenu *menu, int index, int selected)
 	if (entry->flags.indicator)
 		x += MENU_INDICATOR_SPACE + 2;
 
-	WMDrawString(scr->wmscreen, win, color, scr->menu_entry_font,
+	WMDrawString(scr->wmscreen, pixmap, color, scr->menu_entry_font,
 		     x, 3 + y + wPreferences.menu_text_clearance, entry->text, strlen(entry->text));
 
 	if (entry->cascade >= 0) {
 		/* draw the cascade indicator */
-		XDrawLine(dpy, win, dim, w - 11, y + 6, w - 6, y + h / 2 - 1);
-		XDrawLine(dpy, win, light, w - 11, y + h - 8, w - 6, y + h / 2 - 1);
-		XDrawLine(dpy, win, dark, w - 12, y + 6, w - 12, y + h - 8);
+		XDrawLine(dpy, pixmap, dim, w - 11, y + 6, w - 6, y + h / 2 - 1);
+		XDrawLine(dpy, pixmap, light, w - 11, y + h - 8, w - 6, y + h / 2 - 1);
+		XDrawLine(dpy, pixmap, dark, w - 12, y + 6, w - 12, y + h - 8);
 	}
 
 	/* draw indicator */
@@ -818,16 +904,39 @@ static void paintEntry(WMenu *menu, int index, int selected)
 				XSetForeground(dpy, scr->copy_gc, WMColorPixel(scr->dtext_color));
 		}
 
-		XFillRectangle(dpy, win, scr->copy_gc, 5, y + (h - ih) / 2, iw, ih);
+		XFillRectangle(dpy, pixmap, scr->copy_gc, 5, y + (h - ih) / 2, iw, ih);
 		XSetClipOrigin(dpy, scr->copy_gc, 0, 0);
 	}
 
 	/* draw right text */
 	if (entry->rtext && entry->cascade < 0) {
 		tw = WMWidthOfString(scr->menu_entry_font, entry->rtext, strlen(entry->rtext));
-		WMDrawString(scr->wmscreen, win, color, scr->menu_entry_font, w - 6 - tw,
+		WMDrawString(scr->wmscreen, pixmap, color, scr->menu_entry_font, w - 6 - tw,
 			     y + 3 + wPreferences.menu_text_clearance, entry->rtext, strlen(entry->rtext));
 	}
+
+	return True;
+}
+
+/*
+ * Entries are drawn once off screen in their normal and selected look, so
+ * moving the selection only copies the two entries concerned.
+ */
+static void paintEntry(WMenu *menu, int index, int selected)
+{
+	int y, h;
+
+	if (!menu->flags.realized)
+		return;
+
+	selected = selected ? 1 : 0;
+	if (!drawEntry(menu, index, selected))
+		return;
+
+	h = menu->entry_height;
+	y = index * h;
+	XCopyArea(dpy, menu->entry_pixmap[selected], menu->core->window, menu->vscr->screen_ptr->draw_gc,
+		  0, y, menu->width, h, 0, y);
 }
 
 static void move_menus(WMenu *menu, int x, int y)
@@ -1136,16 +1245,48 @@ void wMenuUnmap(WMenu *menu)
 	menu->selected_entry = -1;
 }
 
-void wMenuPaint(WMenu *menu)
+/* paint the entries in the given part of the menu window */
+static void paintMenuArea(WMenu *menu, int x, int y, int width, int height)
 {
-	int i;
+	int i, first, last, h = menu->entry_height;
+
+	if (!menu->flags.mapped || !menu->flags.realized || menu->entry_no <= 0)
+		return;
 
-	if (!menu->flags.mapped)
+	if (x < 0) {
+		width += x;
+		x = 0;
+	}
+	if (x + width > menu->width)
+		width = menu->width - x;
+	if (y < 0) {
+		height += y;
+		y = 0;
+	}
+	if (y + height > menu->entry_no * h)
+		height = menu->entry_no * h - y;
+	if (height <= 0 || width <= 0)
 		return;
 
-	/* paint entries */
-	for (i = 0; i < menu->entry_no; i++)
-		paintEntry(menu, i, i == menu->selected_entry);
+	first = y / h;
+	last = (y + height - 1) / h;
+
+	/* bring the entries up to date, then show them all at once */
+	for (i = first; i <= last; i++) {
+		if (!drawEntry(menu, i, 0))
+			return;
+	}
+
+	XCopyArea(dpy, menu->entry_pixmap[0], menu->core->window, menu->vscr->screen_ptr->draw_gc,
+		  x, y, width, height, x, y);
+
+	if (menu->selected_entry >= first && menu->selected_entry <= last)
+		paintEntry(menu, menu->selected_entry, True);
+}
+
+void wMenuPaint(WMenu *menu)
+{
+	paintMenuArea(menu, 0, 0, menu->width, menu->entry_no * menu->entry_height);
 }
 
 void menu_entry_set_enabled(WMenu *menu, int index, int enable)
@@ -1649,10 +1790,8 @@ void wMenuScroll(WMenu *menu)
 
 static void menuExpose(WObjDescriptor *desc, XEvent *event)
 {
-	/* Parameter not used, but tell the compiler that it is ok */
-	(void) event;
-
-	wMenuPaint(desc->parent);
+	paintMenuArea(desc->parent, event->xexpose.x, event->xexpose.y,
+		      event->xexpose.width, event->xexpose.height);
 }
 
 static void delaySelection(void *data)
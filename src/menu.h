@@ -63,6 +63,13 @@ typedef struct WMenu {
 	WCoreWindow *core;			/* the window menu */
 	Pixmap menu_texture_data;
 
+	/* all the entries drawn off screen, normal [0] and selected [1] */
+	Pixmap entry_pixmap[2];
+	unsigned int *entry_drawn[2];		/* state of the entries when drawn */
+	int pixmap_width;
+	int pixmap_rows;
+	int pixmap_entry_height;
+
 	WMenuEntry **entries;			/* array of entries */
 	short alloced_entries;			/* number of entries allocated in
 						 * entry array */
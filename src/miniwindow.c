@@ -39,6 +39,7 @@
 #include "winmenu.h"
 #include "placement.h"
 #include "xinerama.h"
+#include "thumbnail.h"
 
 static void miniwindow_create_minipreview_showerror(WWindow *wwin);
 static void miniwindow_DblClick(WObjDescriptor *desc, XEvent *event);
@@ -83,7 +84,7 @@ static void miniwindow_create_minipreview(WWindow *wwin)
 	Pixmap pixmap;
 	int ret;
 
-	ret = create_minipixmap_for_wwindow(wwin->vscr, wwin, &pixmap);
+	ret = wThumbnailGetPixmap(wwin, &pixmap);
 	if (ret) {
 		miniwindow_create_minipreview_showerror(wwin);
 		return;
@@ -166,8 +167,8 @@ void miniwindow_updatetitle(WWindow *wwin)
 	if (!wwin->miniwindow->icon)
 		return;
 
-	wIconChangeTitle(wwin->miniwindow->icon, wwin);
-	wIconPaint(wwin->miniwindow->icon);
+	if (wIconChangeTitle(wwin->miniwindow->icon, wwin))
+		wIconPaint(wwin->miniwindow->icon);
 }
 
 void miniwindow_map(WWindow *wwin)
@@ -200,8 +201,8 @@ void miniwindow_iconupdate(WWindow *wwin)
 
 void miniwindow_Expose(WObjDescriptor *desc, XEvent *event)
 {
-	/* Parameter not used, but tell the compiler that it is ok */
-	(void) event;
+	if (!wIconExposeNeedsPaint(desc->parent, event))
+		return;
 
 	wIconPaint(desc->parent);
 }
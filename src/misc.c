@@ -23,6 +23,7 @@
 #include <X11/Xutil.h>
 #include <X11/Xatom.h>
 #include <sys/stat.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -53,6 +54,8 @@
 #include "xmodifier.h"
 #include "main.h"
 #include "event.h"
+#include "bghelper.h"
+#include "statefile.h"
 
 
 #define ICON_SIZE wPreferences.icon_size
@@ -243,68 +246,102 @@ void slide_windows(Window wins[], int n, int from_x, int from_y, int to_x, int t
 	eatExpose();
 }
 
-char *ShrinkString(WMFont *font, const char *string, int width)
+/*
+ * The last strings shortened are remembered, because the same titles are
+ * painted again and again (focus changes, title updates...)
+ */
+#define SHRINK_CACHE_SIZE	32
+
+static struct {
+	WMFont *font;
+	char *font_name;
+	int width;
+	char *string;
+	char *result;
+} shrink_cache[SHRINK_CACHE_SIZE];
+
+static char *shrink_string(WMFont *font, const char *string, int width)
 {
-	int p1, p2, t, p, w, w1 = 0;
+	int length, p, start, *widths;
 	char *pos, *text;
 
-	p = strlen(string);
-	w = WMWidthOfString(font, string, p);
-	text = wmalloc(strlen(string) + 8);
-	strcpy(text, string);
-	if (w <= width)
+	length = strlen(string);
+	text = wmalloc(length + 8);
+
+	widths = wmalloc((length + 1) * sizeof(int));
+	WMWidthsOfStringPrefixes(font, string, length, widths);
+
+	if (widths[length] <= width) {
+		strcpy(text, string);
+		wfree(widths);
 		return text;
+	}
 
-	pos = strchr(text, ' ');
+	/* keep the first word if it fits */
+	pos = strchr(string, ' ');
 	if (!pos)
-		pos = strchr(text, ':');
+		pos = strchr(string, ':');
 
+	start = 0;
 	if (pos) {
-		*pos = 0;
-		p = strlen(text);
-		w1 = WMWidthOfString(font, text, p);
-
-		if (w1 > width) {
-			p = 0;
-			*pos = ' ';
-			*text = 0;
-		} else {
-			*pos = 0;
-			width -= w1;
-			p++;
+		p = pos - string;
+		if (widths[p] <= width) {
+			memcpy(text, string, p);
+			text[p] = 0;
+			width -= widths[p];
+			start = p + 1;
 		}
-
-		string += p;
-		p = strlen(string);
-	} else {
-		*text = 0;
 	}
 
 	strcat(text, "...");
 	width -= WMWidthOfString(font, "...", 3);
 
-	p1 = 0;
-	p2 = p;
-	t = (p2 - p1) / 2;
-
-	while (p2 > p1 && p1 != t) {
-		w = WMWidthOfString(font, &string[p - t], t);
-		if (w > width) {
-			p2 = t;
-			t = p1 + (p2 - p1) / 2;
-		} else if (w < width) {
-			p1 = t;
-			t = p1 + (p2 - p1) / 2;
-		} else {
-			p2 = p1 = t;
-		}
+	/* and then as much of the end of the string as possible */
+	while (start < length) {
+		if ((string[start] & 0xc0) != 0x80 && widths[length] - widths[start] <= width)
+			break;
+		start++;
 	}
 
-	strcat(text, &string[p - p1]);
+	strcat(text, &string[start]);
+	wfree(widths);
 
 	return text;
 }
 
+char *ShrinkString(WMFont *font, const char *string, int width)
+{
+	const char *font_name = WMGetFontName(font);
+	unsigned hash = width;
+	const char *c;
+	int i;
+
+	for (c = string; *c; c++)
+		hash = hash * 31 + (unsigned char)*c;
+	i = (hash ^ ((uintptr_t) font >> 4)) % SHRINK_CACHE_SIZE;
+
+	/* the font name is checked too, in case the font was freed and another
+	 * one was created at the same place */
+	if (shrink_cache[i].font == font && shrink_cache[i].width == width
+	    && strcmp(shrink_cache[i].string, string) == 0
+	    && strcmp(shrink_cache[i].font_name, font_name) == 0)
+		return wstrdup(shrink_cache[i].result);
+
+	if (shrink_cache[i].string) {
+		wfree(shrink_cache[i].font_name);
+		wfree(shrink_cache[i].string);
+		wfree(shrink_cache[i].result);
+	}
+
+	shrink_cache[i].font = font;
+	shrink_cache[i].font_name = wstrdup(font_name);
+	shrink_cache[i].width = width;
+	shrink_cache[i].string = wstrdup(string);
+	shrink_cache[i].result = shrink_string(font, string, width);
+
+	return wstrdup(shrink_cache[i].result);
+}
+
 char *FindImage(const char *paths, const char *file)
 {
 	char *tmp, *path = NULL;
@@ -921,24 +958,197 @@ static void UnescapeWM_CLASS(const char *str, char **name, char **class)
 	}
 }
 
+/*
+ * Messages for the background helper are queued and written without
+ * blocking, so that a helper which does not read its input any more can
+ * not stall us.
+ */
+struct BackgroundHelper {
+	int ack_fd;
+	WMHandlerID ack_handler;
+	WMHandlerID write_handler;
+
+	char *buffer;			/* messages not written yet */
+	size_t length;
+	size_t size;
+
+	long batch;			/* offset of the batch being filled, -1 if none */
+	int unacked;			/* changes sent and not acknowledged yet */
+	int pending_change;		/* change to send once they are, -1 if none */
+	WMHandlerID ack_timer;		/* gives up waiting for the acknowledgements */
+
+	unsigned char acks[sizeof(BGHelperHeader) * 32];	/* read from the helper */
+	size_t acks_length;
+};
+
+static void sendHelperMessage(WScreen *scr, char type, int workspace, const char *msg);
+
 static void track_bg_helper_death(pid_t pid, unsigned int status, void *client_data)
 {
 	WScreen *scr = (WScreen *) client_data;
+	struct BackgroundHelper *helper = scr->bg_helper;
 
 	/* Parameter not used, but tell the compiler that it is ok */
 	(void) pid;
 	(void) status;
 
+	if (helper) {
+		if (helper->write_handler)
+			WMDeleteInputHandler(helper->write_handler);
+		if (helper->ack_handler)
+			WMDeleteInputHandler(helper->ack_handler);
+		if (helper->ack_timer)
+			WMDeleteTimerHandler(helper->ack_timer);
+		close(helper->ack_fd);
+		if (helper->buffer)
+			wfree(helper->buffer);
+		wfree(helper);
+		scr->bg_helper = NULL;
+	}
+
 	close(scr->helper_fd);
 	scr->helper_fd = 0;
 	scr->helper_pid = 0;
 	scr->flags.backimage_helper_launched = 0;
 }
 
+static void flushHelperMessages(WScreen *scr);
+
+static void writeHelperMessages(int fd, int mask, void *client_data)
+{
+	/* Parameters not used, but tell the compiler that it is ok */
+	(void) fd;
+	(void) mask;
+
+	flushHelperMessages((WScreen *) client_data);
+}
+
+static void flushHelperMessages(WScreen *scr)
+{
+	struct BackgroundHelper *helper = scr->bg_helper;
+	ssize_t count;
+
+	while (helper->length > 0) {
+		count = write(scr->helper_fd, helper->buffer, helper->length);
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+
+			werror(_("could not send message to background image helper"));
+			/* the changes thrown away will not be acknowledged */
+			helper->length = 0;
+			helper->unacked = 0;
+			break;
+		}
+
+		memmove(helper->buffer, helper->buffer + count, helper->length - count);
+		helper->length -= count;
+	}
+
+	if (helper->length > 0 && !helper->write_handler) {
+		helper->write_handler = WMAddInputHandler(scr->helper_fd, WIWriteMask, writeHelperMessages, scr);
+	} else if (helper->length == 0 && helper->write_handler) {
+		WMDeleteInputHandler(helper->write_handler);
+		helper->write_handler = NULL;
+	}
+}
+
+static void helperChangesAcknowledged(WScreen *scr, int count)
+{
+	struct BackgroundHelper *helper = scr->bg_helper;
+	int workspace;
+
+	helper->unacked -= count;
+	if (helper->unacked < 0)
+		helper->unacked = 0;
+
+	if (helper->unacked > 0)
+		return;
+
+	if (helper->ack_timer) {
+		WMDeleteTimerHandler(helper->ack_timer);
+		helper->ack_timer = NULL;
+	}
+
+	if (helper->pending_change >= 0) {
+		workspace = helper->pending_change;
+		helper->pending_change = -1;
+		sendHelperMessage(scr, 'C', workspace, NULL);
+	}
+}
+
+static void helperAckTimeout(void *client_data)
+{
+	WScreen *scr = (WScreen *) client_data;
+	struct BackgroundHelper *helper = scr->bg_helper;
+
+	helper->ack_timer = NULL;
+	if (helper->unacked == 0)
+		return;
+
+	wwarning(_("background image helper did not acknowledge %i workspace changes"), helper->unacked);
+	helperChangesAcknowledged(scr, helper->unacked);
+}
+
+static void readHelperAcks(int fd, int mask, void *client_data)
+{
+	WScreen *scr = (WScreen *) client_data;
+	struct BackgroundHelper *helper = scr->bg_helper;
+	BGHelperHeader header;
+	ssize_t count;
+	size_t offset;
+	int acked = 0;
+	Bool garbage = False;
+
+	/* Parameter not used, but tell the compiler that it is ok */
+	(void) mask;
+
+	count = read(fd, helper->acks + helper->acks_length, sizeof(helper->acks) - helper->acks_length);
+	if (count < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+		return;
+
+	if (count <= 0) {
+		/* the helper is gone, its death handler cleans up */
+		WMDeleteInputHandler(helper->ack_handler);
+		helper->ack_handler = NULL;
+		return;
+	}
+	helper->acks_length += count;
+
+	/*
+	 * Anything else written on the output of the helper, like a warning of
+	 * a library, is skipped a byte at a time until a header is found again.
+	 */
+	offset = 0;
+	while (helper->acks_length - offset >= sizeof(header)) {
+		memcpy(&header, helper->acks + offset, sizeof(header));
+		if (header.version != BGHELPER_VERSION || header.type != 'A' || header.length != 0) {
+			garbage = True;
+			offset++;
+			continue;
+		}
+		acked++;
+		offset += sizeof(header);
+	}
+
+	/* keep what may be the start of the next header */
+	memmove(helper->acks, helper->acks + offset, helper->acks_length - offset);
+	helper->acks_length -= offset;
+
+	if (garbage)
+		wwarning(_("unexpected output from the background image helper was ignored"));
+
+	if (acked > 0)
+		helperChangesAcknowledged(scr, acked);
+}
+
 Bool start_bg_helper(virtual_screen *vscr)
 {
+	struct BackgroundHelper *helper;
 	pid_t pid;
-	int filedes[2];
+	int filedes[2], ackdes[2];
 	const char *dither;
 
 	if (pipe(filedes) < 0) {
@@ -947,17 +1157,28 @@ Bool start_bg_helper(virtual_screen *vscr)
 		return False;
 	}
 
+	if (pipe(ackdes) < 0) {
+		werror(_("%s failed, can't set workspace specific background image (%s)"),
+		       "pipe()", strerror(errno));
+		close(filedes[0]);
+		close(filedes[1]);
+		return False;
+	}
+
 	pid = fork();
 	if (pid < 0) {
 		werror(_("%s failed, can't set workspace specific background image (%s)"),
 		       "fork()", strerror(errno));
 		close(filedes[0]);
 		close(filedes[1]);
+		close(ackdes[0]);
+		close(ackdes[1]);
 		return False;
 
 	} else if (pid == 0) {
-		/* We don't need this side of the pipe in the child process */
+		/* We don't need these sides of the pipes in the child process */
 		close(filedes[1]);
+		close(ackdes[0]);
 
 		SetupEnvironment(vscr);
 
@@ -970,6 +1191,15 @@ Bool start_bg_helper(virtual_screen *vscr)
 
 		close(filedes[0]);
 
+		/* acknowledgements come back on the standard output */
+		if (dup2(ackdes[1], STDOUT_FILENO) < 0) {
+			werror(_("%s failed, can't set workspace specific background image (%s)"),
+			       "dup2()", strerror(errno));
+			exit(1);
+		}
+
+		close(ackdes[1]);
+
 		dither = wPreferences.no_dithering ? "-m" : "-d";
 		if (wPreferences.smooth_workspace_back)
 			execlp("wmsetbg", "wmsetbg", "-helper", "-S", dither, NULL);
@@ -979,13 +1209,24 @@ Bool start_bg_helper(virtual_screen *vscr)
 		werror(_("could not execute \"%s\": %s"), "wmsetbg", strerror(errno));
 		exit(1);
 	} else {
-		/* We don't need this side of the pipe in the parent process */
+		/* We don't need these sides of the pipes in the parent process */
 		close(filedes[0]);
+		close(ackdes[1]);
 
-		if (fcntl(filedes[1], F_SETFD, FD_CLOEXEC) < 0)
+		if (fcntl(filedes[1], F_SETFD, FD_CLOEXEC) < 0 || fcntl(ackdes[0], F_SETFD, FD_CLOEXEC) < 0)
 			wwarning(_("could not set close-on-exec flag for bg_helper's communication file handle (%s)"),
 			         strerror(errno));
 
+		fcntl(filedes[1], F_SETFL, O_NONBLOCK);
+		fcntl(ackdes[0], F_SETFL, O_NONBLOCK);
+
+		helper = wmalloc(sizeof(struct BackgroundHelper));
+		helper->ack_fd = ackdes[0];
+		helper->batch = -1;
+		helper->pending_change = -1;
+		helper->ack_handler = WMAddInputHandler(ackdes[0], WIReadMask, readHelperAcks, vscr->screen_ptr);
+
+		vscr->screen_ptr->bg_helper = helper;
 		vscr->screen_ptr->helper_fd = filedes[1];
 		vscr->screen_ptr->helper_pid = pid;
 		vscr->screen_ptr->flags.backimage_helper_launched = 1;
@@ -996,35 +1237,104 @@ Bool start_bg_helper(virtual_screen *vscr)
 	}
 }
 
-void SendHelperMessage(virtual_screen *vscr, char type, int workspace, const char *msg)
+/* returns False if the message was dropped */
+static Bool appendHelperMessage(struct BackgroundHelper *helper, char type, int workspace,
+				const char *data, size_t length)
 {
-	char *buffer;
-	int len, i;
-	char buf[16];
+	BGHelperHeader header;
+
+	if (length > BGHELPER_MAX_LENGTH) {
+		werror(_("message for background image helper is too long"));
+		return False;
+	}
+
+	/* the helper does not read what it was sent, don't pile up more */
+	if (helper->length + sizeof(header) + length > 4 * BGHELPER_MAX_LENGTH) {
+		werror(_("background image helper is not responding, message dropped"));
+		return False;
+	}
+
+	if (helper->length + sizeof(header) + length > helper->size) {
+		helper->size = helper->length + sizeof(header) + length + 1024;
+		helper->buffer = wrealloc(helper->buffer, helper->size);
+	}
+
+	header.version = BGHELPER_VERSION;
+	header.type = type;
+	header.workspace = (workspace < 0) ? BGHELPER_NO_WORKSPACE : workspace;
+	header.length = length;
+
+	memcpy(helper->buffer + helper->length, &header, sizeof(header));
+	helper->length += sizeof(header);
+	if (length > 0)
+		memcpy(helper->buffer + helper->length, data, length);
+	helper->length += length;
+
+	return True;
+}
+
+static void sendHelperMessage(WScreen *scr, char type, int workspace, const char *msg)
+{
+	struct BackgroundHelper *helper = scr->bg_helper;
+
+	if (!scr->flags.backimage_helper_launched || !helper)
+		return;
 
-	if (!vscr->screen_ptr->flags.backimage_helper_launched)
+	/* only the last change matters while the helper is busy with one */
+	if (type == 'C' && helper->unacked > 0) {
+		helper->pending_change = workspace;
 		return;
+	}
 
-	len = (msg ? strlen(msg) : 0) + (workspace >= 0 ? 4 : 0) + 1;
-	buffer = wmalloc(len + 5);
-	snprintf(buf, sizeof(buf), "%4i", len);
-	memcpy(buffer, buf, 4);
-	buffer[4] = type;
-	i = 5;
-	if (workspace >= 0) {
-		snprintf(buf, sizeof(buf), "%4i", workspace);
-		memcpy(&buffer[i], buf, 4);
-		i += 4;
-		buffer[i] = 0;
+	/* a change which was dropped will never be acknowledged */
+	if (appendHelperMessage(helper, type, workspace, msg, msg ? strlen(msg) : 0) && type == 'C') {
+		helper->unacked++;
+		if (!helper->ack_timer)
+			helper->ack_timer = WMAddTimerHandler(BGHELPER_ACK_TIMEOUT, helperAckTimeout, scr);
 	}
 
-	if (msg)
-		strcpy(&buffer[i], msg);
+	if (helper->batch < 0)
+		flushHelperMessages(scr);
+}
+
+void SendHelperMessage(virtual_screen *vscr, char type, int workspace, const char *msg)
+{
+	sendHelperMessage(vscr->screen_ptr, type, workspace, msg);
+}
+
+/*
+ * Messages sent until EndHelperBatch() are written together, and handled
+ * by the helper as a single one.
+ */
+void BeginHelperBatch(virtual_screen *vscr)
+{
+	struct BackgroundHelper *helper = vscr->screen_ptr->bg_helper;
 
-	if (write(vscr->screen_ptr->helper_fd, buffer, len + 4) < 0)
-		werror(_("could not send message to background image helper"));
+	if (!vscr->screen_ptr->flags.backimage_helper_launched || !helper || helper->batch >= 0)
+		return;
+
+	helper->batch = helper->length;
+	if (!appendHelperMessage(helper, 'B', -1, NULL, 0))
+		helper->batch = -1;
+}
+
+void EndHelperBatch(virtual_screen *vscr)
+{
+	struct BackgroundHelper *helper = vscr->screen_ptr->bg_helper;
+	BGHelperHeader header;
+
+	if (!vscr->screen_ptr->flags.backimage_helper_launched || !helper || helper->batch < 0)
+		return;
+
+	memcpy(&header, helper->buffer + helper->batch, sizeof(header));
+	header.length = helper->length - helper->batch - sizeof(header);
+	if (header.length == 0)
+		helper->length = helper->batch;
+	else
+		memcpy(helper->buffer + helper->batch, &header, sizeof(header));
+	helper->batch = -1;
 
-	wfree(buffer);
+	flushHelperMessages(vscr->screen_ptr);
 }
 
 Bool UpdateDomainFile(WDDomain *domain)
@@ -1051,7 +1361,7 @@ Bool UpdateDomainFile(WDDomain *domain)
 		}
 	}
 
-	result = WMWritePropListToFile(dict, domain->path);
+	result = wStateFileWrite(dict, domain->path);
 
 	if (freeDict)
 		WMReleasePropList(dict);
@@ -1137,56 +1447,3 @@ int create_minipixmap_for_window(virtual_screen *vscr, Window win, Pixmap *tmp)
 
 	return 0;
 }
-
-/*
- * For a WWindow, in a virtual_screen, creates a resized Pixmap.
- * If error, returns -1. If OK, returns 0
- */
-int create_minipixmap_for_wwindow(virtual_screen *vscr, WWindow *wwin, Pixmap *pixmap)
-{
-	RImage *mini_preview, *scaled_mini_preview;
-	XImage *pimg;
-	unsigned int w, h;
-	int x, y, ret;
-	Window baz;
-	XWindowAttributes attribs;
-
-	/* the window doesn't exist anymore */
-	if (!XGetWindowAttributes(dpy, wwin->client_win, &attribs))
-		return -1;
-
-	XRaiseWindow(dpy, wwin->frame->core->window);
-	XTranslateCoordinates(dpy, wwin->client_win, vscr->screen_ptr->root_win, 0, 0, &x, &y, &baz);
-
-	w = attribs.width;
-	h = attribs.height;
-
-	if (x - attribs.x + attribs.width > vscr->screen_ptr->scr_width)
-		w = vscr->screen_ptr->scr_width - x + attribs.x;
-
-	if (y - attribs.y + attribs.height > vscr->screen_ptr->scr_height)
-		h = vscr->screen_ptr->scr_height - y + attribs.y;
-
-	pimg = XGetImage(dpy, wwin->client_win, 0, 0, w, h, AllPlanes, ZPixmap);
-	if (!pimg)
-		return -1;
-
-	mini_preview = RCreateImageFromXImage(vscr->screen_ptr->rcontext, pimg, NULL);
-	XDestroyImage(pimg);
-
-	if (!mini_preview)
-		return -1;
-
-	scaled_mini_preview = RSmoothScaleImage(mini_preview,
-		wPreferences.minipreview_size - 2 * MINIPREVIEW_BORDER,
-		wPreferences.minipreview_size - 2 * MINIPREVIEW_BORDER);
-
-	ret = RConvertImage(vscr->screen_ptr->rcontext, scaled_mini_preview, pixmap);
-	RReleaseImage(scaled_mini_preview);
-	RReleaseImage(mini_preview);
-
-	if (!ret)
-		return -1;
-
-	return 0;
-}
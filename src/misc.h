@@ -40,6 +40,8 @@ static inline void slide_window(Window win, int from_x, int from_y, int to_x, in
 /* Helper is a 'wmsetbg' subprocess with sets the background for the current workspace */
 Bool start_bg_helper(virtual_screen *vscr);
 void SendHelperMessage(virtual_screen *vscr, char type, int workspace, const char *msg);
+void BeginHelperBatch(virtual_screen *vscr);
+void EndHelperBatch(virtual_screen *vscr);
 
 char *ShrinkString(WMFont *font, const char *string, int width);
 char *FindImage(const char *paths, const char *file);
@@ -51,5 +53,4 @@ char *StrConcatDot(const char *a, const char *b);
 char *GetCommandForWindow(Window win);
 
 int create_minipixmap_for_window(virtual_screen *vscr, Window win, Pixmap *tmp);
-int create_minipixmap_for_wwindow(virtual_screen *vscr, WWindow *wwin, Pixmap *pixmap);
 #endif
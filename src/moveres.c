@@ -43,6 +43,7 @@
 #include "screen.h"
 #include "xinerama.h"
 #include "miniwindow.h"
+#include "winsnapshot.h"
 
 #include <WINGs/WINGsP.h>
 
@@ -728,22 +729,21 @@ static void freeMoveData(MoveData *data)
 static void updateMoveData(WWindow *wwin, MoveData *data)
 {
 	virtual_screen *vscr = wwin->vscr;
+	WWindowSnapshot *snap = wWindowSnapshot(vscr);
 	WWindow *tmp;
 	int i;
 
 	data->count = 0;
-	tmp = vscr->window.focused;
-	while (tmp) {
-		if (tmp != wwin && vscr->workspace.current == tmp->frame->workspace
-		    && !tmp->flags.miniaturized
-		    && !tmp->flags.hidden && !tmp->flags.obscured && !WFLAGP(tmp, sunken)) {
+	WM_ITERATE_SNAPSHOT(snap, i) {
+		if (snap->wwin[i] != wwin && vscr->workspace.current == snap->workspace[i]
+		    && !(snap->flags[i] & (WSnapMiniaturized | WSnapHidden | WSnapObscured | WSnapSunken))) {
+			tmp = snap->wwin[i];
 			data->topList[data->count] = tmp;
 			data->leftList[data->count] = tmp;
 			data->rightList[data->count] = tmp;
 			data->bottomList[data->count] = tmp;
 			data->count++;
 		}
-		tmp = tmp->prev;
 	}
 
 	if (data->count == 0) {
@@ -39,6 +39,7 @@
 #include "xinerama.h"
 #include "placement.h"
 #include "miniwindow.h"
+#include "winsnapshot.h"
 
 static int get_y_origin(WArea usableArea);
 static int get_x_origin(WArea usableArea);
@@ -269,29 +270,17 @@ int calcIntersectionArea(int x1, int y1, int w1, int h1, int x2, int y2, int w2,
 	    * calcIntersectionLength(y1, h1, y2, h2);
 }
 
-static int calcSumOfCoveredAreas(WWindow *wwin, int x, int y, int w, int h)
+static int calcSumOfCoveredAreas(const WWindowSnapshot *snap, int x, int y, int w, int h)
 {
 	int sum_isect = 0;
-	WWindow *test_window;
-	int tw, tx, ty, th;
+	int i;
 
-	test_window = wwin->vscr->window.focused;
-	for (; test_window != NULL && test_window->prev != NULL;)
-		test_window = test_window->prev;
-
-	for (; test_window != NULL; test_window = test_window->next) {
-		if (test_window->frame->core->stacking->window_level < WMNormalLevel)
+	WM_ITERATE_SNAPSHOT(snap, i) {
+		if (snap->level[i] < WMNormalLevel || !(snap->flags[i] & WSnapVisible))
 			continue;
 
-		tw = test_window->frame->width;
-		th = test_window->frame->height;
-		tx = test_window->frame_x;
-		ty = test_window->frame_y;
-
-		if (test_window->flags.mapped || (test_window->flags.shaded &&
-		     test_window->frame->workspace == wwin->vscr->workspace.current &&
-		     !(test_window->flags.miniaturized || test_window->flags.hidden)))
-			sum_isect += calcIntersectionArea(tx, ty, tw, th, x, y, w, h);
+		sum_isect += calcIntersectionArea(snap->x[i], snap->y[i], snap->width[i], snap->height[i],
+						  x, y, w, h);
 	}
 
 	return sum_isect;
@@ -315,42 +304,17 @@ static void set_width_height(WWindow *wwin, unsigned int *width, unsigned int *h
 }
 
 static Bool
-window_overlaps(WWindow *win, int x, int y, int w, int h, Bool ignore_sunken)
-{
-	int tw, th, tx, ty;
-
-	if (ignore_sunken &&
-	    win->frame->core->stacking->window_level < WMNormalLevel)
-		return False;
-
-	tw = win->frame->width;
-	th = win->frame->height;
-	tx = win->frame_x;
-	ty = win->frame_y;
-
-	if ((tx < (x + w)) && ((tx + tw) > x) &&
-	    (ty < (y + h)) && ((ty + th) > y) &&
-	    (win->flags.mapped ||
-	     (win->flags.shaded &&
-	      win->frame->workspace == win->vscr->workspace.current &&
-	      !(win->flags.miniaturized || win->flags.hidden))))
-		return True;
-
-	return False;
-}
-
-static Bool
-screen_has_space(virtual_screen *vscr, int x, int y, int w, int h, Bool ignore_sunken)
+screen_has_space(const WWindowSnapshot *snap, int x, int y, int w, int h, Bool ignore_sunken)
 {
-	WWindow *focused = vscr->window.focused, *i;
+	int i;
 
-	for (i = focused; i; i = i->next)
-		if (window_overlaps(i, x, y, w, h, ignore_sunken))
-			return False;
+	WM_ITERATE_SNAPSHOT(snap, i) {
+		if (ignore_sunken && snap->level[i] < WMNormalLevel)
+			continue;
 
-	for (i = focused; i; i = i->prev)
-		if (window_overlaps(i, x, y, w, h, ignore_sunken))
+		if ((snap->flags[i] & WSnapVisible) && wSnapshotOverlaps(snap, i, x, y, w, h))
 			return False;
+	}
 
 	return True;
 }
@@ -359,6 +323,7 @@ static void
 smartPlaceWindow(WWindow *wwin, int *x_ret, int *y_ret, unsigned int width,
 		 unsigned int height, WArea usableArea)
 {
+	WWindowSnapshot *snap = wWindowSnapshot(wwin->vscr);
 	int test_x = 0, test_y = get_y_origin(usableArea);
 	int from_x, to_x, from_y, to_y;
 	int sx;
@@ -375,7 +340,7 @@ smartPlaceWindow(WWindow *wwin, int *x_ret, int *y_ret, unsigned int width,
 	while (((test_y + height) < usableArea.y2)) {
 		test_x = sx;
 		while ((test_x + width) < usableArea.x2) {
-			sum_isect = calcSumOfCoveredAreas(wwin, test_x, test_y, width, height);
+			sum_isect = calcSumOfCoveredAreas(snap, test_x, test_y, width, height);
 
 			if (sum_isect < min_isect) {
 				min_isect = sum_isect;
@@ -402,7 +367,7 @@ smartPlaceWindow(WWindow *wwin, int *x_ret, int *y_ret, unsigned int width,
 
 	for (test_x = from_x; test_x < to_x; test_x++) {
 		for (test_y = from_y; test_y < to_y; test_y++) {
-			sum_isect = calcSumOfCoveredAreas(wwin, test_x, test_y, width, height);
+			sum_isect = calcSumOfCoveredAreas(snap, test_x, test_y, width, height);
 
 			if (sum_isect < min_isect) {
 				min_isect = sum_isect;
@@ -440,7 +405,7 @@ autoPlaceWindow(WWindow *wwin, int *x_ret, int *y_ret,
 		unsigned int width, unsigned int height,
 		Bool ignore_sunken, WArea usableArea)
 {
-	virtual_screen *vscr = wwin->vscr;
+	WWindowSnapshot *snap = wWindowSnapshot(wwin->vscr);
 	int x, y;
 	int sw, sh;
 
@@ -450,7 +415,7 @@ autoPlaceWindow(WWindow *wwin, int *x_ret, int *y_ret,
 
 	/* try placing at center first */
 	if (center_place_window(wwin, &x, &y, width, height, usableArea) &&
-	    screen_has_space(vscr, x, y, width, height, False)) {
+	    screen_has_space(snap, x, y, width, height, False)) {
 		*x_ret = x;
 		*y_ret = y;
 		return True;
@@ -459,7 +424,7 @@ autoPlaceWindow(WWindow *wwin, int *x_ret, int *y_ret,
 	/* this was based on fvwm2's smart placement */
 	for (y = get_y_origin(usableArea); (y + height) < sh; y += PLACETEST_VSTEP) {
 		for (x = get_x_origin(usableArea); (x + width) < sw; x += PLACETEST_HSTEP) {
-			if (screen_has_space(vscr, x, y,
+			if (screen_has_space(snap, x, y,
 					     width, height, ignore_sunken)) {
 				*x_ret = x;
 				*y_ret = y;
@@ -25,46 +25,624 @@
 #include <X11/Xatom.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+
+#ifdef USE_XCB
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+#endif
 
 #include "WindowMaker.h"
 #include "window.h"
+#include "application.h"
 #include "GNUstep.h"
 #include "properties.h"
 
 
+/* size of the size hints and wm hints properties, from Xlib */
+#define NUM_PROP_SIZE_ELEMENTS		18
+#define OLD_NUM_PROP_SIZE_ELEMENTS	15
+#define NUM_PROP_WM_HINTS_ELEMENTS	9
+
+#ifdef USE_XCB
+/*
+ * Properties read while a new window is managed, fetched together by
+ * PropFetchClientProps(). The length is in 32 bit units, a property
+ * longer than that is read again from the server when it is needed.
+ */
+static const struct {
+	const char *name;
+	uint32_t length;
+} client_props[] = {
+	{ "WM_STATE", 2 },
+	{ "WM_CLASS", 1024 },
+	{ "WM_CLIENT_LEADER", 1 },
+	{ "WM_HINTS", NUM_PROP_WM_HINTS_ELEMENTS },
+	{ "WM_PROTOCOLS", 1024 },
+	{ "WM_TRANSIENT_FOR", 1 },
+	{ "WM_NORMAL_HINTS", NUM_PROP_SIZE_ELEMENTS },
+	{ "_GNUSTEP_WM_ATTR", 9 },
+	{ "_MOTIF_WM_HINTS", 1024 },
+	{ "_GTK_APPLICATION_OBJECT_PATH", 16 },
+	{ "_NET_WM_PID", 1 },
+	{ "_NET_WM_DESKTOP", 1 },
+	{ "_NET_WM_STATE", 1024 },
+	{ "_NET_WM_WINDOW_TYPE", 1024 },
+	{ "_NET_WM_STRUT", 4 },
+	{ "_NET_WM_STRUT_PARTIAL", 12 },
+	{ "_NET_WM_HANDLED_ICONS", 1 },
+	{ "_NET_WM_ICON_GEOMETRY", 4 },
+	/* only whether it is there, the icon images are read as needed */
+	{ "_NET_WM_ICON", 0 },
+	{ "_NET_WM_WINDOW_OPACITY", 1 }
+};
+
+#define NUM_CLIENT_PROPS (sizeof(client_props) / sizeof(client_props[0]))
+
+typedef struct WClientProps {
+	Window window;
+
+	/* only for the windows of PropPrefetchClientProps() */
+	xcb_get_window_attributes_reply_t *attributes;
+	xcb_get_geometry_reply_t *geometry;
+
+	xcb_get_property_reply_t *replies[NUM_CLIENT_PROPS];
+
+	Bool selected;		/* its events were selected to notice changes */
+} WClientProps;
+
+static struct {
+	Bool atoms_ready;
+	Atom atoms[NUM_CLIENT_PROPS];
+
+	WClientProps **props;
+	int count;
+	int size;
+} fetched;
+
+
+static void initClientPropAtoms(void)
+{
+	char *names[NUM_CLIENT_PROPS];
+	int i;
+
+	if (fetched.atoms_ready)
+		return;
+
+	for (i = 0; i < NUM_CLIENT_PROPS; i++)
+		names[i] = (char *) client_props[i].name;
+	XInternAtoms(dpy, names, NUM_CLIENT_PROPS, False, fetched.atoms);
+	fetched.atoms_ready = True;
+}
+
+static WClientProps *findClientProps(Window window)
+{
+	int i;
+
+	if (window == None)
+		return NULL;
+
+	for (i = 0; i < fetched.count; i++) {
+		if (fetched.props[i]->window == window)
+			return fetched.props[i];
+	}
+
+	return NULL;
+}
+
+static WClientProps *addClientProps(Window window)
+{
+	WClientProps *props;
+
+	if (fetched.count == fetched.size) {
+		fetched.size = fetched.size ? fetched.size * 2 : 8;
+		fetched.props = wrealloc(fetched.props, fetched.size * sizeof(WClientProps *));
+	}
+
+	props = wmalloc(sizeof(WClientProps));
+	props->window = window;
+	fetched.props[fetched.count++] = props;
+
+	return props;
+}
+
+static void freeClientProps(WClientProps *props)
+{
+	int i;
+
+	/*
+	 * The windows which were not managed, like the icon windows, would
+	 * send their events for the rest of the session. The group leaders
+	 * select the same events, keep them.
+	 */
+	if (props->selected && !wWindowFor(props->window) && !wApplicationOf(props->window))
+		XSelectInput(dpy, props->window, NoEventMask);
+
+	for (i = 0; i < NUM_CLIENT_PROPS; i++) {
+		if (props->replies[i])
+			free(props->replies[i]);
+	}
+	if (props->attributes)
+		free(props->attributes);
+	if (props->geometry)
+		free(props->geometry);
+	wfree(props);
+}
+
+static void sendPropertyRequests(xcb_connection_t *conn, Window window, xcb_get_property_cookie_t *cookies)
+{
+	int i;
+
+	for (i = 0; i < NUM_CLIENT_PROPS; i++)
+		cookies[i] = xcb_get_property(conn, 0, window, fetched.atoms[i], XCB_GET_PROPERTY_TYPE_ANY, 0,
+					      client_props[i].length);
+}
+
+static void getPropertyReplies(xcb_connection_t *conn, WClientProps *props, xcb_get_property_cookie_t *cookies)
+{
+	xcb_generic_error_t *error;
+	int i;
+
+	for (i = 0; i < NUM_CLIENT_PROPS; i++) {
+		error = NULL;
+		props->replies[i] = xcb_get_property_reply(conn, cookies[i], &error);
+		if (error) {
+			free(error);
+			if (props->replies[i]) {
+				free(props->replies[i]);
+				props->replies[i] = NULL;
+			}
+		}
+	}
+}
+
+/* Fill the attributes the way XGetWindowAttributes() does */
+static void convertAttributes(const WClientProps *props, XWindowAttributes *attr)
+{
+	const xcb_get_window_attributes_reply_t *a = props->attributes;
+	const xcb_get_geometry_reply_t *g = props->geometry;
+	int s, d, v;
+
+	memset(attr, 0, sizeof(XWindowAttributes));
+	attr->x = g->x;
+	attr->y = g->y;
+	attr->width = g->width;
+	attr->height = g->height;
+	attr->border_width = g->border_width;
+	attr->depth = g->depth;
+	attr->root = g->root;
+	attr->class = a->_class;
+	attr->bit_gravity = a->bit_gravity;
+	attr->win_gravity = a->win_gravity;
+	attr->backing_store = a->backing_store;
+	attr->backing_planes = a->backing_planes;
+	attr->backing_pixel = a->backing_pixel;
+	attr->save_under = a->save_under;
+	attr->colormap = a->colormap;
+	attr->map_installed = a->map_is_installed;
+	attr->map_state = a->map_state;
+	attr->all_event_masks = a->all_event_masks;
+	attr->your_event_mask = a->your_event_mask;
+	attr->do_not_propagate_mask = a->do_not_propagate_mask;
+	attr->override_redirect = a->override_redirect;
+
+	for (s = 0; s < ScreenCount(dpy); s++) {
+		Screen *screen = ScreenOfDisplay(dpy, s);
+
+		if (RootWindowOfScreen(screen) == g->root)
+			attr->screen = screen;
+
+		for (d = 0; d < screen->ndepths && !attr->visual; d++) {
+			for (v = 0; v < screen->depths[d].nvisuals; v++) {
+				if (screen->depths[d].visuals[v].visualid == a->visual) {
+					attr->visual = &screen->depths[d].visuals[v];
+					break;
+				}
+			}
+		}
+	}
+}
+#endif
+
+/*
+ * Read the attributes and properties of all the given windows in one round
+ * trip, for PropFetchClientProps() to use when they are managed. Used when
+ * Window Maker starts and adopts all the existing windows.
+ *
+ * Must be called with the server grabbed. The windows which can be managed
+ * get PropertyChangeMask and StructureNotifyMask selected, so that anything
+ * they change before they are managed is noticed and read again. The
+ * selection is undone by PropReleaseClientProps() if they are not managed.
+ */
+void PropPrefetchClientProps(Window *windows, int count)
+{
+#ifdef USE_XCB
+	xcb_connection_t *conn = XGetXCBConnection(dpy);
+	xcb_get_window_attributes_cookie_t *attr_cookies;
+	xcb_get_geometry_cookie_t *geom_cookies;
+	xcb_get_property_cookie_t *cookies;
+	WClientProps *props;
+	int i;
+
+	initClientPropAtoms();
+
+	attr_cookies = wmalloc(count * sizeof(xcb_get_window_attributes_cookie_t));
+	geom_cookies = wmalloc(count * sizeof(xcb_get_geometry_cookie_t));
+	cookies = wmalloc(count * NUM_CLIENT_PROPS * sizeof(xcb_get_property_cookie_t));
+
+	for (i = 0; i < count; i++) {
+		if (windows[i] == None)
+			continue;
+
+		attr_cookies[i] = xcb_get_window_attributes(conn, windows[i]);
+		geom_cookies[i] = xcb_get_geometry(conn, windows[i]);
+		sendPropertyRequests(conn, windows[i], &cookies[i * NUM_CLIENT_PROPS]);
+	}
+
+	for (i = 0; i < count; i++) {
+		if (windows[i] == None)
+			continue;
+
+		PropReleaseClientProps(windows[i]);
+		props = addClientProps(windows[i]);
+		props->attributes = xcb_get_window_attributes_reply(conn, attr_cookies[i], NULL);
+		props->geometry = xcb_get_geometry_reply(conn, geom_cookies[i], NULL);
+		getPropertyReplies(conn, props, &cookies[i * NUM_CLIENT_PROPS]);
+
+		if (!props->attributes || !props->geometry) {
+			PropReleaseClientProps(windows[i]);
+			continue;
+		}
+
+		if (!props->attributes->override_redirect) {
+			XSelectInput(dpy, windows[i], PropertyChangeMask | StructureNotifyMask);
+			props->selected = True;
+		}
+	}
+
+	wfree(attr_cookies);
+	wfree(geom_cookies);
+	wfree(cookies);
+#else
+	/* Parameters not used, but tell the compiler that it is ok */
+	(void) windows;
+	(void) count;
+#endif
+}
+
+/*
+ * Read the properties of a window being managed in one round trip.
+ *
+ * The requests for all the properties in client_props and for the window
+ * attributes are sent together, then the replies are kept until
+ * PropReleaseClientProps() so that PropGetWindowProperty() answers from
+ * them. This must be done with the server grabbed, otherwise the client
+ * could change the properties in the meantime.
+ *
+ * If the window was given to PropPrefetchClientProps() and did not change
+ * since, nothing is read from the server.
+ *
+ * Returns False if the window does not exist anymore, like
+ * XGetWindowAttributes().
+ */
+Bool PropFetchClientProps(Window window, XWindowAttributes *attr)
+{
+#ifdef USE_XCB
+	xcb_connection_t *conn;
+	xcb_get_property_cookie_t cookies[NUM_CLIENT_PROPS];
+	WClientProps *props;
+	Status status;
+	Bool changed = False;
+	XEvent ev;
+
+	props = findClientProps(window);
+	if (props && props->attributes) {
+		/*
+		 * The events are all there, as the server is grabbed and synced.
+		 * They are only sent to us because of the selection made in
+		 * PropPrefetchClientProps(): the structure changes also reach the
+		 * root window and the properties are read again below, so they
+		 * are dropped instead of being put back ahead of the others.
+		 */
+		while (XCheckWindowEvent(dpy, window, PropertyChangeMask | StructureNotifyMask, &ev))
+			changed = True;
+
+		if (!changed) {
+			convertAttributes(props, attr);
+			return True;
+		}
+	}
+	PropReleaseClientProps(window);
+
+	conn = XGetXCBConnection(dpy);
+	initClientPropAtoms();
+	sendPropertyRequests(conn, window, cookies);
+
+	/* the replies to the requests above come back with this one */
+	status = XGetWindowAttributes(dpy, window, attr);
+
+	props = addClientProps(window);
+	getPropertyReplies(conn, props, cookies);
+
+	if (!status) {
+		PropReleaseClientProps(window);
+		return False;
+	}
+
+	return True;
+#else
+	return XGetWindowAttributes(dpy, window, attr);
+#endif
+}
+
+/*
+ * Forget the properties read for the window, or for all the windows if
+ * it is None
+ */
+void PropReleaseClientProps(Window window)
+{
+#ifdef USE_XCB
+	int i;
+
+	for (i = fetched.count - 1; i >= 0; i--) {
+		if (window == None || fetched.props[i]->window == window) {
+			freeClientProps(fetched.props[i]);
+			fetched.props[i] = fetched.props[--fetched.count];
+		}
+	}
+#else
+	/* Parameter not used, but tell the compiler that it is ok */
+	(void) window;
+#endif
+}
+
+#ifdef USE_XCB
+/*
+ * Answer a property request from the replies of PropFetchClientProps(), the
+ * same way the server and Xlib would. Returns False when the request cannot
+ * be answered from there.
+ */
+static Bool getFetchedProperty(Window window, Atom property, long offset, long length, Atom req_type,
+			       Atom *actual_type, int *actual_format, unsigned long *nitems,
+			       unsigned long *bytes_after, unsigned char **prop)
+{
+	WClientProps *props;
+	xcb_get_property_reply_t *reply = NULL;
+	const unsigned char *value;
+	unsigned long total, start, size, unit, i;
+	int n;
+
+	props = findClientProps(window);
+	if (!props)
+		return False;
+
+	for (n = 0; n < NUM_CLIENT_PROPS; n++) {
+		if (fetched.atoms[n] == property) {
+			reply = props->replies[n];
+			break;
+		}
+	}
+	if (!reply || offset < 0 || length < 0)
+		return False;
+
+	*actual_type = reply->type;
+	*actual_format = reply->format;
+	*nitems = 0;
+	*bytes_after = 0;
+	*prop = NULL;
+
+	if (reply->type == None)
+		return True;
+
+	unit = reply->format / 8;
+	total = reply->value_len * unit + reply->bytes_after;
+
+	if (req_type != AnyPropertyType && req_type != reply->type) {
+		*bytes_after = total;
+		*prop = calloc(1, 1);
+		return True;
+	}
+
+	start = (unsigned long) offset * 4;
+	if (start > total)
+		return False;
+
+	size = total - start;
+	if ((unsigned long) length < size / 4 + 1)
+		size = WMIN(size, (unsigned long) length * 4);
+
+	/* not all of it was fetched */
+	if (start + size > reply->value_len * unit)
+		return False;
+
+	size -= size % unit;
+	*nitems = size / unit;
+	*bytes_after = total - start - size;
+
+	/* Xlib gives 32 bit items as longs and terminates the data */
+	value = (const unsigned char *) xcb_get_property_value(reply) + start;
+	switch (reply->format) {
+	case 32:
+		*prop = malloc(*nitems * sizeof(long) + 1);
+		if (*prop) {
+			for (i = 0; i < *nitems; i++)
+				((long *) *prop)[i] = ((const int32_t *) value)[i];
+			(*prop)[*nitems * sizeof(long)] = 0;
+		}
+		break;
+	case 16:
+		*prop = malloc(*nitems * sizeof(short) + 1);
+		if (*prop) {
+			memcpy(*prop, value, size);
+			(*prop)[*nitems * sizeof(short)] = 0;
+		}
+		break;
+	default:
+		*prop = malloc(size + 1);
+		if (*prop) {
+			memcpy(*prop, value, size);
+			(*prop)[size] = 0;
+		}
+		break;
+	}
+
+	if (!*prop)
+		return False;
+
+	return True;
+}
+#endif
+
+/*
+ * Same as XGetWindowProperty() without the 'delete' argument, answered from
+ * the properties fetched by PropFetchClientProps() when possible.
+ */
+int PropGetWindowProperty(Window window, Atom property, long offset, long length, Atom req_type,
+			  Atom *actual_type, int *actual_format, unsigned long *nitems,
+			  unsigned long *bytes_after, unsigned char **prop)
+{
+#ifdef USE_XCB
+	if (getFetchedProperty(window, property, offset, length, req_type,
+			       actual_type, actual_format, nitems, bytes_after, prop))
+		return Success;
+#endif
+
+	return XGetWindowProperty(dpy, window, property, offset, length, False, req_type,
+				  actual_type, actual_format, nitems, bytes_after, prop);
+}
+
 int PropGetNormalHints(Window window, XSizeHints *size_hints, int *pre_iccm)
 {
+	Atom type_ret;
+	int fmt_ret;
+	unsigned long nitems_ret, bytes_after_ret;
+	long *data = NULL;
 	long supplied_hints;
 
-	if (!XGetWMNormalHints(dpy, window, size_hints, &supplied_hints)) {
+	/* this is what XGetWMNormalHints() does */
+	if (PropGetWindowProperty(window, XA_WM_NORMAL_HINTS, 0, NUM_PROP_SIZE_ELEMENTS, XA_WM_SIZE_HINTS,
+				  &type_ret, &fmt_ret, &nitems_ret, &bytes_after_ret,
+				  (unsigned char **)&data) != Success)
+		return False;
+
+	if (type_ret != XA_WM_SIZE_HINTS || fmt_ret != 32 || nitems_ret < OLD_NUM_PROP_SIZE_ELEMENTS) {
+		if (data)
+			XFree(data);
 		return False;
 	}
-	if (supplied_hints == (USPosition | USSize | PPosition | PSize | PMinSize | PMaxSize
-			       | PResizeInc | PAspect)) {
-		*pre_iccm = 1;
-	} else {
+
+	size_hints->flags = data[0];
+	size_hints->x = data[1];
+	size_hints->y = data[2];
+	size_hints->width = data[3];
+	size_hints->height = data[4];
+	size_hints->min_width = data[5];
+	size_hints->min_height = data[6];
+	size_hints->max_width = data[7];
+	size_hints->max_height = data[8];
+	size_hints->width_inc = data[9];
+	size_hints->height_inc = data[10];
+	size_hints->min_aspect.x = data[11];
+	size_hints->min_aspect.y = data[12];
+	size_hints->max_aspect.x = data[13];
+	size_hints->max_aspect.y = data[14];
+
+	supplied_hints = USPosition | USSize | PPosition | PSize | PMinSize | PMaxSize | PResizeInc | PAspect;
+	if (nitems_ret >= NUM_PROP_SIZE_ELEMENTS) {
+		size_hints->base_width = data[15];
+		size_hints->base_height = data[16];
+		size_hints->win_gravity = data[17];
+		supplied_hints |= PBaseSize | PWinGravity;
 		*pre_iccm = 0;
+	} else {
+		*pre_iccm = 1;
 	}
+	size_hints->flags &= supplied_hints;
+
+	XFree(data);
+
 	return True;
 }
 
 int PropGetWMClass(Window window, char **wm_class, char **wm_instance)
 {
-	XClassHint *class_hint;
+	char *data;
+	int count, len;
 
-	class_hint = XAllocClassHint();
-	if (XGetClassHint(dpy, window, class_hint) == 0) {
+	/* this is what XGetClassHint() does */
+	data = (char *)PropGetCheckProperty(window, XA_WM_CLASS, XA_STRING, 8, 0, &count);
+	if (!data) {
 		*wm_class = strdup("default");
 		*wm_instance = strdup("default");
-		XFree(class_hint);
 		return False;
 	}
-	*wm_instance = strdup(class_hint->res_name);
-	*wm_class = strdup(class_hint->res_class);
 
-	XFree(class_hint->res_name);
-	XFree(class_hint->res_class);
-	XFree(class_hint);
+	/* the data is always null terminated, but the class may be missing */
+	len = strlen(data);
+	*wm_instance = strdup(data);
+	if (len == count)
+		len--;
+	*wm_class = strdup(data + len + 1);
+
+	XFree(data);
+
+	return True;
+}
+
+XWMHints *PropGetWMHints(Window window)
+{
+	Atom type_ret;
+	int fmt_ret;
+	unsigned long nitems_ret, bytes_after_ret;
+	long *data = NULL;
+	XWMHints *hints;
+
+	/* this is what XGetWMHints() does */
+	if (PropGetWindowProperty(window, XA_WM_HINTS, 0, NUM_PROP_WM_HINTS_ELEMENTS, XA_WM_HINTS,
+				  &type_ret, &fmt_ret, &nitems_ret, &bytes_after_ret,
+				  (unsigned char **)&data) != Success)
+		return NULL;
+
+	/* pre-R3 clients truncated window_group */
+	if (type_ret != XA_WM_HINTS || fmt_ret != 32 || nitems_ret < NUM_PROP_WM_HINTS_ELEMENTS - 1) {
+		if (data)
+			XFree(data);
+		return NULL;
+	}
+
+	hints = XAllocWMHints();
+	if (hints) {
+		hints->flags = data[0];
+		hints->input = (data[1] ? True : False);
+		hints->initial_state = data[2];
+		hints->icon_pixmap = data[3];
+		hints->icon_window = data[4];
+		hints->icon_x = data[5];
+		hints->icon_y = data[6];
+		hints->icon_mask = data[7];
+		if (nitems_ret >= NUM_PROP_WM_HINTS_ELEMENTS)
+			hints->window_group = data[8];
+		else
+			hints->window_group = None;
+	}
+
+	XFree(data);
+
+	return hints;
+}
+
+int PropGetTransientFor(Window window, Window *owner)
+{
+	Window *data;
+
+	data = (Window *)PropGetCheckProperty(window, XA_WM_TRANSIENT_FOR, XA_WINDOW, 32, 1, NULL);
+	if (!data) {
+		*owner = None;
+		return False;
+	}
+
+	*owner = *data;
+	XFree(data);
 
 	return True;
 }
@@ -75,9 +653,10 @@ void PropGetProtocols(Window window, WProtocols *prots)
 	int count, i;
 
 	memset(prots, 0, sizeof(WProtocols));
-	if (!XGetWMProtocols(dpy, window, &protocols, &count)) {
+	protocols = (Atom *)PropGetCheckProperty(window, w_global.atom.wm.protocols, XA_ATOM, 32, 0, &count);
+	if (!protocols)
 		return;
-	}
+
 	for (i = 0; i < count; i++) {
 		if (protocols[i] == w_global.atom.wm.take_focus)
 			prots->TAKE_FOCUS = 1;
@@ -105,9 +684,9 @@ unsigned char *PropGetCheckProperty(Window window, Atom hint, Atom type, int for
 	else
 		tmp = count;
 
-	if (XGetWindowProperty(dpy, window, hint, 0, tmp, False, type,
-			       &type_ret, &fmt_ret, &nitems_ret, &bytes_after_ret,
-			       (unsigned char **)&data) != Success || !data)
+	if (PropGetWindowProperty(window, hint, 0, tmp, type,
+				  &type_ret, &fmt_ret, &nitems_ret, &bytes_after_ret,
+				  (unsigned char **)&data) != Success || !data)
 		return NULL;
 
 	if ((type != AnyPropertyType && type != type_ret)
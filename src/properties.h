@@ -24,6 +24,14 @@
 
 #include "GNUstep.h"
 
+void PropPrefetchClientProps(Window *windows, int count);
+Bool PropFetchClientProps(Window window, XWindowAttributes *attr);
+void PropReleaseClientProps(Window window);
+
+int PropGetWindowProperty(Window window, Atom property, long offset, long length, Atom req_type,
+                          Atom *actual_type, int *actual_format, unsigned long *nitems,
+                          unsigned long *bytes_after, unsigned char **prop);
+
 unsigned char* PropGetCheckProperty(Window window, Atom hint, Atom type,
                                     int format, int count, int *retCount);
 
@@ -32,6 +40,8 @@ int PropGetWindowState(Window window);
 int PropGetNormalHints(Window window, XSizeHints *size_hints, int *pre_iccm);
 void PropGetProtocols(Window window, WProtocols *prots);
 int PropGetWMClass(Window window, char **wm_class, char **wm_instance);
+XWMHints *PropGetWMHints(Window window);
+int PropGetTransientFor(Window window, Window *owner);
 int PropGetGNUstepWMAttr(Window window, GNUstepWMAttributes **attr);
 
 void PropSetWMakerProtocols(Window root);
@@ -27,7 +27,10 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 #include <sys/types.h>
 #include <string.h>
@@ -36,6 +39,7 @@
 #include <time.h>
 #include <dirent.h>
 #include <errno.h>
+#include <signal.h>
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
@@ -65,8 +69,7 @@
 
 #define MAX_SHORTCUT_LENGTH 32
 
-static WMenu *readMenuPipe(virtual_screen *vscr, char **file_name);
-static WMenu *readPLMenuPipe(virtual_screen *vscr, char **file_name);
+static WMenu *constructMenuFromPipe(WMenu *menu, WMenuEntry *entry, char **path, Bool plmenu);
 static WMenu *readMenuFile(virtual_screen *vscr, const char *file_name);
 static WMenu *readMenuDirectory(virtual_screen *vscr, const char *title, char **file_name, const char *command);
 static WMenu *configureMenu(virtual_screen *vscr, WMPropList *definition);
@@ -625,7 +628,7 @@ static void constructMenu(WMenu *menu, WMenuEntry *entry)
 {
 	WMenu *submenu;
 	struct stat stat_buf;
-	char **path, *cmd, *lpath = NULL;
+	char **path, *cmd, *lpath = NULL, *plpath;
 	int i, first = -1;
 	time_t last = 0;
 
@@ -646,100 +649,90 @@ static void constructMenu(WMenu *menu, WMenuEntry *entry)
 
 	if (path[0][0] == '|') {
 		/* pipe menu */
-		if (!menu->cascades[entry->cascade] || menu->cascades[entry->cascade]->timestamp == 0) {
-			/* parse pipe */
-			submenu = readMenuPipe(menu->vscr, path);
-
-			if (submenu != NULL) {
-				if (path[0][1] == '|')
-					submenu->timestamp = 0;
-				else
-					submenu->timestamp = 1;	/* there's no automatic reloading */
-			}
-		} else {
-			submenu = NULL;
-		}
+		submenu = constructMenuFromPipe(menu, entry, path, False);
 	} else {
-		/* try interpreting path as a proplist file */
-		submenu = constructPLMenu(menu->vscr, path[0]);
+		submenu = NULL;
 
-		/* if unsuccessful, try it as an old-style file */
-		if (!submenu) {
-			i = 0;
-			while (path[i] != NULL) {
-				char *tmp;
+		/* the proplist file is looked for with the path as it was written */
+		plpath = wstrdup(path[0]);
 
-				if (strcmp(path[i], "-noext") == 0) {
-					i++;
-					continue;
-				}
+		i = 0;
+		while (path[i] != NULL) {
+			char *tmp;
 
-				tmp = wexpandpath(path[i]);
+			if (strcmp(path[i], "-noext") == 0) {
+				i++;
+				continue;
+			}
 
-				if (strstr(tmp, "#usergnusteppath#") == tmp)
-					tmp = wstrconcat(wusergnusteppath(),
-							  tmp + 17);
+			tmp = wexpandpath(path[i]);
 
-				wfree(path[i]);
-				lpath = getLocalizedMenuFile(tmp);
-				if (lpath) {
-					wfree(tmp);
-					path[i] = lpath;
-					lpath = NULL;
-				} else {
-					path[i] = tmp;
-				}
+			if (strstr(tmp, "#usergnusteppath#") == tmp)
+				tmp = wstrconcat(wusergnusteppath(),
+						  tmp + 17);
 
-				if (stat(path[i], &stat_buf) == 0) {
-					if (last < stat_buf.st_mtime)
-						last = stat_buf.st_mtime;
-					if (first < 0)
-						first = i;
-				} else {
-					werror(_("%s:could not stat menu"), path[i]);
-				}
+			wfree(path[i]);
+			lpath = getLocalizedMenuFile(tmp);
+			if (lpath) {
+				wfree(tmp);
+				path[i] = lpath;
+				lpath = NULL;
+			} else {
+				path[i] = tmp;
+			}
 
-				i++;
+			if (stat(path[i], &stat_buf) == 0) {
+				if (last < stat_buf.st_mtime)
+					last = stat_buf.st_mtime;
+				if (first < 0)
+					first = i;
+			} else {
+				werror(_("%s:could not stat menu"), path[i]);
 			}
 
-			if (first < 0) {
-				werror(_("%s:could not stat menu:%s"), "OPEN_MENU", (char *)entry->clientdata);
-				i = 0;
-				while (path[i] != NULL)
-					wfree(path[i++]);
+			i++;
+		}
 
-				wfree(path);
-				if (cmd)
-					wfree(cmd);
+		if (first < 0) {
+			werror(_("%s:could not stat menu:%s"), "OPEN_MENU", (char *)entry->clientdata);
+			i = 0;
+			while (path[i] != NULL)
+				wfree(path[i++]);
 
-				return;
-			}
+			wfree(path);
+			if (cmd)
+				wfree(cmd);
+			wfree(plpath);
 
-			stat(path[first], &stat_buf);
-			if (!menu->cascades[entry->cascade] ||
-			    menu->cascades[entry->cascade]->timestamp < last) {
-				if (S_ISDIR(stat_buf.st_mode)) {
-					/* menu directory */
-					submenu = readMenuDirectory(menu->vscr, entry->text, path, cmd);
-					if (submenu)
-						submenu->timestamp = last;
-				} else if (S_ISREG(stat_buf.st_mode)) {
-					/* menu file */
+			return;
+		}
 
+		/* the menu is only read again when one of the files was modified */
+		stat(path[first], &stat_buf);
+		if (!menu->cascades[entry->cascade] ||
+		    menu->cascades[entry->cascade]->timestamp < last) {
+			if (S_ISDIR(stat_buf.st_mode)) {
+				/* menu directory */
+				submenu = readMenuDirectory(menu->vscr, entry->text, path, cmd);
+				if (submenu)
+					submenu->timestamp = last;
+			} else if (S_ISREG(stat_buf.st_mode)) {
+				/* try interpreting path as a proplist file */
+				submenu = constructPLMenu(menu->vscr, plpath);
+
+				/* if unsuccessful, try it as an old-style file */
+				if (!submenu) {
 					if (cmd || path[1])
 						wwarning(_("too many parameters in OPEN_MENU: %s"),
 								(char *)entry->clientdata);
 
 					submenu = readMenuFile(menu->vscr, path[first]);
-					if (submenu)
-						submenu->timestamp = stat_buf.st_mtime;
-				} else {
-					submenu = NULL;
 				}
-			} else {
-				submenu = NULL;
+				if (submenu)
+					submenu->timestamp = stat_buf.st_mtime;
 			}
 		}
+		wfree(plpath);
 	}
 
 	if (submenu) {
@@ -779,19 +772,7 @@ static void constructPLMenuFromPipe(WMenu * menu, WMenuEntry * entry)
 
 	if (path[0][0] == '|') {
 		/* pipe menu */
-
-		if (!menu->cascades[entry->cascade]
-		|| menu->cascades[entry->cascade]->timestamp == 0) {
-			/* parse pipe */
-			submenu = readPLMenuPipe(menu->vscr, path);
-
-			if (submenu != NULL) {
-				if (path[0][1] == '|')
-					submenu->timestamp = 0;
-				else
-					submenu->timestamp = 1;	/* there's no automatic reloading */
-			}
-		}
+		submenu = constructMenuFromPipe(menu, entry, path, True);
 	}
 
 	if (submenu) {
@@ -1144,21 +1125,242 @@ static inline int generate_command_from_list(char *buffer, size_t buffer_size, c
 }
 
 /************    Menu Configuration From Pipe      *************/
-static WMenu *readPLMenuPipe(virtual_screen *vscr, char **file_name)
+
+/*
+ * The output of the pipe menu generators is kept, so that the menu can be
+ * built again without running the command. The command is run in the
+ * background by a child process, and the window manager keeps working
+ * while it writes its output. A menu opened during a refresh shows the
+ * output of the previous run.
+ */
+typedef struct MenuPipe {
+	struct MenuPipe *next;
+
+	char *command;			/* flat command, with the leading pipes */
+	char *output;			/* output of the last run */
+	size_t length;
+	time_t generation;		/* changed with the output, 0 before the first run */
+
+	/* run in progress */
+	pid_t pid;
+	int fd;
+	WMHandlerID handler;
+	WMHandlerID timer;
+	char *buffer;
+	size_t buffer_length;
+	size_t buffer_size;
+} MenuPipe;
+
+static MenuPipe *menuPipes = NULL;
+
+static MenuPipe *getMenuPipe(const char *command)
 {
-	WMPropList *plist = NULL;
-	WMenu *menu = NULL;
-	char *filename;
-	char flat_file[MAXLINE];
+	MenuPipe *mp;
 
-	if (generate_command_from_list(flat_file, sizeof(flat_file), file_name)) {
-		werror(_("could not open menu file \"%s\": %s"),
-		       file_name[0], _("pipe command for PropertyList is too long"));
-		return NULL;
+	for (mp = menuPipes; mp != NULL; mp = mp->next)
+		if (strcmp(mp->command, command) == 0)
+			return mp;
+
+	mp = wmalloc(sizeof(MenuPipe));
+	mp->command = wstrdup(command);
+	mp->fd = -1;
+	mp->next = menuPipes;
+	menuPipes = mp;
+
+	return mp;
+}
+
+static void closeMenuPipe(MenuPipe *mp)
+{
+	WMDeleteInputHandler(mp->handler);
+	mp->handler = NULL;
+	if (mp->timer) {
+		WMDeleteTimerHandler(mp->timer);
+		mp->timer = NULL;
+	}
+	close(mp->fd);
+	mp->fd = -1;
+}
+
+/* stop a command which runs for too long or writes too much, its output is not used */
+static void abortMenuPipe(MenuPipe *mp)
+{
+	/* the command has its own process group, see startMenuPipe() */
+	if (mp->pid > 0)
+		kill(-mp->pid, SIGKILL);
+
+	closeMenuPipe(mp);
+	wfree(mp->buffer);
+	mp->buffer = NULL;
+}
+
+static void menuPipeTimeout(void *data)
+{
+	MenuPipe *mp = (MenuPipe *) data;
+
+	mp->timer = NULL;
+	werror(_("menu command \"%s\" did not finish in %i seconds, killing it"),
+	       mp->command, MENU_PIPE_TIMEOUT / 1000);
+	abortMenuPipe(mp);
+}
+
+static void finishMenuPipe(MenuPipe *mp)
+{
+	closeMenuPipe(mp);
+
+	mp->buffer[mp->buffer_length] = 0;
+
+	/* keep the menus built from the old output if nothing changed */
+	if (mp->output && mp->length == mp->buffer_length &&
+	    memcmp(mp->output, mp->buffer, mp->length) == 0) {
+		wfree(mp->buffer);
+	} else {
+		if (mp->output)
+			wfree(mp->output);
+		mp->output = mp->buffer;
+		mp->length = mp->buffer_length;
+		mp->generation++;
 	}
 
-	filename = flat_file + (flat_file[1] == '|' ? 2 : 1);
-	plist = WMReadPropListFromPipe(filename);
+	mp->buffer = NULL;
+}
+
+static void readMenuPipeOutput(int fd, int mask, void *data)
+{
+	MenuPipe *mp = (MenuPipe *) data;
+	ssize_t count;
+
+	/* Parameter not used, but tell the compiler that it is ok */
+	(void) mask;
+
+	for (;;) {
+		if (mp->buffer_length > MENU_PIPE_MAX_OUTPUT) {
+			werror(_("the output of menu command \"%s\" is larger than %i bytes, ignoring it"),
+			       mp->command, MENU_PIPE_MAX_OUTPUT);
+			abortMenuPipe(mp);
+			return;
+		}
+
+		if (mp->buffer_size - mp->buffer_length < 1024) {
+			mp->buffer_size *= 2;
+			mp->buffer = wrealloc(mp->buffer, mp->buffer_size + 1);
+		}
+
+		count = read(fd, mp->buffer + mp->buffer_length, mp->buffer_size - mp->buffer_length);
+		if (count > 0) {
+			mp->buffer_length += count;
+			continue;
+		}
+
+		if (count < 0 && errno == EINTR)
+			continue;
+
+		if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return;
+
+		if (count < 0)
+			werror(_("error reading the output of menu command \"%s\": %s"),
+			       mp->command, strerror(errno));
+
+		/* end of the output */
+		finishMenuPipe(mp);
+		return;
+	}
+}
+
+static void startMenuPipe(virtual_screen *vscr, MenuPipe *mp)
+{
+	const char *command;
+	int filedes[2];
+	pid_t pid;
+
+	if (mp->fd >= 0)
+		return;
+
+	if (pipe(filedes) < 0) {
+		werror(_("could not open menu file \"%s\": %s"), mp->command, strerror(errno));
+		return;
+	}
+
+	command = mp->command + (mp->command[1] == '|' ? 2 : 1);
+
+	pid = fork();
+	if (pid < 0) {
+		werror(_("could not open menu file \"%s\": %s"), mp->command, strerror(errno));
+		close(filedes[0]);
+		close(filedes[1]);
+		return;
+	} else if (pid == 0) {
+		close(filedes[0]);
+
+		/* so that the commands it starts are killed with it on timeout */
+		setsid();
+
+		SetupEnvironment(vscr);
+
+		if (dup2(filedes[1], STDOUT_FILENO) < 0) {
+			werror(_("could not open menu file \"%s\": %s"), mp->command, strerror(errno));
+			exit(1);
+		}
+		close(filedes[1]);
+
+		execl("/bin/sh", "/bin/sh", "-c", command, NULL);
+		werror("could not execute %s -c %s", "/bin/sh", command);
+		exit(1);
+	}
+
+	/* the child is reaped by the SIGCHLD handler, only its output matters */
+	close(filedes[1]);
+	fcntl(filedes[0], F_SETFD, FD_CLOEXEC);
+	fcntl(filedes[0], F_SETFL, O_NONBLOCK);
+
+	mp->pid = pid;
+	mp->fd = filedes[0];
+	mp->buffer_size = 4096;
+	mp->buffer_length = 0;
+	mp->buffer = wmalloc(mp->buffer_size + 1);
+	mp->handler = WMAddInputHandler(mp->fd, WIReadMask, readMenuPipeOutput, mp);
+	mp->timer = WMAddTimerHandler(MENU_PIPE_TIMEOUT, menuPipeTimeout, mp);
+}
+
+/*
+ * Give a command which was just started the chance to finish, so that a
+ * fast generator shows its menu the first time it is opened.
+ */
+static void waitMenuPipe(MenuPipe *mp, int timeout)
+{
+	struct timeval start, now;
+	struct pollfd pfd;
+	int elapsed;
+
+	gettimeofday(&start, NULL);
+
+	while (mp->fd >= 0) {
+		gettimeofday(&now, NULL);
+		elapsed = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_usec - start.tv_usec) / 1000;
+		if (elapsed >= timeout)
+			return;
+
+		pfd.fd = mp->fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, timeout - elapsed) < 0) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+
+		if (pfd.revents)
+			readMenuPipeOutput(mp->fd, WIReadMask, mp);
+	}
+}
+
+static WMenu *readPLMenuPipe(virtual_screen *vscr, MenuPipe *mp)
+{
+	WMPropList *plist = NULL;
+	WMenu *menu = NULL;
+
+	plist = WMCreatePropListFromDescription(mp->output);
 	if (!plist)
 		return NULL;
 
@@ -1173,37 +1375,67 @@ static WMenu *readPLMenuPipe(virtual_screen *vscr, char **file_name)
 	return menu;
 }
 
-static WMenu *readMenuPipe(virtual_screen *vscr, char **file_name)
+static WMenu *readMenuPipe(virtual_screen *vscr, MenuPipe *mp)
 {
 	WMenu *menu = NULL;
 	FILE *file = NULL;
-	char *filename;
+
+	if (mp->length == 0)
+		return NULL;
+
+	file = fmemopen(mp->output, mp->length, "r");
+	if (!file) {
+		werror(_("could not open menu file \"%s\": %s"), mp->command, strerror(errno));
+		return NULL;
+	}
+
+	menu = readMenu(vscr, mp->command, file);
+	fclose(file);
+
+	return menu;
+}
+
+/*
+ * Returns the menu to put in place of the current cascade of the entry, or
+ * NULL to keep it.
+ *
+ * A menu opened with '||' is refreshed each time it is opened, one with a
+ * single '|' only when the root menu was read again. The cascade timestamp
+ * records which output it was built from.
+ */
+static WMenu *constructMenuFromPipe(WMenu *menu, WMenuEntry *entry, char **path, Bool plmenu)
+{
+	WMenu *cascade, *submenu;
+	MenuPipe *mp;
 	char flat_file[MAXLINE];
 
-	if (generate_command_from_list(flat_file, sizeof(flat_file), file_name)) {
+	if (generate_command_from_list(flat_file, sizeof(flat_file), path)) {
 		werror(_("could not open menu file \"%s\": %s"),
-		       file_name[0], _("pipe command is too long"));
+		       path[0], plmenu ? _("pipe command for PropertyList is too long") : _("pipe command is too long"));
 		return NULL;
 	}
 
-	filename = flat_file + (flat_file[1] == '|' ? 2 : 1);
+	mp = getMenuPipe(flat_file);
+	cascade = menu->cascades[entry->cascade];
 
-	/*
-	 * In case of memory problem, 'popen' will not set the errno, so we initialise it
-	 * to be able to display a meaningful message. For other problems, 'popen' will
-	 * properly set errno, so we'll still get a good message
-	 */
-	errno = ENOMEM;
-	file = popen(filename, "r");
-	if (!file) {
-		werror(_("could not open menu file \"%s\": %s"), filename, strerror(errno));
-		return NULL;
+	if (mp->generation == 0 || flat_file[1] == '|' || !cascade || cascade->timestamp == 0) {
+		startMenuPipe(menu->vscr, mp);
+		if (mp->generation == 0)
+			waitMenuPipe(mp, MENU_PIPE_WAIT);
 	}
 
-	menu = readMenu(vscr, flat_file, file);
-	pclose(file);
+	if (mp->generation == 0 || (cascade && cascade->timestamp == mp->generation))
+		return NULL;
+
+	if (plmenu)
+		submenu = readPLMenuPipe(menu->vscr, mp);
+	else
+		submenu = readMenuPipe(menu->vscr, mp);
+
+	if (submenu)
+		submenu->timestamp = mp->generation;
 
-	return menu;
+	return submenu;
 }
 
 typedef struct {
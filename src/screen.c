@@ -53,6 +53,7 @@
 #include "resources.h"
 #include "workspace.h"
 #include "session.h"
+#include "statefile.h"
 #include "balloon.h"
 #include "geomview.h"
 #include "wmspec.h"
@@ -970,7 +971,7 @@ void wScreenSaveState(virtual_screen *vscr)
 
 	str = get_wmstate_file(vscr);
 
-	if (!WMWritePropListToFile(w_global.session_state, str))
+	if (!wStateFileWrite(w_global.session_state, str))
 		werror(_("could not save session state in %s"), str);
 
 	wfree(str);
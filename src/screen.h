@@ -95,6 +95,14 @@ struct virtual_screen {
 		 */
 		Bool process_map_event;
 
+		/* Changes on screen since the last capture for the Workspace Map */
+		struct {
+			int last_captured;     /* workspace shown during the capture */
+			Bool dirty;            /* the whole screen must be read again */
+			XRectangle damage;     /* area of the screen that changed */
+			XID root_damage;       /* XDamage object of the root window, or None */
+		} map_state;
+
 		/* Menus */
 		struct WMenu *menu;     /* workspace operation */
 		struct WMenu *submenu;  /* workspace list for window_menu */
@@ -104,6 +112,7 @@ struct virtual_screen {
 	struct {
 		struct WAppIcon *icon;        /* The clip main icon, or the dock's, if they are merged */
 		WAppIconChain *global_icons;  /* Omnipresent icons chain in clip */
+		struct WDockSlots *global_slots; /* Slots used by the omnipresent icons */
 
 		int mapped;             /* The clip is mapped */
 	} clip;
@@ -130,6 +139,7 @@ struct virtual_screen {
 		struct WWindow *bfs_focused;     /* Window that had focus before
                                                   * another window entered fullscreen
                                                   */
+		struct WWindowSnapshot *snapshot; /* see winsnapshot.h */
 	} window;
 
 	struct {
@@ -250,6 +260,7 @@ struct WScreen {
 
 
     WMColor *icon_title_color;	       /* icon title color */
+    struct WIconTitleCache *icon_title_cache; /* rendered icon titles */
 
     GC icon_select_gc;
 
@@ -308,6 +319,7 @@ struct WScreen {
 
     int helper_fd;
     pid_t helper_pid;
+    struct BackgroundHelper *bg_helper;
 
     struct {
         unsigned int dnd_data_convertion_status:1;
@@ -76,7 +76,7 @@
 #include "session.h"
 #include "framewin.h"
 #include "workspace.h"
-#include "shell.h"
+#include "launchqueue.h"
 #include "properties.h"
 #include "application.h"
 #include "appicon.h"
@@ -324,26 +324,6 @@ void wSessionClearState(void)
 	WMRemoveFromPLDictionary(w_global.session_state, sWorkspace);
 }
 
-static pid_t execCommand(virtual_screen *vscr, char *command)
-{
-	pid_t pid;
-	char **argv;
-	int argc;
-
-	wtokensplit(command, &argv, &argc);
-
-	if (!argc)
-		return 0;
-
-	pid = execute_command2(vscr, argv, argc);
-
-	while (argc > 0)
-		wfree(argv[--argc]);
-
-	wfree(argv);
-	return pid;
-}
-
 static WSavedState *getWindowState(virtual_screen *vscr, WMPropList *win_state)
 {
 	WSavedState *state = wmalloc(sizeof(WSavedState));
@@ -426,7 +406,6 @@ void wSessionRestoreState(virtual_screen *vscr)
 	char *instance, *class, *command;
 	WMPropList *win_info, *apps, *cmd, *value;
 	WMPropList *sApplications, *sCommand, *sName, *sDock;
-	pid_t pid;
 	int i, count;
 	WDock *dock;
 	WAppIcon *btn = NULL;
@@ -508,20 +487,17 @@ void wSessionRestoreState(virtual_screen *vscr)
 				if (btn && is_same(instance, btn->wm_instance) &&
 				    is_same(class, btn->wm_class) &&
 				    is_same(command, btn->command) &&
-				    !btn->launching) {
+				    !btn->launching && !wLaunchQueueHasIcon(btn)) {
 					found = 1;
 					break;
 				}
 			}
 		}
 
-		if (found) {
-			wDockLaunchWithState(btn, state);
-		} else if ((pid = execCommand(vscr, command)) > 0) {
-			wWindowAddSavedState(instance, class, command, pid, state);
-		} else {
-			wfree(state);
-		}
+		if (found)
+			wLaunchQueueDockIcon(btn, state);
+		else
+			wLaunchQueueCommand(vscr, instance, class, command, state);
 
 		if (instance)
 			wfree(instance);
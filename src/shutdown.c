@@ -36,6 +36,7 @@
 #include "winspector.h"
 #include "wmspec.h"
 #include "colormap.h"
+#include "icon.h"
 #include "shutdown.h"
 
 
@@ -174,6 +175,7 @@ void RestoreDesktop(virtual_screen *vscr)
 	wColormapInstallForWindow(vscr, NULL);
 	PropCleanUp(vscr->screen_ptr->root_win);
 	wNETWMCleanup(vscr->screen_ptr);
+	wIconTitleCacheDestroy(vscr->screen_ptr);
 	XSync(dpy, 0);
 }
 
@@ -28,6 +28,7 @@
 #include <errno.h>
 #include <signal.h>
 #include <sys/wait.h>
+#include <sys/time.h>
 #ifdef __FreeBSD__
 #include <sys/signal.h>
 #endif
@@ -47,6 +48,10 @@
 #include <X11/extensions/Xrandr.h>
 #endif
 
+#ifdef USE_XDAMAGE
+#include <X11/extensions/Xdamage.h>
+#endif
+
 #include "WindowMaker.h"
 #include "GNUstep.h"
 #include "screen.h"
@@ -69,6 +74,7 @@
 #include "wmspec.h"
 #include "event.h"
 #include "switchmenu.h"
+#include "launchqueue.h"
 #ifdef USE_DOCK_XDND
 #include "xdnd.h"
 #endif
@@ -428,6 +434,10 @@ static void startup_set_defaults(void)
 	w_global.xext.randr.supported = XRRQueryExtension(dpy, &w_global.xext.randr.event_base, &foo);
 #endif
 
+#ifdef USE_XDAMAGE
+	w_global.xext.damage.supported = XDamageQueryExtension(dpy, &w_global.xext.damage.event_base, &foo);
+#endif
+
 #ifdef KEEP_XKB_LOCK_STATUS
 	w_global.xext.xkb.supported = XkbQueryExtension(dpy, NULL, &w_global.xext.xkb.event_base, NULL, NULL, NULL);
 	if (wPreferences.modelock && !w_global.xext.xkb.supported) {
@@ -597,6 +607,9 @@ void StartUp(Bool defaultScreenOnly)
 		menus_restore(w_global.vscreens[j]);
 		menus_restore_map(w_global.vscreens[j]);
 
+		/* the applications are started once the workspace is known */
+		wLaunchQueueHold();
+
 		/* If we're not restarting, restore session */
 		if (wPreferences.flags.restarting == 0 && !wPreferences.flags.norestore)
 			wSessionRestoreState(w_global.vscreens[j]);
@@ -610,6 +623,8 @@ void StartUp(Bool defaultScreenOnly)
 			wWorkspaceForceChange(w_global.vscreens[j], lastDesktop);
 		else
 			wSessionRestoreLastWorkspace(w_global.vscreens[j]);
+
+		wLaunchQueueRelease();
 	}
 
 #ifndef HAVE_INOTIFY
@@ -638,7 +653,7 @@ static void remove_icon_windows(Window *children, unsigned int nchildren)
 		if (children[i] == None)
 			continue;
 
-		wmhints = XGetWMHints(dpy, children[i]);
+		wmhints = PropGetWMHints(children[i]);
 		if (wmhints && (wmhints->flags & IconWindowHint)) {
 			for (j = 0; j < nchildren; j++) {
 				if (children[j] == wmhints->icon_window) {
@@ -673,6 +688,20 @@ static void hide_all_applications(virtual_screen *vscr)
 	}
 }
 
+#ifdef DEBUG_STARTUP
+static long elapsedSince(struct timeval *start)
+{
+	struct timeval now;
+	long elapsed;
+
+	gettimeofday(&now, NULL);
+	elapsed = (now.tv_sec - start->tv_sec) * 1000000L + (now.tv_usec - start->tv_usec);
+	*start = now;
+
+	return elapsed;
+}
+#endif
+
 /*
  *-----------------------------------------------------------------------
  * manageAllWindows--
@@ -682,6 +711,10 @@ static void hide_all_applications(virtual_screen *vscr)
  * 	Called when the wm is being started.
  *	No events can be processed while the windows are being
  * reparented/managed.
+ *	The attributes and properties of all the windows are read at once
+ * with the server grabbed, then each window is managed with its own
+ * short grab in wManageWindow(), so the display is not frozen for the
+ * whole time.
  *-----------------------------------------------------------------------
  */
 static void manageAllWindows(virtual_screen *vscr, int crashRecovery)
@@ -692,15 +725,28 @@ static void manageAllWindows(virtual_screen *vscr, int crashRecovery)
 	WWindow *wwin;
 	unsigned int i, nchildren;
 	int border;
+#ifdef DEBUG_STARTUP
+	struct timeval start;
+
+	gettimeofday(&start, NULL);
+#endif
 
 	XGrabServer(dpy);
 	XQueryTree(dpy, scr->root_win, &root, &parent, &children, &nchildren);
 
 	w_global.startup.phase1 = 1;
 
+	PropPrefetchClientProps(children, nchildren);
+
 	/* first remove all icon windows */
 	remove_icon_windows(children, nchildren);
 
+	XUngrabServer(dpy);
+
+#ifdef DEBUG_STARTUP
+	wmessage("%u windows read in %ld us", nchildren, elapsedSince(&start));
+#endif
+
 	for (i = 0; i < nchildren; i++) {
 		if (children[i] == None)
 			continue;
@@ -736,11 +782,20 @@ static void manageAllWindows(virtual_screen *vscr, int crashRecovery)
 		}
 	}
 
-	XUngrabServer(dpy);
+	/* the icon windows and those which were not managed */
+	PropReleaseClientProps(None);
+
+#ifdef DEBUG_STARTUP
+	wmessage("windows managed in %ld us", elapsedSince(&start));
+#endif
 
 	/* hide apps */
 	hide_all_applications(vscr);
 
+#ifdef DEBUG_STARTUP
+	wmessage("applications hidden in %ld us", elapsedSince(&start));
+#endif
+
 	XFree(children);
 
 	w_global.startup.phase1 = 0;
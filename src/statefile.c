@@ -0,0 +1,364 @@
+/* statefile.c - write the state files only when they change
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * The WMState and WMWindowAttributes files are saved each time an icon
+ * is docked, moved or given a new image, and most of these saves do not
+ * change anything. Writing the file is slow when the home directory is
+ * on the network, so the text of the last version written is remembered
+ * as a hash and the file is only written when the hash changes or when
+ * the file was changed by somebody else.
+ *
+ * The files are written by a thread, so that the event loop does not wait
+ * for the disk. Saves made while the thread is busy with a file replace
+ * each other, only the last one is written.
+ */
+
+#include "wconfig.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <WINGs/WUtil.h>
+
+#include "WindowMaker.h"
+#include "statefile.h"
+
+typedef struct StateFile {
+	struct StateFile *next;		/* in the queue of the writer */
+	char *path;
+
+	/* the contents last asked for */
+	unsigned long hash;
+	size_t length;
+
+	/* the file as it was left by the last write */
+	Bool written;
+	dev_t dev;
+	ino_t ino;
+	time_t mtime;
+	off_t size;
+
+	char *pending;			/* text waiting for the writer */
+	Bool queued;
+	Bool writing;
+} StateFile;
+
+static WMHashTable *stateFiles = NULL;
+static mode_t fileMode;
+
+#ifdef HAVE_PTHREAD
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;		/* a file was queued */
+	pthread_cond_t done;		/* a file was written */
+	StateFile *queue_head, *queue_tail;
+	int writing;
+
+	Bool initialized;
+	Bool running;
+} writer = {
+	PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_COND_INITIALIZER,
+	PTHREAD_COND_INITIALIZER,
+	NULL, NULL, 0,
+	False, False
+};
+
+#define LOCK_WRITER()	pthread_mutex_lock(&writer.lock)
+#define UNLOCK_WRITER()	pthread_mutex_unlock(&writer.lock)
+#else
+#define LOCK_WRITER()
+#define UNLOCK_WRITER()
+#endif
+
+
+static unsigned long hashText(const char *text, size_t length)
+{
+	unsigned long hash = 2166136261UL;
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		hash ^= (unsigned char) text[i];
+		hash *= 16777619UL;
+	}
+
+	return hash;
+}
+
+/*
+ * Same as WMWritePropListToFile(), which can not be used from the writer
+ * thread: it needs the property list, which the main thread goes on
+ * changing, and it changes the umask of the whole process while it runs.
+ */
+static Bool writeFile(const char *path, const char *text, size_t length, struct stat *stbuf)
+{
+	char *tmp;
+	ssize_t count;
+	size_t done;
+	int fd;
+
+	if (!wmkdirhier(path))
+		return False;
+
+	/* same filesystem as the destination, so that rename() works */
+	tmp = wstrconcat(path, ".XXXXXX");
+#ifdef HAVE_MKSTEMP
+	fd = mkstemp(tmp);
+	if (fd >= 0)
+		fchmod(fd, fileMode);
+#else
+	if (mktemp(tmp) != NULL)
+		fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL, fileMode);
+	else
+		fd = -1;
+#endif
+	if (fd < 0) {
+		werror(_("could not create a temporary file for %s: %s"), path, strerror(errno));
+		wfree(tmp);
+		return False;
+	}
+
+	for (done = 0; done < length; done += count) {
+		count = write(fd, text + done, length - done);
+		if (count < 0) {
+			if (errno == EINTR) {
+				count = 0;
+				continue;
+			}
+			break;
+		}
+	}
+
+	if (done < length || fsync(fd) < 0) {
+		werror(_("writing to file %s failed: %s"), tmp, strerror(errno));
+		close(fd);
+		goto failure;
+	}
+
+	if (close(fd) < 0) {
+		werror(_("writing to file %s failed: %s"), tmp, strerror(errno));
+		goto failure;
+	}
+
+	if (rename(tmp, path) < 0) {
+		werror(_("rename(\"%s\", \"%s\") failed: %s"), tmp, path, strerror(errno));
+		goto failure;
+	}
+	wfree(tmp);
+
+	return stat(path, stbuf) == 0;
+
+ failure:
+	unlink(tmp);
+	wfree(tmp);
+	return False;
+}
+
+static void recordFile(StateFile *file, Bool written, const struct stat *stbuf)
+{
+	file->written = written;
+	if (written) {
+		file->dev = stbuf->st_dev;
+		file->ino = stbuf->st_ino;
+		file->mtime = stbuf->st_mtime;
+		file->size = stbuf->st_size;
+	}
+}
+
+/* tells if the file is still the one left by the last write */
+static Bool fileIsUnchanged(StateFile *file)
+{
+	struct stat stbuf;
+
+	if (!file->written || stat(file->path, &stbuf) < 0)
+		return False;
+
+	return (stbuf.st_dev == file->dev && stbuf.st_ino == file->ino &&
+		stbuf.st_mtime == file->mtime && stbuf.st_size == file->size);
+}
+
+#ifdef HAVE_PTHREAD
+
+static void *writerThread(void *data)
+{
+	StateFile *file;
+	struct stat stbuf;
+	char *text;
+	Bool written;
+
+	/* Parameter not used, but tell the compiler that it is ok */
+	(void) data;
+
+	for (;;) {
+		LOCK_WRITER();
+		while (!writer.queue_head)
+			pthread_cond_wait(&writer.cond, &writer.lock);
+
+		file = writer.queue_head;
+		writer.queue_head = file->next;
+		if (!writer.queue_head)
+			writer.queue_tail = NULL;
+		file->next = NULL;
+		file->queued = False;
+		file->writing = True;
+		writer.writing++;
+
+		text = file->pending;
+		file->pending = NULL;
+		UNLOCK_WRITER();
+
+		written = writeFile(file->path, text, strlen(text), &stbuf);
+		wfree(text);
+
+		LOCK_WRITER();
+		recordFile(file, written, &stbuf);
+		file->writing = False;
+		writer.writing--;
+		pthread_cond_broadcast(&writer.done);
+		UNLOCK_WRITER();
+	}
+
+	return NULL;
+}
+
+static void startWriter(void)
+{
+	sigset_t all, old;
+	pthread_t thread;
+
+	writer.initialized = True;
+
+	/* the signals are handled by the main thread */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	if (pthread_create(&thread, NULL, writerThread, NULL) == 0) {
+		pthread_detach(thread);
+		writer.running = True;
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (!writer.running)
+		wwarning(_("could not start the state file writer thread, files will be written synchronously"));
+}
+
+#endif /* HAVE_PTHREAD */
+
+Bool wStateFileWrite(WMPropList *plist, const char *path)
+{
+	StateFile *file;
+	struct stat stbuf;
+	char *text;
+	size_t length;
+	unsigned long hash;
+	Bool result;
+
+	if (!stateFiles) {
+		stateFiles = WMCreateHashTable(WMStringPointerHashCallbacks);
+
+		/* the only way to know the umask is to change it */
+		fileMode = umask(0);
+		umask(fileMode);
+		fileMode = 0666 & ~fileMode;
+	}
+
+#ifdef HAVE_PTHREAD
+	if (!writer.initialized)
+		startWriter();
+#endif
+
+	file = WMHashGet(stateFiles, path);
+	if (!file) {
+		file = wmalloc(sizeof(StateFile));
+		file->path = wstrdup(path);
+		WMHashInsert(stateFiles, file->path, file);
+	}
+
+	text = wstrappend(WMGetPropListDescription(plist, True), "\n");
+	length = strlen(text);
+	hash = hashText(text, length);
+
+	LOCK_WRITER();
+	if (file->length == length && file->hash == hash &&
+	    (file->queued || file->writing || fileIsUnchanged(file))) {
+		wfree(text);
+		text = NULL;
+	} else {
+		file->length = length;
+		file->hash = hash;
+	}
+
+#ifdef HAVE_PTHREAD
+	if (writer.running) {
+		if (text) {
+			if (file->pending)
+				wfree(file->pending);
+			file->pending = text;
+
+			if (!file->queued) {
+				if (writer.queue_tail)
+					writer.queue_tail->next = file;
+				else
+					writer.queue_head = file;
+				writer.queue_tail = file;
+				file->queued = True;
+				pthread_cond_signal(&writer.cond);
+			}
+		}
+		UNLOCK_WRITER();
+
+		return True;
+	}
+#endif
+	UNLOCK_WRITER();
+
+	if (!text)
+		return True;
+
+	result = writeFile(path, text, length, &stbuf);
+	recordFile(file, result, &stbuf);
+	wfree(text);
+
+	return result;
+}
+
+void wStateFileFlush(void)
+{
+#ifdef HAVE_PTHREAD
+	if (!writer.running)
+		return;
+
+	LOCK_WRITER();
+	while (writer.queue_head || writer.writing > 0)
+		pthread_cond_wait(&writer.done, &writer.lock);
+	UNLOCK_WRITER();
+#endif
+}
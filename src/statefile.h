@@ -0,0 +1,36 @@
+/*
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef WMSTATEFILE_H_
+#define WMSTATEFILE_H_
+
+#include <WINGs/WUtil.h>
+
+/*
+ * Save the property list in the file. Nothing is written if the file
+ * already holds the same contents. The file is written in the background
+ * when possible, the result then only tells if the write was scheduled.
+ */
+Bool wStateFileWrite(WMPropList *plist, const char *path);
+
+/* wait until all the files written in the background are on the disk */
+void wStateFileFlush(void);
+
+#endif /* WMSTATEFILE_H_ */
@@ -38,6 +38,29 @@
 static void bevelImage(RImage *image, int relief);
 static RImage *get_texture_image(virtual_screen *vscr, const char *pixmap_file);
 static WTexture *parse_texture(virtual_screen *vscr, WMPropList *pl);
+static void texture_cache_forget(WTexture *texture);
+
+/*
+ * Images already rendered for a texture, most recently used first. The same
+ * textures are rendered over and over with the same sizes (menu entries,
+ * titlebars, icon tiles...), so a copy of the result is kept here.
+ */
+typedef struct TextureCacheEntry {
+	struct TextureCacheEntry *next;
+
+	WTexture *texture;
+	int width;
+	int height;
+	int relief;
+
+	RImage *image;
+	size_t size;
+} TextureCacheEntry;
+
+static struct {
+	TextureCacheEntry *entries;
+	size_t size;
+} texture_cache;
 
 WTexSolid *wTextureMakeSolid(virtual_screen *vscr, XColor *color)
 {
@@ -126,6 +149,8 @@ void wTextureDestroy(virtual_screen *vscr, WTexture *texture)
 	int count = 0;
 	unsigned long colors[8];
 
+	texture_cache_forget(texture);
+
 	/* some stupid servers don't like white or black being freed... */
 #define CANFREE(c) (c!=scr->black_pixel && c!=scr->white_pixel && c!=0)
 	switch (texture->any.type) {
@@ -360,12 +385,101 @@ static RImage *get_texture_image(virtual_screen *vscr, const char *pixmap_file)
 	return image;
 }
 
+static void texture_cache_free_entry(TextureCacheEntry *entry)
+{
+	texture_cache.size -= entry->size;
+	RReleaseImage(entry->image);
+	wfree(entry);
+}
+
+static void texture_cache_forget(WTexture *texture)
+{
+	TextureCacheEntry **prev = &texture_cache.entries;
+
+	while (*prev) {
+		TextureCacheEntry *entry = *prev;
+
+		if (entry->texture == texture) {
+			*prev = entry->next;
+			texture_cache_free_entry(entry);
+		} else {
+			prev = &entry->next;
+		}
+	}
+}
+
+static RImage *texture_cache_lookup(WTexture *texture, int width, int height, int relief)
+{
+	TextureCacheEntry **prev = &texture_cache.entries;
+	TextureCacheEntry *entry;
+
+	for (entry = *prev; entry; prev = &entry->next, entry = entry->next) {
+		if (entry->texture == texture && entry->width == width
+		    && entry->height == height && entry->relief == relief)
+			break;
+	}
+	if (!entry)
+		return NULL;
+
+	/* move it to the front */
+	*prev = entry->next;
+	entry->next = texture_cache.entries;
+	texture_cache.entries = entry;
+
+	/* the callers draw on the image they get, so they get a copy */
+	return RCloneImage(entry->image);
+}
+
+static void texture_cache_store(WTexture *texture, int width, int height, int relief, RImage *image)
+{
+	TextureCacheEntry *entry, **prev;
+	size_t size;
+
+	size = (size_t) image->width * image->height * (image->format == RRGBAFormat ? 4 : 3);
+
+	/* big images would push everything else out for little gain */
+	if (size > TEXTURE_CACHE_SIZE / 4)
+		return;
+
+	entry = wmalloc(sizeof(TextureCacheEntry));
+	entry->image = RCloneImage(image);
+	if (!entry->image) {
+		wfree(entry);
+		return;
+	}
+
+	entry->texture = texture;
+	entry->width = width;
+	entry->height = height;
+	entry->relief = relief;
+	entry->size = size;
+
+	entry->next = texture_cache.entries;
+	texture_cache.entries = entry;
+	texture_cache.size += size;
+
+	/* drop the least recently used images until it fits */
+	while (texture_cache.size > TEXTURE_CACHE_SIZE) {
+		prev = &texture_cache.entries;
+		while ((*prev)->next)
+			prev = &(*prev)->next;
+
+		texture_cache_free_entry(*prev);
+		*prev = NULL;
+	}
+}
+
 RImage *wTextureRenderImage(WTexture *texture, int width, int height, int relief)
 {
 	RImage *image = NULL;
 	RColor color1;
 	int d;
 	int subtype;
+	Bool cache;
+
+	image = texture_cache_lookup(texture, width, height, relief);
+	if (image)
+		return image;
 
 	switch (texture->any.type) {
 	case WTEX_SOLID:
@@ -466,6 +580,8 @@ RImage *wTextureRenderImage(WTexture *texture, int width, int height, int relief
 		break;
 	}
 
+	cache = (image != NULL);
+
 	if (!image) {
 		RColor gray;
 
@@ -516,6 +632,10 @@ RImage *wTextureRenderImage(WTexture *texture, int width, int height, int relief
 	else if (d < 0)
 		bevelImage(image, -d);
 
+	/* the gray replacement is not kept, so it is tried again next time */
+	if (cache)
+		texture_cache_store(texture, width, height, relief, image);
+
 	return image;
 }
 
@@ -0,0 +1,631 @@
+/* thumbnail.c - live window thumbnails
+ *
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * The mini-previews of the miniwindows and the images of the workspace map
+ * are scaled down copies of what is on the screen. Instead of reading back
+ * the whole window when they are needed, we keep them up to date while the
+ * window is visible: the XDamage extension tells us which part of a client
+ * window changed, and only that part is read back and scaled down, from an
+ * idle handler so that the event processing is not delayed.
+ *
+ * When XDamage is not available, the thumbnails are captured completely
+ * each time they are requested, as it was done before.
+ *
+ * The windows are only followed while the mini-previews are enabled, the
+ * damage events and the read backs cost something for nothing otherwise.
+ *
+ * The workspace map follows the damage of the whole root window instead,
+ * which includes what we draw ourselves, like the titlebars and the icons,
+ * and the override-redirect windows. The damage object is only created
+ * the first time the map is captured.
+ */
+
+#include "wconfig.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#ifdef USE_XDAMAGE
+#include <X11/extensions/Xdamage.h>
+#endif
+
+#include <WINGs/WUtil.h>
+#include <wraster.h>
+
+#include "WindowMaker.h"
+#include "window.h"
+#include "framewin.h"
+#include "screen.h"
+#include "icon.h"
+#include "thumbnail.h"
+
+/* delay between a damage and the refresh of the thumbnail, in ms */
+#define THUMBNAIL_REFRESH_DELAY  500
+
+/* maximum amount of pixels read back from the server in a single request */
+#define THUMBNAIL_CAPTURE_CHUNK  (1024 * 1024)
+
+typedef struct WThumbnail {
+	WWindow *wwin;
+#ifdef USE_XDAMAGE
+	Damage damage;
+#endif
+	RImage *image;                  /* scaled down contents of the client */
+	unsigned int src_width;         /* size of the client window when */
+	unsigned int src_height;        /* the image was created */
+	XRectangle dirty;               /* area of the client that changed */
+} WThumbnail;
+
+static WMArray *thumbnails = NULL;
+static WMHandlerID refresh_timer = NULL;
+static WMHandlerID refresh_idle = NULL;
+
+
+#ifdef USE_XDAMAGE
+static void rect_union(XRectangle *rect, int x, int y, int width, int height)
+{
+	int x2, y2;
+
+	if (width <= 0 || height <= 0)
+		return;
+
+	if (rect->width == 0 || rect->height == 0) {
+		rect->x = x;
+		rect->y = y;
+		rect->width = width;
+		rect->height = height;
+		return;
+	}
+
+	x2 = WMAX(rect->x + rect->width, x + width);
+	y2 = WMAX(rect->y + rect->height, y + height);
+	rect->x = WMIN(rect->x, x);
+	rect->y = WMIN(rect->y, y);
+	rect->width = x2 - rect->x;
+	rect->height = y2 - rect->y;
+}
+#endif
+
+static void rect_clip(XRectangle *rect, int x, int y, int width, int height)
+{
+	int x1, y1, x2, y2;
+
+	x1 = WMAX(rect->x, x);
+	y1 = WMAX(rect->y, y);
+	x2 = WMIN(rect->x + rect->width, x + width);
+	y2 = WMIN(rect->y + rect->height, y + height);
+
+	if (x2 <= x1 || y2 <= y1) {
+		rect->width = rect->height = 0;
+		return;
+	}
+
+	rect->x = x1;
+	rect->y = y1;
+	rect->width = x2 - x1;
+	rect->height = y2 - y1;
+}
+
+/*
+ * Average the pixels of 'src', which holds the area starting at (sx, sy) of a
+ * drawable of size src_w x src_h, into the rows [ty0, ty1) and columns
+ * [tx0, tx1) of the scaled down image 'dst'
+ */
+static void box_scale_area(RImage *src, int sx, int sy, int src_w, int src_h,
+			   RImage *dst, int tx0, int ty0, int tx1, int ty1)
+{
+	int src_ch = (src->format == RRGBAFormat) ? 4 : 3;
+	int dst_ch = (dst->format == RRGBAFormat) ? 4 : 3;
+	int tx, ty, x, y;
+
+	for (ty = ty0; ty < ty1; ty++) {
+		int ys = ty * src_h / dst->height - sy;
+		int ye = (ty + 1) * src_h / dst->height - sy;
+
+		if (ye <= ys)
+			ye = ys + 1;
+		if (ys < 0)
+			ys = 0;
+		if (ye > src->height)
+			ye = src->height;
+
+		for (tx = tx0; tx < tx1; tx++) {
+			int xs = tx * src_w / dst->width - sx;
+			int xe = (tx + 1) * src_w / dst->width - sx;
+			unsigned long r = 0, g = 0, b = 0, n;
+			unsigned char *d;
+
+			if (xe <= xs)
+				xe = xs + 1;
+			if (xs < 0)
+				xs = 0;
+			if (xe > src->width)
+				xe = src->width;
+
+			if (xe <= xs || ye <= ys)
+				continue;
+
+			for (y = ys; y < ye; y++) {
+				unsigned char *s = src->data + (y * src->width + xs) * src_ch;
+
+				for (x = xs; x < xe; x++, s += src_ch) {
+					r += s[0];
+					g += s[1];
+					b += s[2];
+				}
+			}
+
+			n = (xe - xs) * (ye - ys);
+			d = dst->data + (ty * dst->width + tx) * dst_ch;
+			d[0] = r / n;
+			d[1] = g / n;
+			d[2] = b / n;
+			if (dst_ch == 4)
+				d[3] = 255;
+		}
+	}
+}
+
+/*
+ * Read back the 'area' of the drawable (which is src_w x src_h in size) and
+ * update the matching part of the scaled image 'dst'. The area is grown so
+ * that it covers complete pixels of the scaled image, and it is read in
+ * bands so that huge drawables do not need a huge temporary image.
+ */
+static Bool capture_area(WScreen *scr, Drawable d, XRectangle *area,
+			 int src_w, int src_h, RImage *dst)
+{
+	int tx0, ty0, tx1, ty1, band, ty;
+
+	tx0 = area->x * dst->width / src_w;
+	ty0 = area->y * dst->height / src_h;
+	tx1 = ((area->x + area->width) * dst->width + src_w - 1) / src_w;
+	ty1 = ((area->y + area->height) * dst->height + src_h - 1) / src_h;
+
+	tx1 = WMIN(tx1, dst->width);
+	ty1 = WMIN(ty1, dst->height);
+	if (tx1 <= tx0 || ty1 <= ty0)
+		return True;
+
+	/* number of thumbnail rows read in one request */
+	band = THUMBNAIL_CAPTURE_CHUNK / (src_w * (src_h / dst->height + 1));
+	if (band < 1)
+		band = 1;
+
+	for (ty = ty0; ty < ty1; ty += band) {
+		int tyend = WMIN(ty + band, ty1);
+		int sx0, sy0, sx1, sy1;
+		RXImage *ximg;
+		RImage *img;
+
+		/* the columns covered by the grown area start and end in 'area' */
+		sx0 = area->x;
+		sx1 = area->x + area->width;
+		sy0 = WMAX(area->y, ty * src_h / dst->height);
+		sy1 = WMIN(area->y + area->height, WMAX(tyend * src_h / dst->height, sy0 + 1));
+		if (sy1 <= sy0)
+			continue;
+
+		ximg = RGetXImage(scr->rcontext, d, sx0, sy0, sx1 - sx0, sy1 - sy0);
+		if (!ximg)
+			return False;
+
+		img = RCreateImageFromXImage(scr->rcontext, ximg->image, NULL);
+		RDestroyXImage(scr->rcontext, ximg);
+		if (!img)
+			return False;
+
+		box_scale_area(img, sx0, sy0, src_w, src_h, dst, tx0, ty, tx1, tyend);
+		RReleaseImage(img);
+	}
+
+	return True;
+}
+
+/*
+ * Bring the thumbnail up to date by reading back the changed area of the
+ * client window. Only the part of the client that is on the screen can be
+ * read, the rest of the thumbnail is left as it was.
+ */
+static Bool thumbnail_refresh(WThumbnail *thumb)
+{
+	WWindow *wwin = thumb->wwin;
+	WScreen *scr = wwin->vscr->screen_ptr;
+	XWindowAttributes attribs;
+	XRectangle area;
+	Window child;
+	int size, x, y;
+
+	if (!XGetWindowAttributes(dpy, wwin->client_win, &attribs) ||
+	    attribs.map_state != IsViewable)
+		return False;
+
+	size = wPreferences.minipreview_size - 2 * MINIPREVIEW_BORDER;
+	if (size < 1)
+		return False;
+
+	if (!thumb->image || thumb->image->width != size ||
+	    thumb->src_width != attribs.width || thumb->src_height != attribs.height) {
+		RColor black = { 0, 0, 0, 255 };
+
+		if (thumb->image)
+			RReleaseImage(thumb->image);
+
+		thumb->image = RCreateImage(size, size, False);
+		if (!thumb->image)
+			return False;
+
+		RClearImage(thumb->image, &black);
+		thumb->src_width = attribs.width;
+		thumb->src_height = attribs.height;
+		thumb->dirty.x = 0;
+		thumb->dirty.y = 0;
+		thumb->dirty.width = attribs.width;
+		thumb->dirty.height = attribs.height;
+	}
+
+#ifdef USE_XDAMAGE
+	/* Changes made from now on will be reported again */
+	if (thumb->damage != None)
+		XDamageSubtract(dpy, thumb->damage, None, None);
+#endif
+
+	XTranslateCoordinates(dpy, wwin->client_win, scr->root_win, 0, 0, &x, &y, &child);
+
+	area = thumb->dirty;
+	rect_clip(&area, 0, 0, thumb->src_width, thumb->src_height);
+	rect_clip(&area, -x, -y, scr->scr_width, scr->scr_height);
+	thumb->dirty.width = thumb->dirty.height = 0;
+
+	if (area.width == 0 || area.height == 0)
+		return True;
+
+	return capture_area(scr, wwin->client_win, &area, thumb->src_width, thumb->src_height, thumb->image);
+}
+
+static Bool thumbnail_can_refresh(WThumbnail *thumb)
+{
+	WWindow *wwin = thumb->wwin;
+
+	if (thumb->dirty.width == 0 || thumb->dirty.height == 0)
+		return False;
+
+	if (!wwin->flags.mapped || wwin->flags.shaded || wwin->flags.miniaturized ||
+	    wwin->flags.hidden || !wwin->flags.fully_visible)
+		return False;
+
+	return (wwin->frame->workspace == wwin->vscr->workspace.current || IS_OMNIPRESENT(wwin));
+}
+
+static void refresh_idle_handler(void *data)
+{
+	WMArrayIterator iter;
+	WThumbnail *thumb;
+	Bool found = False;
+
+	/* Parameter not used, but tell the compiler that it is ok */
+	(void) data;
+
+	refresh_idle = NULL;
+
+	/* refresh one window per call, to give the events a chance */
+	WM_ITERATE_ARRAY(thumbnails, thumb, iter) {
+		if (!thumbnail_can_refresh(thumb))
+			continue;
+
+		if (found) {
+			refresh_idle = WMAddIdleHandler(refresh_idle_handler, NULL);
+			break;
+		}
+
+		thumbnail_refresh(thumb);
+		found = True;
+	}
+}
+
+static void refresh_timer_handler(void *data)
+{
+	/* Parameter not used, but tell the compiler that it is ok */
+	(void) data;
+
+	refresh_timer = NULL;
+	if (!refresh_idle)
+		refresh_idle = WMAddIdleHandler(refresh_idle_handler, NULL);
+}
+
+static void schedule_refresh(void)
+{
+	if (!refresh_timer && !refresh_idle)
+		refresh_timer = WMAddTimerHandler(THUMBNAIL_REFRESH_DELAY, refresh_timer_handler, NULL);
+}
+
+void wThumbnailTrack(WWindow *wwin)
+{
+	WThumbnail *thumb;
+
+	if (!wPreferences.miniwin_preview_balloon)
+		return;
+
+	if (wwin->thumbnail || wwin->flags.internal_window)
+		return;
+
+	thumb = wmalloc(sizeof(WThumbnail));
+	thumb->wwin = wwin;
+	thumb->dirty.width = wwin->width;
+	thumb->dirty.height = wwin->height;
+
+#ifdef USE_XDAMAGE
+	if (w_global.xext.damage.supported)
+		thumb->damage = XDamageCreate(dpy, wwin->client_win, XDamageReportBoundingBox);
+#endif
+
+	if (!thumbnails)
+		thumbnails = WMCreateArray(16);
+
+	WMAddToArray(thumbnails, thumb);
+	wwin->thumbnail = thumb;
+}
+
+void wThumbnailUntrack(WWindow *wwin, Bool destroyed)
+{
+	WThumbnail *thumb = wwin->thumbnail;
+
+	if (!thumb)
+		return;
+
+#ifdef USE_XDAMAGE
+	/* the server already freed the damage with the window */
+	if (thumb->damage != None && !destroyed)
+		XDamageDestroy(dpy, thumb->damage);
+#else
+	/* Parameter not used, but tell the compiler that it is ok */
+	(void) destroyed;
+#endif
+
+	if (thumb->image)
+		RReleaseImage(thumb->image);
+
+	WMRemoveFromArray(thumbnails, thumb);
+	wfree(thumb);
+	wwin->thumbnail = NULL;
+}
+
+void wThumbnailVisibilityChanged(WWindow *wwin)
+{
+	if (wwin->thumbnail && thumbnail_can_refresh(wwin->thumbnail))
+		schedule_refresh();
+}
+
+/*
+ * Return in 'pixmap' the mini-preview of the window, suitable for the
+ * balloon of the miniwindow. The caller owns the pixmap.
+ * If error, returns -1. If OK, returns 0
+ */
+int wThumbnailGetPixmap(WWindow *wwin, Pixmap *pixmap)
+{
+	WThumbnail *thumb = wwin->thumbnail;
+	WThumbnail tmp;
+	Bool damage_supported = False;
+	int ret;
+
+#ifdef USE_XDAMAGE
+	damage_supported = w_global.xext.damage.supported;
+#endif
+
+	/* Windows we do not follow get a throw-away thumbnail */
+	if (!thumb) {
+		memset(&tmp, 0, sizeof(tmp));
+		tmp.wwin = wwin;
+		thumb = &tmp;
+	}
+
+	if (!damage_supported || thumb == &tmp) {
+		thumb->dirty.x = thumb->dirty.y = 0;
+		thumb->dirty.width = wwin->width;
+		thumb->dirty.height = wwin->height;
+	}
+
+	/* the server can only give us what is visible */
+	if (thumb->dirty.width > 0 && thumb->dirty.height > 0) {
+		XRaiseWindow(dpy, wwin->frame->core->window);
+		if (!thumbnail_refresh(thumb) && !thumb->image)
+			return -1;
+	}
+
+	if (!thumb->image)
+		return -1;
+
+	ret = RConvertImage(wwin->vscr->screen_ptr->rcontext, thumb->image, pixmap);
+
+	if (thumb == &tmp)
+		RReleaseImage(tmp.image);
+
+	return ret ? 0 : -1;
+}
+
+static void mark_workspace_maps_dirty(void)
+{
+	int i;
+
+	for (i = 0; i < w_global.vscreen_count; i++)
+		w_global.vscreens[i]->workspace.map_state.dirty = True;
+}
+
+/*
+ * Start or stop following the windows when the mini-previews are turned
+ * on or off in the preferences
+ */
+void wThumbnailUpdatePreferences(void)
+{
+	WWindow *wwin, *next;
+	int i;
+
+	for (i = 0; i < w_global.vscreen_count; i++) {
+		wwin = w_global.vscreens[i]->window.focused;
+		if (!wwin)
+			continue;
+
+		while (wwin->prev)
+			wwin = wwin->prev;
+
+		for (; wwin; wwin = next) {
+			next = wwin->next;
+			if (wPreferences.miniwin_preview_balloon)
+				wThumbnailTrack(wwin);
+			else
+				wThumbnailUntrack(wwin, False);
+		}
+	}
+
+	if (!wPreferences.miniwin_preview_balloon) {
+		if (refresh_timer) {
+			WMDeleteTimerHandler(refresh_timer);
+			refresh_timer = NULL;
+		}
+		if (refresh_idle) {
+			WMDeleteIdleHandler(refresh_idle);
+			refresh_idle = NULL;
+		}
+	}
+}
+
+/*
+ * Follow the events which can change the content of the screen, so that the
+ * workspace map only has to read back the areas that changed
+ */
+void wThumbnailHandleEvent(XEvent *event)
+{
+	static Atom root_pixmap = None;
+	WWindow *wwin;
+
+	switch (event->type) {
+	case MapNotify:
+	case UnmapNotify:
+	case ConfigureNotify:
+	case CirculateNotify:
+		mark_workspace_maps_dirty();
+		return;
+
+	case PropertyNotify:
+		if (root_pixmap == None)
+			root_pixmap = XInternAtom(dpy, "_XROOTPMAP_ID", False);
+
+		if (event->xproperty.atom == root_pixmap)
+			mark_workspace_maps_dirty();
+		return;
+	}
+
+#ifdef USE_XDAMAGE
+	if (w_global.xext.damage.supported && event->type == w_global.xext.damage.event_base + XDamageNotify) {
+		XDamageNotifyEvent *ev = (XDamageNotifyEvent *) event;
+		virtual_screen *vscr;
+		int i;
+
+		/* anything drawn on the screen, for the workspace map */
+		for (i = 0; i < w_global.vscreen_count; i++) {
+			vscr = w_global.vscreens[i];
+			if (vscr->workspace.map_state.root_damage == ev->damage) {
+				rect_union(&vscr->workspace.map_state.damage,
+					   ev->area.x, ev->area.y, ev->area.width, ev->area.height);
+				return;
+			}
+		}
+
+		wwin = wWindowFor(ev->drawable);
+		if (!wwin || !wwin->thumbnail || wwin->client_win != ev->drawable)
+			return;
+
+		/* with XDamageReportBoundingBox the area contains all the damage */
+		rect_union(&wwin->thumbnail->dirty, ev->area.x, ev->area.y, ev->area.width, ev->area.height);
+
+		if (thumbnail_can_refresh(wwin->thumbnail))
+			schedule_refresh();
+	}
+#else
+	/* Parameter not used, but tell the compiler that it is ok */
+	(void) wwin;
+#endif
+}
+
+/*
+ * Update the scaled copy of the screen kept for the current workspace in
+ * the workspace map, reading back only the areas that changed if possible
+ */
+void wThumbnailUpdateWorkspaceMap(virtual_screen *vscr, RImage **map, int width, int height)
+{
+	WScreen *scr = vscr->screen_ptr;
+	XRectangle area;
+	Bool full = True;
+
+	if (width < 1 || height < 1)
+		return;
+
+#ifdef USE_XDAMAGE
+	if (w_global.xext.damage.supported) {
+		if (vscr->workspace.map_state.root_damage == None)
+			vscr->workspace.map_state.root_damage = XDamageCreate(dpy, scr->root_win,
+									      XDamageReportBoundingBox);
+		else if (*map && (*map)->width == width && (*map)->height == height &&
+			 vscr->workspace.map_state.last_captured == vscr->workspace.current &&
+			 !vscr->workspace.map_state.dirty)
+			full = False;
+
+		/* what changes from now on will be reported again */
+		XDamageSubtract(dpy, vscr->workspace.map_state.root_damage, None, None);
+	}
+#endif
+
+	if (full) {
+		if (*map && ((*map)->width != width || (*map)->height != height)) {
+			RReleaseImage(*map);
+			*map = NULL;
+		}
+
+		area.x = 0;
+		area.y = 0;
+		area.width = scr->scr_width;
+		area.height = scr->scr_height;
+	} else {
+		area = vscr->workspace.map_state.damage;
+		rect_clip(&area, 0, 0, scr->scr_width, scr->scr_height);
+	}
+
+	vscr->workspace.map_state.dirty = False;
+	vscr->workspace.map_state.damage.width = 0;
+	vscr->workspace.map_state.damage.height = 0;
+	vscr->workspace.map_state.last_captured = vscr->workspace.current;
+
+	if (area.width == 0 || area.height == 0)
+		return;
+
+	if (!*map) {
+		*map = RCreateImage(width, height, False);
+		if (!*map)
+			return;
+	}
+
+	if (!capture_area(scr, scr->root_win, &area, scr->scr_width, scr->scr_height, *map))
+		vscr->workspace.map_state.dirty = True;
+}
@@ -65,6 +65,7 @@
 #include "osdep.h"
 #include "input.h"
 #include "shell.h"
+#include "thumbnail.h"
 
 #ifdef USER_MENU
 #include "usermenu.h"
@@ -343,8 +344,8 @@ static void discard_hints_from_gtk(WWindow *wwin)
 	unsigned long nb_item, nb_remain;
 	unsigned char *result;
 
-	status = XGetWindowProperty(dpy, wwin->client_win, w_global.atom.desktop.gtk_object_path, 0, 16, False,
-	                            AnyPropertyType, &type, &format, &nb_item, &nb_remain, &result);
+	status = PropGetWindowProperty(wwin->client_win, w_global.atom.desktop.gtk_object_path, 0, 16,
+	                               AnyPropertyType, &type, &format, &nb_item, &nb_remain, &result);
 	if (status != Success)
 	        return;
 
@@ -545,7 +546,7 @@ static void fixLeaderProperties(WWindow *wwin)
 	Bool haveCommand;
 
 	classHint = XAllocClassHint();
-	clientHints = XGetWMHints(dpy, wwin->client_win);
+	clientHints = PropGetWMHints(wwin->client_win);
 	pid = wNETWMGetPidForWindow(wwin->client_win);
 	if (pid > 0)
 		haveCommand = GetCommandForPid(pid, &argv, &argc);
@@ -1184,14 +1185,18 @@ WWindow *wManageWindow(virtual_screen *vscr, Window window)
 	XGrabServer(dpy);
 	XSync(dpy, False);
 
-	/* make sure the window is still there */
-	if (!XGetWindowAttributes(dpy, window, &wattribs)) {
+	/*
+	 * make sure the window is still there, and read all the properties
+	 * needed below at the same time
+	 */
+	if (!PropFetchClientProps(window, &wattribs)) {
 		XUngrabServer(dpy);
 		return NULL;
 	}
 
 	/* if it's an override-redirect, ignore it */
 	if (wattribs.override_redirect) {
+		PropReleaseClientProps(window);
 		XUngrabServer(dpy);
 		return NULL;
 	}
@@ -1200,6 +1205,7 @@ WWindow *wManageWindow(virtual_screen *vscr, Window window)
 
 	/* if it's startup and the window is unmapped, don't manage it */
 	if (w_global.startup.phase1 && wm_state < 0 && wattribs.map_state == IsUnmapped) {
+		PropReleaseClientProps(window);
 		XUngrabServer(dpy);
 		return NULL;
 	}
@@ -1243,12 +1249,12 @@ WWindow *wManageWindow(virtual_screen *vscr, Window window)
 	if (wwin->client_leader != None)
 		wwin->main_window = wwin->client_leader;
 
-	wwin->wm_hints = XGetWMHints(dpy, window);
+	wwin->wm_hints = PropGetWMHints(window);
 	withdraw = wwindow_set_wmhints(wwin, withdraw);
 
 	PropGetProtocols(window, &wwin->protocols);
 
-	if (!XGetTransientForHint(dpy, window, &wwin->transient_for)) {
+	if (!PropGetTransientFor(window, &wwin->transient_for)) {
 		wwin->transient_for = None;
 	} else {
 		if (wwin->transient_for == None || wwin->transient_for == window) {
@@ -1423,6 +1429,9 @@ WWindow *wManageWindow(virtual_screen *vscr, Window window)
 
 	wNETWMCheckInitialFrameState(wwin);
 
+	/* from now on the properties of the client may be changed by us */
+	PropReleaseClientProps(window);
+
 	/* setup button images */
 	wWindowUpdateButtonImages(wwin);
 
@@ -1508,6 +1517,9 @@ WWindow *wManageWindow(virtual_screen *vscr, Window window)
 	/* Setup Notification Observers */
 	WMAddNotificationObserver(appearanceObserver, wwin, WNWindowAppearanceSettingsChanged, wwin);
 
+	/* Keep the mini-preview of the window up to date */
+	wThumbnailTrack(wwin);
+
 	/*  Cleanup temporary stuff */
 	if (win_state)
 		wWindowDeleteSavedState(win_state);
@@ -1709,6 +1721,9 @@ void wUnmanageWindow(WWindow *wwin, Bool restore, Bool destroyed)
 	/* deselect window */
 	wSelectWindow(wwin, False);
 
+	/* stop following the contents of the window */
+	wThumbnailUntrack(wwin, destroyed);
+
 	/* remove all pending events on window */
 	/* I think this only matters for autoraise */
 	if (wPreferences.raise_delay)
@@ -1810,6 +1825,52 @@ void wWindowUnmap(WWindow *wwin)
 	XUnmapWindow(dpy, wwin->frame->core->window);
 }
 
+/*
+ * Same as wWindowMap() and wWindowUnmap() on many windows at once, for
+ * workspace switches. The clients are mapped before any frame and
+ * unmapped after all of them, so that no empty frame is ever seen.
+ */
+void wWindowMapList(WWindow **list, int count)
+{
+	WWindow *wwin;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		wwin = list[i];
+		if (!wwin->flags.shaded) {
+			/* window will be remapped when getting MapNotify */
+			XSelectInput(dpy, wwin->client_win, wwin->event_mask & ~StructureNotifyMask);
+			XMapWindow(dpy, wwin->client_win);
+			XSelectInput(dpy, wwin->client_win, wwin->event_mask);
+
+			wwin->flags.mapped = 1;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+		XMapWindow(dpy, list[i]->frame->core->window);
+}
+
+void wWindowUnmapList(WWindow **list, int count)
+{
+	WWindow *wwin;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		list[i]->flags.mapped = 0;
+		XUnmapWindow(dpy, list[i]->frame->core->window);
+	}
+
+	for (i = 0; i < count; i++) {
+		wwin = list[i];
+
+		/* prevent window withdrawal when getting UnmapNotify */
+		XSelectInput(dpy, wwin->client_win, wwin->event_mask & ~StructureNotifyMask);
+		XUnmapWindow(dpy, wwin->client_win);
+		XSelectInput(dpy, wwin->client_win, wwin->event_mask);
+	}
+}
+
 void wWindowSingleFocus(WWindow *wwin)
 {
 	int x, y, move = 0;
@@ -280,6 +280,7 @@ typedef struct WWindow {
 		unsigned int destroyed:1;	/* window was already destroyed */
 		unsigned int menu_open_for_me:1;/* window commands menu */
 		unsigned int obscured:1;	/* window is obscured */
+		unsigned int fully_visible:1;	/* window is not obscured at all */
 
 		unsigned int net_skip_pager:1;
 		unsigned int net_handle_icon:1;
@@ -288,6 +289,7 @@ typedef struct WWindow {
 	} flags;				/* state of the window */
 
 	struct WMiniWindow *miniwindow;
+	struct WThumbnail *thumbnail;		/* scaled down contents, see thumbnail.c */
 	char *title;				/* Window title */
 	Atom type;
 } WWindow;
@@ -379,6 +381,8 @@ void wWindowSetupInitialAttributes(WWindow *wwin, int *level, int *workspace);
 void wWindowUpdateGNUstepAttr(WWindow *wwin, GNUstepWMAttributes *attr);
 void wWindowMap(WWindow *wwin);
 void wWindowUnmap(WWindow *wwin);
+void wWindowMapList(WWindow **list, int count);
+void wWindowUnmapList(WWindow **list, int count);
 void wWindowDeleteSavedStatesForPID(pid_t pid);
 
 void wWindowAddSavedState(const char *instance, const char *class, const char *command,
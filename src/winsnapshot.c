@@ -0,0 +1,106 @@
+/*
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "wconfig.h"
+
+#include <X11/Xlib.h>
+
+#include "WindowMaker.h"
+#include "screen.h"
+#include "wcore.h"
+#include "framewin.h"
+#include "window.h"
+#include "winsnapshot.h"
+
+
+static void growSnapshot(WWindowSnapshot *snap, int size)
+{
+	snap->size = size;
+	snap->x = wrealloc(snap->x, size * sizeof(int));
+	snap->y = wrealloc(snap->y, size * sizeof(int));
+	snap->width = wrealloc(snap->width, size * sizeof(int));
+	snap->height = wrealloc(snap->height, size * sizeof(int));
+	snap->workspace = wrealloc(snap->workspace, size * sizeof(int));
+	snap->level = wrealloc(snap->level, size * sizeof(int));
+	snap->flags = wrealloc(snap->flags, size * sizeof(unsigned int));
+	snap->client = wrealloc(snap->client, size * sizeof(Window));
+	snap->wwin = wrealloc(snap->wwin, size * sizeof(WWindow *));
+}
+
+WWindowSnapshot *wWindowSnapshot(virtual_screen *vscr)
+{
+	WWindowSnapshot *snap = vscr->window.snapshot;
+	WWindow *wwin;
+	unsigned int flags;
+	int count;
+
+	if (!snap) {
+		snap = wmalloc(sizeof(WWindowSnapshot));
+		vscr->window.snapshot = snap;
+	}
+
+	count = 0;
+	for (wwin = vscr->window.focused; wwin; wwin = wwin->prev)
+		count++;
+
+	if (count > snap->size)
+		growSnapshot(snap, count + 16);
+
+	snap->count = 0;
+	for (wwin = vscr->window.focused; wwin; wwin = wwin->prev) {
+		int i = snap->count;
+
+		if (!wwin->frame)
+			continue;
+
+		snap->x[i] = wwin->frame_x;
+		snap->y[i] = wwin->frame_y;
+		snap->width[i] = wwin->frame->width;
+		snap->height[i] = wwin->frame->height;
+		snap->workspace[i] = wwin->frame->workspace;
+		snap->level[i] = wwin->frame->core->stacking->window_level;
+		snap->client[i] = wwin->client_win;
+		snap->wwin[i] = wwin;
+
+		flags = 0;
+		if (wwin->flags.mapped)
+			flags |= WSnapMapped;
+		if (wwin->flags.shaded)
+			flags |= WSnapShaded;
+		if (wwin->flags.miniaturized)
+			flags |= WSnapMiniaturized;
+		if (wwin->flags.hidden)
+			flags |= WSnapHidden;
+		if (wwin->flags.obscured)
+			flags |= WSnapObscured;
+		if (WFLAGP(wwin, sunken))
+			flags |= WSnapSunken;
+
+		if (wwin->flags.mapped ||
+		    (wwin->flags.shaded && wwin->frame->workspace == vscr->workspace.current &&
+		     !(wwin->flags.miniaturized || wwin->flags.hidden)))
+			flags |= WSnapVisible;
+
+		snap->flags[i] = flags;
+		snap->count++;
+	}
+
+	return snap;
+}
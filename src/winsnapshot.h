@@ -0,0 +1,75 @@
+/*
+ *  Window Maker window manager
+ *
+ *  Copyright (c) 2026 Window Maker Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef WMWINSNAPSHOT_H
+#define WMWINSNAPSHOT_H
+
+#include "window.h"
+
+/*
+ * Copy of the geometry and state of the windows of a virtual screen, one
+ * array per field, for the code which tests every window many times in a
+ * row, like the smart placement. Reading it does not touch the WWindow,
+ * WFrameWindow, WCoreWindow and WStacking structures of each window.
+ *
+ * It is filled again by wWindowSnapshot() and is only valid until the
+ * windows are changed, so it must not be kept across events.
+ */
+typedef struct WWindowSnapshot {
+	int count;			/* number of windows */
+	int size;			/* space in the arrays */
+
+	/* frame geometry */
+	int *x;
+	int *y;
+	int *width;
+	int *height;
+
+	int *workspace;
+	int *level;			/* stacking level */
+	unsigned int *flags;		/* WSnap* below */
+	Window *client;
+	WWindow **wwin;
+} WWindowSnapshot;
+
+enum {
+	WSnapMapped = (1 << 0),
+	WSnapShaded = (1 << 1),
+	WSnapMiniaturized = (1 << 2),
+	WSnapHidden = (1 << 3),
+	WSnapObscured = (1 << 4),
+	WSnapSunken = (1 << 5),
+
+	/* on the screen: mapped, or shaded on the current workspace */
+	WSnapVisible = (1 << 6)
+};
+
+/* Windows in focus order, the focused one first */
+WWindowSnapshot *wWindowSnapshot(virtual_screen *vscr);
+
+#define WM_ITERATE_SNAPSHOT(snap, i) for ((i) = 0; (i) < (snap)->count; (i)++)
+
+static inline Bool wSnapshotOverlaps(const WWindowSnapshot *snap, int i, int x, int y, int w, int h)
+{
+	return snap->x[i] < x + w && snap->x[i] + snap->width[i] > x &&
+		snap->y[i] < y + h && snap->y[i] + snap->height[i] > y;
+}
+
+#endif /* WMWINSNAPSHOT_H */
@@ -33,6 +33,7 @@
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
 #include <string.h>
+#include <stdint.h>
 
 #include <WINGs/WUtil.h>
 #include "WindowMaker.h"
@@ -256,8 +257,6 @@ static void updateWorkspaceNames(virtual_screen *vscr);
 static void updateCurrentWorkspace(virtual_screen *vscr);
 static void updateWorkspaceCount(virtual_screen *vscr);
 static void wNETWMShowingDesktop(virtual_screen *vscr, Bool show);
-static RImage *makeRImageFromARGBData(unsigned long *data);
-static RImage *findBestIcon(unsigned long *data, unsigned long items);
 
 typedef struct NetData {
 	WScreen *scr;
@@ -391,16 +390,13 @@ int wNETWMGetCurrentDesktopFromHint(WScreen *scr)
 	return -1;
 }
 
-/* Find the best icon to be used by Window Maker for appicon/miniwindows. */
-static RImage *findBestIcon(unsigned long *data, unsigned long items)
+/* largest number of images looked at in _NET_WM_ICON */
+#define MAX_NET_ICONS	64
+
+/* size of the icon image wanted for appicons and miniwindows */
+static int getWantedIconSize(void)
 {
 	int wanted;
-	int dx, dy, d;
-	int sx, sy, size;
-	int best_d, largest = 0;
-	unsigned long i, *icon;
-	RImage *src_image, *ret_image;
-	double f;
 
 	if (wPreferences.enforce_icon_margin) {
 		/* better use only 75% of icon_size. For 64x64 this means 48x48
@@ -416,96 +412,113 @@ static RImage *findBestIcon(unsigned long *data, unsigned long items)
 		wanted = wPreferences.icon_size;
 	}
 
-	/* try to find an icon which is close to the wanted size, but not larger */
-	icon = NULL;
-	best_d = wanted * wanted * 2;
-	for (i = 0L; i < items - 1;) {
-		/* get the current icon's size */
-		sx = (int) data[i];
-		sy = (int) data[i + 1];
-		if ((sx < 1) || (sy < 1))
-			break;
-
-		size = sx * sy + 2;
-		/* check the size difference if it's not too large */
-		if ((sx <= wanted) && (sy <= wanted)) {
-			dx = wanted - sx;
-			dy = wanted - sy;
-			d = (dx * dx) + (dy * dy);
-			if (d < best_d) {
-				icon = &data[i];
-				best_d = d;
-			}
-		}
-
-		i += size;
-	}
-
-	/* if an icon has been found, no transformation is needed */
-	if (icon)
-		return makeRImageFromARGBData(icon);
-
-	/* We need to scale down an icon. Find the largest one, for it usually
-	 * looks better to scale down a large image by a large scale than a
-	 * small image by a small scale. */
-	for (i = 0L; i < items - 1;) {
-		size = (int) data[i] * (int) data[i + 1];
-		if (size == 0)
-			break;
-
-		if (size > largest) {
-			icon = &data[i];
-			largest = size;
-		}
+	return wanted;
+}
 
-		i += size + 2;
-	}
+/*
+ * Xlib returns the 32 bit items of the property in longs, which are 64 bit
+ * wide on most systems. The pixels are ARGB in the low half.
+ */
+static RImage *makeRImageFromARGBData(const unsigned long *data, int width, int height)
+{
+	RImage *image;
+	unsigned char *ptr;
+	uint32_t pixel;
+	long i, size = (long) width * height;
 
-	/* give up if there's no icon to work with */
-	if (!icon)
+	image = RCreateImage(width, height, True);
+	if (!image)
 		return NULL;
 
-	/* create a scaled down version of the icon */
-	src_image = makeRImageFromARGBData(icon);
-	if (src_image->width > src_image->height) {
-		f = (double) wanted / (double) src_image->width;
-		ret_image = RScaleImage(src_image, wanted, (int) (f * (double) (src_image->height)));
-	} else {
-		f = (double) wanted / (double) src_image->height;
-		ret_image = RScaleImage(src_image, (int) (f * (double) src_image->width), wanted);
+	for (ptr = image->data, i = 0; i < size; i++, ptr += 4) {
+		pixel = (uint32_t) data[i];
+		ptr[0] = pixel >> 16;
+		ptr[1] = pixel >> 8;
+		ptr[2] = pixel;
+		ptr[3] = pixel >> 24;
 	}
 
-	RReleaseImage(src_image);
-	return ret_image;
+	return image;
 }
 
-static RImage *makeRImageFromARGBData(unsigned long *data)
+/*
+ * Shrink the ARGB data to the size given, each pixel being the average
+ * of the box of source pixels it covers. The colors are weighted by their
+ * opacity, so that the transparent pixels around the icon do not darken
+ * its edges.
+ */
+static RImage *makeScaledRImageFromARGBData(const unsigned long *data, int width, int height,
+					    int new_width, int new_height)
 {
-	int size, width, height, i;
 	RImage *image;
-	unsigned char *imgdata;
-	unsigned long pixel;
-
-	width = data[0];
-	height = data[1];
-	size = width * height;
+	uint64_t *sums;
+	unsigned char *ptr;
+	uint32_t pixel, a;
+	int x, y, sx, sy, y0, y1, count;
+	int *columns;
 
-	if (size == 0)
+	image = RCreateImage(new_width, new_height, True);
+	if (!image)
 		return NULL;
 
-	image = RCreateImage(width, height, True);
+	/* the first source column of each box, and the end of the last one */
+	columns = wmalloc((new_width + 1) * sizeof(int));
+	for (x = 0; x <= new_width; x++)
+		columns[x] = (int) ((long) x * width / new_width);
+
+	sums = wmalloc(new_width * 4 * sizeof(uint64_t));
+
+	ptr = image->data;
+	for (y = 0; y < new_height; y++) {
+		y0 = (int) ((long) y * height / new_height);
+		y1 = (int) ((long) (y + 1) * height / new_height);
 
-	for (imgdata = image->data, i = 2; i < size + 2; i++, imgdata += 4) {
-		pixel = data[i];
-		imgdata[3] = (pixel >> 24) & 0xff;	/* A */
-		imgdata[0] = (pixel >> 16) & 0xff;	/* R */
-		imgdata[1] = (pixel >> 8) & 0xff;	/* G */
-		imgdata[2] = (pixel >> 0) & 0xff;	/* B */
+		memset(sums, 0, new_width * 4 * sizeof(uint64_t));
+		for (sy = y0; sy < y1; sy++) {
+			const unsigned long *row = data + (long) sy * width;
+
+			for (x = 0; x < new_width; x++) {
+				uint64_t *sum = sums + x * 4;
+
+				for (sx = columns[x]; sx < columns[x + 1]; sx++) {
+					pixel = (uint32_t) row[sx];
+					a = pixel >> 24;
+					sum[0] += ((pixel >> 16) & 0xff) * a;
+					sum[1] += ((pixel >> 8) & 0xff) * a;
+					sum[2] += (pixel & 0xff) * a;
+					sum[3] += a;
+				}
+			}
+		}
+
+		for (x = 0; x < new_width; x++, ptr += 4) {
+			uint64_t *sum = sums + x * 4;
+
+			count = (columns[x + 1] - columns[x]) * (y1 - y0);
+			if (sum[3] == 0) {
+				ptr[0] = ptr[1] = ptr[2] = ptr[3] = 0;
+			} else {
+				ptr[0] = sum[0] / sum[3];
+				ptr[1] = sum[1] / sum[3];
+				ptr[2] = sum[2] / sum[3];
+				ptr[3] = sum[3] / count;
+			}
+		}
 	}
 
+	wfree(sums);
+	wfree(columns);
+
 	return image;
 }
 
+/*
+ * Find the best icon to be used by Window Maker for appicon/miniwindows.
+ *
+ * The property may hold several megabytes of images, of which only one
+ * is used. The sizes are read first, image by image, and then only the
+ * pixels of the chosen image are read.
+ */
 RImage *get_window_image_from_x11(Window window)
 {
 	RImage *image;
@@ -513,20 +526,96 @@ RImage *get_window_image_from_x11(Window window)
 	int format;
 	unsigned long items, rest;
 	unsigned long *property;
+	long offset, fit_offset = -1, larger_offset = -1;
+	unsigned long size, larger_size = 0;
+	int sx, sy, dx, dy, d, best_d, n, wanted;
+	int fit_w = 0, fit_h = 0, larger_w = 0, larger_h = 0;
+	int width, height;
+	double f;
 
-	/* Get the icon from X11 Window */
-	if (XGetWindowProperty(dpy, window, net_wm_icon, 0L, LONG_MAX,
-			       False, XA_CARDINAL, &type, &format, &items, &rest,
-			       (unsigned char **)&property) != Success || !property)
+	wanted = getWantedIconSize();
+	best_d = wanted * wanted * 2;
+
+	for (offset = 0, n = 0; n < MAX_NET_ICONS; n++) {
+		if (PropGetWindowProperty(window, net_wm_icon, offset, 2,
+					  XA_CARDINAL, &type, &format, &items, &rest,
+					  (unsigned char **)&property) != Success || !property)
+			break;
+
+		if (type != XA_CARDINAL || format != 32 || items < 2) {
+			XFree(property);
+			break;
+		}
+
+		sx = (int) property[0];
+		sy = (int) property[1];
+		XFree(property);
+
+		/* rest is in bytes, the pixels are 32 bit */
+		if (sx < 1 || sy < 1 || sx > 32767 || sy > 32767)
+			break;
+		size = (unsigned long) sx * sy;
+		if (size > rest / 4)
+			break;
+
+		if (sx <= wanted && sy <= wanted) {
+			/* close to the wanted size, but not larger */
+			dx = wanted - sx;
+			dy = wanted - sy;
+			d = (dx * dx) + (dy * dy);
+			if (d < best_d) {
+				fit_offset = offset;
+				fit_w = sx;
+				fit_h = sy;
+				best_d = d;
+			}
+		} else if (larger_offset < 0 || size < larger_size) {
+			/* the smallest of the larger ones, to be scaled down */
+			larger_offset = offset;
+			larger_w = sx;
+			larger_h = sy;
+			larger_size = size;
+		}
+
+		offset += 2 + size;
+		if (rest / 4 == size)
+			break;
+	}
+
+	if (fit_offset >= 0) {
+		offset = fit_offset;
+		width = fit_w;
+		height = fit_h;
+	} else if (larger_offset >= 0) {
+		offset = larger_offset;
+		width = larger_w;
+		height = larger_h;
+	} else {
 		return NULL;
+	}
 
-	if (type != XA_CARDINAL || format != 32 || items < 2) {
+	size = (unsigned long) width * height;
+	if (PropGetWindowProperty(window, net_wm_icon, offset + 2, size,
+				  XA_CARDINAL, &type, &format, &items, &rest,
+				  (unsigned char **)&property) != Success || !property)
+		return NULL;
+
+	if (type != XA_CARDINAL || format != 32 || items < size) {
 		XFree(property);
 		return NULL;
 	}
 
-	/* Find the best icon */
-	image = findBestIcon(property, items);
+	if (fit_offset >= 0) {
+		image = makeRImageFromARGBData(property, width, height);
+	} else if (width > height) {
+		f = (double) wanted / (double) width;
+		image = makeScaledRImageFromARGBData(property, width, height,
+						     wanted, WMAX(1, (int) (f * (double) height)));
+	} else {
+		f = (double) wanted / (double) height;
+		image = makeScaledRImageFromARGBData(property, width, height,
+						     WMAX(1, (int) (f * (double) width)), wanted);
+	}
 	XFree(property);
 	if (!image)
 		return NULL;
@@ -537,8 +626,52 @@ RImage *get_window_image_from_x11(Window window)
 	return image;
 }
 
+/*
+ * When Window Maker starts, the icons of the windows it adopts are read
+ * and converted later, one window at a time when it is idle, so that the
+ * windows themselves are ready sooner.
+ */
+static WMArray *deferred_icons = NULL;
+static WMHandlerID deferred_icons_handler = NULL;
+
+static void updateIconImage(WWindow *wwin);
+
+static void updateDeferredIcon(void *data)
+{
+	Window window;
+	WWindow *wwin;
+
+	/* Parameter not used, but tell the compiler that it is ok */
+	(void) data;
+
+	deferred_icons_handler = NULL;
+
+	window = (Window) (uintptr_t) WMPopFromArray(deferred_icons);
+	wwin = wWindowFor(window);
+	if (wwin && wwin->client_win == window)
+		updateIconImage(wwin);
+
+	if (WMGetArrayItemCount(deferred_icons) > 0)
+		deferred_icons_handler = WMAddIdleHandler(updateDeferredIcon, NULL);
+}
+
+static void deferIconImage(WWindow *wwin)
+{
+	if (!deferred_icons)
+		deferred_icons = WMCreateArray(16);
+
+	WMAddToArray(deferred_icons, (void *) (uintptr_t) wwin->client_win);
+	if (!deferred_icons_handler)
+		deferred_icons_handler = WMAddIdleHandler(updateDeferredIcon, NULL);
+}
+
 static void updateIconImage(WWindow *wwin)
 {
+	if (w_global.startup.phase1) {
+		deferIconImage(wwin);
+		return;
+	}
+
 	/* Remove the icon image from X11 */
 	if (wwin->miniwindow->net_icon_image)
 		RReleaseImage(wwin->miniwindow->net_icon_image);
@@ -570,9 +703,9 @@ static void updateWindowOpacity(WWindow *wwin)
 
 	/* We don't care about this ourselves, but other programs need us to copy
 	 * this to the frame window. */
-	if (XGetWindowProperty(dpy, wwin->client_win, net_wm_window_opacity, 0L, 1L,
-				False, XA_CARDINAL, &type, &format, &items, &rest,
-				(unsigned char **)&property) != Success)
+	if (PropGetWindowProperty(wwin->client_win, net_wm_window_opacity, 0L, 1L,
+				  XA_CARDINAL, &type, &format, &items, &rest,
+				  (unsigned char **)&property) != Success)
 		return;
 
 	if (type == None) {
@@ -1035,12 +1168,12 @@ static Bool updateStrut(WScreen *scr, Window w, Bool adding)
 		unsigned long nitems_ret, bytes_after_ret;
 		long *data = NULL;
 
-		if ((XGetWindowProperty(dpy, w, net_wm_strut, 0, 4, False,
-				       XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
-				       &bytes_after_ret, (unsigned char **)&data) == Success && data) ||
-		    ((XGetWindowProperty(dpy, w, net_wm_strut_partial, 0, 12, False,
-				       XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
-				       &bytes_after_ret, (unsigned char **)&data) == Success && data))) {
+		if ((PropGetWindowProperty(w, net_wm_strut, 0, 4,
+					  XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
+					  &bytes_after_ret, (unsigned char **)&data) == Success && data) ||
+		    ((PropGetWindowProperty(w, net_wm_strut_partial, 0, 12,
+					  XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
+					  &bytes_after_ret, (unsigned char **)&data) == Success && data))) {
 
 			/* XXX: This is strictly incorrect in the case of net_wm_strut_partial...
 			 * Discard the start and end properties from the partial strut and treat it as
@@ -1407,9 +1540,9 @@ static void updateWindowType(WWindow *wwin)
 	unsigned long nitems_ret, bytes_after_ret;
 	long *data = NULL;
 
-	if (XGetWindowProperty(dpy, wwin->client_win, net_wm_window_type, 0, 1,
-			       False, XA_ATOM, &type_ret, &fmt_ret, &nitems_ret,
-			       &bytes_after_ret, (unsigned char **)&data) == Success && data) {
+	if (PropGetWindowProperty(wwin->client_win, net_wm_window_type, 0, 1,
+				  XA_ATOM, &type_ret, &fmt_ret, &nitems_ret,
+				  &bytes_after_ret, (unsigned char **)&data) == Success && data) {
 
 		int i;
 		Atom *type = (Atom *) data;
@@ -1436,9 +1569,9 @@ void wNETWMCheckClientHints(WWindow *wwin, int *layer, int *workspace)
 	unsigned long nitems_ret, bytes_after_ret;
 	long *data = NULL;
 
-	if (XGetWindowProperty(dpy, wwin->client_win, net_wm_desktop, 0, 1, False,
-			       XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
-			       &bytes_after_ret, (unsigned char **)&data) == Success && data) {
+	if (PropGetWindowProperty(wwin->client_win, net_wm_desktop, 0, 1,
+				  XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
+				  &bytes_after_ret, (unsigned char **)&data) == Success && data) {
 
 		long desktop = *data;
 		XFree(data);
@@ -1449,9 +1582,9 @@ void wNETWMCheckClientHints(WWindow *wwin, int *layer, int *workspace)
 			*workspace = desktop;
 	}
 
-	if (XGetWindowProperty(dpy, wwin->client_win, net_wm_state, 0, 1, False,
-			       XA_ATOM, &type_ret, &fmt_ret, &nitems_ret,
-			       &bytes_after_ret, (unsigned char **)&data) == Success && data) {
+	if (PropGetWindowProperty(wwin->client_win, net_wm_state, 0, 1,
+				  XA_ATOM, &type_ret, &fmt_ret, &nitems_ret,
+				  &bytes_after_ret, (unsigned char **)&data) == Success && data) {
 
 		Atom *state = (Atom *) data;
 		for (i = 0; i < nitems_ret; ++i)
@@ -1460,9 +1593,9 @@ void wNETWMCheckClientHints(WWindow *wwin, int *layer, int *workspace)
 		XFree(data);
 	}
 
-	if (XGetWindowProperty(dpy, wwin->client_win, net_wm_window_type, 0, 1, False,
-			       XA_ATOM, &type_ret, &fmt_ret, &nitems_ret,
-			       &bytes_after_ret, (unsigned char **)&data) == Success && data) {
+	if (PropGetWindowProperty(wwin->client_win, net_wm_window_type, 0, 1,
+				  XA_ATOM, &type_ret, &fmt_ret, &nitems_ret,
+				  &bytes_after_ret, (unsigned char **)&data) == Success && data) {
 
 		Atom *type = (Atom *) data;
 		for (i = 0; i < nitems_ret; ++i) {
@@ -1487,9 +1620,9 @@ static void updateNetIconInfo(WWindow *wwin)
 	long *data = NULL;
 	Bool old_state = wwin->flags.net_handle_icon;
 
-	if (XGetWindowProperty(dpy, wwin->client_win, net_wm_handled_icons, 0, 1, False,
-			       XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
-			       &bytes_after_ret, (unsigned char **)&data) == Success && data) {
+	if (PropGetWindowProperty(wwin->client_win, net_wm_handled_icons, 0, 1,
+				  XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
+				  &bytes_after_ret, (unsigned char **)&data) == Success && data) {
 		long handled = *data;
 		wwin->flags.net_handle_icon = (handled != 0);
 		XFree(data);
@@ -1497,9 +1630,9 @@ static void updateNetIconInfo(WWindow *wwin)
 		wwin->flags.net_handle_icon = False;
 	}
 
-	if (XGetWindowProperty(dpy, wwin->client_win, net_wm_icon_geometry, 0, 4, False,
-			       XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
-			       &bytes_after_ret, (unsigned char **)&data) == Success && data) {
+	if (PropGetWindowProperty(wwin->client_win, net_wm_icon_geometry, 0, 4,
+				  XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
+				  &bytes_after_ret, (unsigned char **)&data) == Success && data) {
 
 		wwin->flags.net_handle_icon = True;
 		wwin->miniwindow->icon_x = data[0];
@@ -1747,9 +1880,9 @@ int wNETWMGetPidForWindow(Window window)
 	long *data = NULL;
 	int pid;
 
-	if (XGetWindowProperty(dpy, window, net_wm_pid, 0, 1, False,
-			       XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
-			       &bytes_after_ret, (unsigned char **)&data) == Success && data) {
+	if (PropGetWindowProperty(window, net_wm_pid, 0, 1,
+				  XA_CARDINAL, &type_ret, &fmt_ret, &nitems_ret,
+				  &bytes_after_ret, (unsigned char **)&data) == Success && data) {
 		pid = *data;
 		XFree(data);
 	} else {
@@ -61,6 +61,8 @@
 #define MC_WORKSPACE1   3
 
 #define WORKSPACE_NAME_DISPLAY_PADDING 32
+/* the shadow around the name, in pixels */
+#define WORKSPACE_NAME_SHADOW 2
 
 int set_clip_omnipresent(virtual_screen *vscr, int wksno);
 
@@ -331,16 +333,57 @@ static void hideWorkspaceName(void *data)
 	}
 }
 
+/*
+ * From white text drawn on black, make an RGBA image of the text over a
+ * soft black shadow.
+ */
+static RImage *create_shadowed_text(RImage *glyphs)
+{
+	RImage *shadow, *image;
+	unsigned char *g, *s, *d;
+	int i, a, alpha;
+
+	shadow = RCloneImage(glyphs);
+	image = RCreateImage(glyphs->width, glyphs->height, True);
+	if (!shadow || !image || !RBlurImageRadius(shadow, WORKSPACE_NAME_SHADOW)) {
+		if (shadow)
+			RReleaseImage(shadow);
+		if (image)
+			RReleaseImage(image);
+		return NULL;
+	}
+
+	g = glyphs->data;
+	s = shadow->data;
+	d = image->data;
+	for (i = 0; i < glyphs->width * glyphs->height; i++) {
+		/* the blur thins the strokes out, darken it back */
+		a = WMIN(s[0] * 4, 255);
+
+		/* white text, of coverage g[0], over the shadow */
+		alpha = g[0] + a * (255 - g[0]) / 255;
+		d[0] = d[1] = d[2] = alpha ? g[0] * 255 / alpha : 0;
+		d[3] = alpha;
+
+		g += 3;
+		s += 3;
+		d += 4;
+	}
+	RReleaseImage(shadow);
+
+	return image;
+}
+
 static void showWorkspaceName(virtual_screen *vscr, int workspace)
 {
 	WorkspaceNameData *data;
 	RXImage *ximg;
+	RImage *img;
 	Pixmap text, mask;
 	int w, h;
 	int px, py;
 	char *name = vscr->workspace.array[workspace]->name;
 	int len = strlen(name);
-	int x, y;
 #ifdef USE_XINERAMA
 	int head;
 	WMRect rect;
@@ -366,6 +409,7 @@ static void showWorkspaceName(virtual_screen *vscr, int workspace)
 
 	data = wmalloc(sizeof(WorkspaceNameData));
 	data->back = NULL;
+	data->text = NULL;
 
 	w = WMWidthOfString(vscr->workspace.font_for_name, name, len);
 	h = WMFontHeight(vscr->workspace.font_for_name);
@@ -430,54 +474,60 @@ static void showWorkspaceName(virtual_screen *vscr, int workspace)
 	XResizeWindow(dpy, vscr->screen_ptr->workspace_name, w + 4, h + 4);
 	XMoveWindow(dpy, vscr->screen_ptr->workspace_name, px, py);
 
-	text = XCreatePixmap(dpy, vscr->screen_ptr->w_win, w + 4, h + 4, vscr->screen_ptr->w_depth);
-	mask = XCreatePixmap(dpy, vscr->screen_ptr->w_win, w + 4, h + 4, 1);
+	/* what is under the name, the shadow and the fading are blended over it */
+	ximg = RGetXImage(vscr->screen_ptr->rcontext, vscr->screen_ptr->root_win, px, py, w + 4, h + 4);
+	if (!ximg)
+		goto erro;
 
-	XFillRectangle(dpy, text, WMColorGC(vscr->screen_ptr->black), 0, 0, w + 4, h + 4);
+	data->back = RCreateImageFromXImage(vscr->screen_ptr->rcontext, ximg->image, NULL);
+	RDestroyXImage(vscr->screen_ptr->rcontext, ximg);
 
-	for (x = 0; x <= 4; x++)
-		for (y = 0; y <= 4; y++)
-			WMDrawString(vscr->screen_ptr->wmscreen, text, vscr->screen_ptr->white, vscr->workspace.font_for_name, x, y, name, len);
+	if (!data->back)
+		goto erro;
 
-	XSetForeground(dpy, vscr->screen_ptr->mono_gc, 1);
-	XSetBackground(dpy, vscr->screen_ptr->mono_gc, 0);
-	XCopyPlane(dpy, text, mask, vscr->screen_ptr->mono_gc, 0, 0, w + 4, h + 4, 0, 0, 1 << (vscr->screen_ptr->w_depth - 1));
-	XSetBackground(dpy, vscr->screen_ptr->mono_gc, 1);
+	text = XCreatePixmap(dpy, vscr->screen_ptr->w_win, w + 4, h + 4, vscr->screen_ptr->w_depth);
 	XFillRectangle(dpy, text, WMColorGC(vscr->screen_ptr->black), 0, 0, w + 4, h + 4);
-	WMDrawString(vscr->screen_ptr->wmscreen, text, vscr->screen_ptr->white, vscr->workspace.font_for_name, 2, 2, name, len);
+	WMDrawString(vscr->screen_ptr->wmscreen, text, vscr->screen_ptr->white, vscr->workspace.font_for_name,
+		     WORKSPACE_NAME_SHADOW, WORKSPACE_NAME_SHADOW, name, len);
+
+	img = RCreateImageFromDrawable(vscr->screen_ptr->rcontext, text, None);
+	XFreePixmap(dpy, text);
+	if (!img)
+		goto erro;
+
+	data->text = create_shadowed_text(img);
+	RReleaseImage(img);
+	if (!data->text)
+		goto erro;
+
+	/* the window only covers the text and its shadow */
+	if (!RConvertImageMask(vscr->screen_ptr->rcontext, data->text, &text, &mask, 0))
+		goto erro;
+	XFreePixmap(dpy, text);
 
 #ifdef USE_XSHAPE
 	if (w_global.xext.shape.supported)
 		XShapeCombineMask(dpy, vscr->screen_ptr->workspace_name, ShapeBounding, 0, 0, mask, ShapeSet);
 #endif
-	XSetWindowBackgroundPixmap(dpy, vscr->screen_ptr->workspace_name, text);
-	XClearWindow(dpy, vscr->screen_ptr->workspace_name);
-
-	data->text = RCreateImageFromDrawable(vscr->screen_ptr->rcontext, text, None);
-
-	XFreePixmap(dpy, text);
 	XFreePixmap(dpy, mask);
 
-	if (!data->text) {
-		XMapRaised(dpy, vscr->screen_ptr->workspace_name);
-		XFlush(dpy);
-
+	img = RCloneImage(data->back);
+	if (!img)
+		goto erro;
+	RCombineImages(img, data->text);
+	if (!RConvertImage(vscr->screen_ptr->rcontext, img, &text)) {
+		RReleaseImage(img);
 		goto erro;
 	}
+	RReleaseImage(img);
 
-	ximg = RGetXImage(vscr->screen_ptr->rcontext, vscr->screen_ptr->root_win, px, py, data->text->width, data->text->height);
-	if (!ximg)
-		goto erro;
+	XSetWindowBackgroundPixmap(dpy, vscr->screen_ptr->workspace_name, text);
+	XClearWindow(dpy, vscr->screen_ptr->workspace_name);
+	XFreePixmap(dpy, text);
 
 	XMapRaised(dpy, vscr->screen_ptr->workspace_name);
 	XFlush(dpy);
 
-	data->back = RCreateImageFromXImage(vscr->screen_ptr->rcontext, ximg->image, NULL);
-	RDestroyXImage(vscr->screen_ptr->rcontext, ximg);
-
-	if (!data->back)
-		goto erro;
-
 	data->count = 10;
 
 	/* set a timeout for the effect */
@@ -542,10 +592,28 @@ void wWorkspaceRelativeChange(virtual_screen *vscr, int amount)
 	}
 }
 
+/*
+ * Grow a list of windows to map or unmap when it is full.
+ */
+static WWindow **growWindowList(WWindow **list, int count, int *size)
+{
+	if (count < *size)
+		return list;
+
+	*size *= 2;
+	return wrealloc(list, *size * sizeof(WWindow *));
+}
+
 void wWorkspaceForceChange(virtual_screen *vscr, int workspace)
 {
 	WWindow *tmp, *foc = NULL, *foc2 = NULL;
 	int count, s1, s2;
+#ifdef DEBUG_WORKSPACE
+	struct timeval start, end;
+	int mapped = 0, unmapped = 0;
+
+	gettimeofday(&start, NULL);
+#endif
 
 	if (workspace >= MAX_WORKSPACES || workspace < 0)
 		return;
@@ -579,13 +647,21 @@ void wWorkspaceForceChange(virtual_screen *vscr, int workspace)
 
 	tmp = vscr->window.focused;
 	if (tmp != NULL) {
-		WWindow **toUnmap;
-		int toUnmapSize, toUnmapCount;
+		WWindow **toMap, **toUnmap;
+		int toMapSize, toMapCount, toUnmapSize, toUnmapCount;
 
 		if ((IS_OMNIPRESENT(tmp) && (tmp->flags.mapped || tmp->flags.shaded) &&
 		     !WFLAGP(tmp, no_focusable)) || tmp->flags.changing_workspace)
 			foc = tmp;
 
+		/*
+		 * The windows to show and to hide are collected first, and
+		 * then mapped and unmapped together
+		 */
+		toMapSize = 16;
+		toMapCount = 0;
+		toMap = wmalloc(toMapSize * sizeof(WWindow *));
+
 		toUnmapSize = 16;
 		toUnmapCount = 0;
 		toUnmap = wmalloc(toUnmapSize * sizeof(WWindow *));
@@ -598,11 +674,7 @@ void wWorkspaceForceChange(virtual_screen *vscr, int workspace)
 				/* unmap windows not on this workspace */
 				if ((tmp->flags.mapped || tmp->flags.shaded) &&
 				    !IS_OMNIPRESENT(tmp) && !tmp->flags.changing_workspace) {
-					if (toUnmapCount == toUnmapSize) {
-						toUnmapSize *= 2;
-						toUnmap = wrealloc(toUnmap, toUnmapSize * sizeof(WWindow *));
-					}
-
+					toUnmap = growWindowList(toUnmap, toUnmapCount, &toUnmapSize);
 					toUnmap[toUnmapCount++] = tmp;
 				}
 				/* also unmap miniwindows not on this workspace */
@@ -634,7 +706,8 @@ void wWorkspaceForceChange(virtual_screen *vscr, int workspace)
 					if (!tmp->flags.hidden) {
 						if (!(tmp->flags.mapped || tmp->flags.miniaturized)) {
 							/* remap windows that are on this workspace */
-							wWindowMap(tmp);
+							toMap = growWindowList(toMap, toMapCount, &toMapSize);
+							toMap[toMapCount++] = tmp;
 							if (!foc && !WFLAGP(tmp, no_focusable))
 								foc = tmp;
 						}
@@ -649,9 +722,15 @@ void wWorkspaceForceChange(virtual_screen *vscr, int workspace)
 			tmp = tmp->prev;
 		}
 
-		while (toUnmapCount > 0)
-			wWindowUnmap(toUnmap[--toUnmapCount]);
+		/* show the new workspace before hiding the old one */
+		wWindowMapList(toMap, toMapCount);
+		wWindowUnmapList(toUnmap, toUnmapCount);
 
+#ifdef DEBUG_WORKSPACE
+		mapped = toMapCount;
+		unmapped = toUnmapCount;
+#endif
+		wfree(toMap);
 		wfree(toUnmap);
 
 		/* Gobble up events unleashed by our mapping & unmapping.
@@ -741,6 +820,13 @@ void wWorkspaceForceChange(virtual_screen *vscr, int workspace)
 	showWorkspaceName(vscr, workspace);
 
 	WMPostNotificationName(WMNWorkspaceChanged, vscr, (void *)(uintptr_t) workspace);
+
+#ifdef DEBUG_WORKSPACE
+	XSync(dpy, False);
+	gettimeofday(&end, NULL);
+	wmessage("switch to workspace %d: %ld us, %d windows mapped, %d unmapped", workspace + 1,
+		 (end.tv_sec - start.tv_sec) * 1000000L + (end.tv_usec - start.tv_usec), mapped, unmapped);
+#endif
 }
 
 static void switchWSCommand(WMenu *menu, WMenuEntry *entry)
@@ -1024,6 +1110,8 @@ int set_clip_omnipresent(virtual_screen *vscr, int wksno)
 
 		vscr->workspace.array[0]->clip->icon_array[k] = aicon;
 		aicon->dock = vscr->workspace.array[0]->clip;
+		wDockInvalidateSlots(vscr->workspace.array[wksno]->clip);
+		wDockInvalidateSlots(vscr->workspace.array[0]->clip);
 	}
 
 	return added_omnipresent_icons;
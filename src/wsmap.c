@@ -34,6 +34,7 @@
 #include "workspace.h"
 #include "wsmap.h"
 #include "texture.h"
+#include "thumbnail.h"
 
 #include "WINGs/WINGsP.h"
 
@@ -68,27 +69,11 @@ typedef struct {
 void wWorkspaceMapUpdate(virtual_screen *vscr)
 {
 	WScreen *scr = vscr->screen_ptr;
-	XImage *pimg;
-	RImage *mini_preview, *tmp;
-
-	pimg = XGetImage(dpy, scr->root_win, 0, 0,
-			 scr->scr_width, scr->scr_height,
-			 AllPlanes, ZPixmap);
-	if (pimg) {
-		mini_preview = RCreateImageFromXImage(scr->rcontext, pimg, NULL);
-		XDestroyImage(pimg);
-
-		if (mini_preview) {
-			tmp = vscr->workspace.array[vscr->workspace.current]->map;
-			if (tmp)
-				RReleaseImage(tmp);
-
-			vscr->workspace.array[vscr->workspace.current]->map = RSmoothScaleImage(mini_preview,
-												scr->scr_width / WORKSPACE_MAP_RATIO,
-												scr->scr_height / WORKSPACE_MAP_RATIO);
-			RReleaseImage(mini_preview);
-		}
-	}
+
+	/* only the parts of the screen that changed are read back */
+	wThumbnailUpdateWorkspaceMap(vscr, &vscr->workspace.array[vscr->workspace.current]->map,
+				     scr->scr_width / WORKSPACE_MAP_RATIO,
+				     scr->scr_height / WORKSPACE_MAP_RATIO);
 }
 
 static void workspace_map_slide(WWorkspaceMap *wsmap)
@@ -178,6 +178,7 @@ static void updateImage(BufferData * data, int rx, int ry)
 	int x, y;
 	int xoffs, yoffs;
 	int changedPixels = 0;
+	RXImage *rximage = NULL;
 	XImage *image;
 
 	gw = data->width;
@@ -204,7 +205,17 @@ static void updateImage(BufferData * data, int rx, int ry)
 		gh = HeightOfScreen(DefaultScreenOfDisplay(vdpy)) - gy;
 	}
 
-	image = XGetImage(vdpy, DefaultRootWindow(vdpy), gx, gy, gw, gh, AllPlanes, ZPixmap);
+	/* on our own display the pixels can be read through shared memory */
+	if (vdpy == dpy) {
+		rximage = RGetXImage(WMScreenRContext(scr), DefaultRootWindow(vdpy), gx, gy, gw, gh);
+		if (!rximage)
+			return;
+		image = rximage->image;
+	} else {
+		image = XGetImage(vdpy, DefaultRootWindow(vdpy), gx, gy, gw, gh, AllPlanes, ZPixmap);
+		if (!image)
+			return;
+	}
 
 	for (y = 0; y < data->height; y++) {
 		for (x = 0; x < data->width; x++) {
@@ -219,7 +230,10 @@ static void updateImage(BufferData * data, int rx, int ry)
 	/* flush the point cache */
 	drawpoint(data, 0, -1, -1);
 
-	XDestroyImage(image);
+	if (rximage)
+		RDestroyXImage(WMScreenRContext(scr), rximage);
+	else
+		XDestroyImage(image);
 
 	if (data->markPointerHotspot && !data->frozen) {
 		XRectangle rects[4];
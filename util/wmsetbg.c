@@ -38,6 +38,8 @@
 #include <signal.h>
 #include <sys/types.h>
 #include <ctype.h>
+#include <errno.h>
+#include <poll.h>
 
 #ifdef USE_XINERAMA
 # ifdef SOLARIS_XINERAMA	/* sucks */
@@ -47,11 +49,16 @@
 # endif
 #endif
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
 #ifdef HAVE_STDNORETURN
 #include <stdnoreturn.h>
 #endif
 
 #include "../src/wconfig.h"
+#include "../src/bghelper.h"
 
 
 #include <WINGs/WINGs.h>
@@ -95,8 +102,18 @@ typedef struct BackgroundTexture {
 	Pixmap pixmap;		/* for all textures, including solid */
 	int width;		/* size of the pixmap */
 	int height;
+
+	/* helper mode: the pixmap is rendered when needed, and may be freed */
+	unsigned long used;	/* when it was last needed */
+	Bool invalid;		/* could not be rendered */
 } BackgroundTexture;
 
+/* helper mode: textures which have a pixmap, and the one on the root */
+static int renderedTextures = 0;
+static unsigned long textureClock = 0;
+static BackgroundTexture *shownTexture = NULL;
+static Pixmap publishedPixmap = None;
+
 static noreturn void quit(int rcode)
 {
 	WMReleaseApplication();
@@ -171,99 +188,190 @@ static RImage *loadImage(RContext * rc, const char *file)
 	return image;
 }
 
-static void
-applyImage(RContext * rc, BackgroundTexture * texture, RImage * image, char type,
-	   int x, int y, int width, int height)
+/*
+ * Size to which the image is scaled for an area of width x height, for the
+ * 'S'caled, 'M'aximized, 'F'illed and 'C'entered modes.
+ */
+static void scaledSize(RImage * image, char type, int width, int height, int *w, int *h)
 {
-	int w, h;
-	Bool fimage = False;
-
 	switch (toupper(type)) {
 	case 'S':
-	case 'M':
+		*w = width;
+		*h = height;
+		break;
 	case 'F':
-		if (toupper(type) == 'S') {
-			w = width;
-			h = height;
-		} else if(toupper(type) == 'F') {
-			if (image->width * height > image->height * width) {
-				w = (height * image->width) / image->height;
-				h = height;
-			} else {
-				w = width;
-				h = (width * image->height) / image->width;
-			}
+		if (image->width * height > image->height * width) {
+			*w = (height * image->width) / image->height;
+			*h = height;
 		} else {
-			if (image->width * height > image->height * width) {
-				w = width;
-				h = (width * image->height) / image->width;
-			} else {
-				w = (height * image->width) / image->height;
-				h = height;
-			}
+			*w = width;
+			*h = (width * image->height) / image->width;
+		}
+		break;
+	case 'M':
+		if (image->width * height > image->height * width) {
+			*w = width;
+			*h = (width * image->height) / image->width;
+		} else {
+			*w = (height * image->width) / image->height;
+			*h = height;
 		}
+		break;
+	default:
+		*w = image->width;
+		*h = image->height;
+		break;
+	}
+}
 
-		if (w != image->width || h != image->height) {
-			RImage *simage;
+typedef struct ScaleJob {
+	RImage *image;
+	int width, height;
+	RImage *scaled;
+} ScaleJob;
 
-			if (smooth) {
-				simage = RSmoothScaleImage(image, w, h);
-			} else {
-				simage = RScaleImage(image, w, h);
-			}
+static void *runScaleJob(void *arg)
+{
+	ScaleJob *job = arg;
 
-			if (!simage) {
-				wwarning("could not scale image:%s", RMessageForError(RErrorCode));
-				return;
-			}
-			fimage = True;
-			image = simage;
-		}
+	if (job->width == job->image->width && job->height == job->image->height)
+		job->scaled = job->image;
+	else if (smooth)
+		job->scaled = RSmoothScaleImage(job->image, job->width, job->height);
+	else
+		job->scaled = RScaleImage(job->image, job->width, job->height);
 
-		/* fall through */
-	case 'C':
-		{
-			Pixmap pixmap;
+	return NULL;
+}
 
-			if (!RConvertImage(rc, image, &pixmap)) {
-				wwarning("could not convert texture:%s", RMessageForError(RErrorCode));
-				if (fimage)
-					RReleaseImage(image);
-				return;
-			}
+static void runScaleJobs(ScaleJob * jobs, int njobs)
+{
+	int i;
+#ifdef HAVE_PTHREAD
+	pthread_t *threads = wmalloc(sizeof(pthread_t) * njobs);
+	int started;
 
-			if (image->width != width || image->height != height) {
-				int sx, sy, w, h;
+	for (i = 1; i < njobs; i++)
+		if (pthread_create(&threads[i], NULL, runScaleJob, &jobs[i]) != 0)
+			break;
+	started = i;
 
-				if (image->height < height) {
-					h = image->height;
-					y += (height - h) / 2;
-					sy = 0;
-				} else {
-					sy = (image->height - height) / 2;
-					h = height;
-				}
-				if (image->width < width) {
-					w = image->width;
-					x += (width - w) / 2;
-					sx = 0;
-				} else {
-					sx = (image->width - width) / 2;
-					w = width;
-				}
+	runScaleJob(&jobs[0]);
+	/* the jobs whose thread could not be created are done here */
+	for (i = started; i < njobs; i++)
+		runScaleJob(&jobs[i]);
 
-				XCopyArea(dpy, pixmap, texture->pixmap, DefaultGC(dpy, scr), sx, sy, w, h, x, y);
-			} else
-				XCopyArea(dpy, pixmap, texture->pixmap, DefaultGC(dpy, scr), 0, 0, width, height,
-					  x, y);
+	for (i = 1; i < started; i++)
+		pthread_join(threads[i], NULL);
+	wfree(threads);
+#else
+	for (i = 0; i < njobs; i++)
+		runScaleJob(&jobs[i]);
+#endif
+}
 
-			XFreePixmap(dpy, pixmap);
-			if (fimage) {
-				RReleaseImage(image);
-			}
+/*
+ * Put the image on each head, on top of the background color, and return
+ * the resulting screen sized pixmap.
+ *
+ * Heads of the same size share the scaled image, the ones of different
+ * sizes are scaled in parallel. The result is composed on our side and
+ * sent to the server in one go.
+ */
+static Pixmap composeImage(RContext * rc, RImage * image, char type, const RColor * color)
+{
+	WMRect full, *heads;
+	ScaleJob *jobs;
+	int *headJob;
+	int nheads, njobs, i, j, w, h;
+	RImage *screen;
+	Pixmap pixmap = None;
+
+	full.pos.x = 0;
+	full.pos.y = 0;
+	full.size.width = scrWidth;
+	full.size.height = scrHeight;
+	heads = &full;
+	nheads = 1;
+#ifdef USE_XINERAMA
+	if (xineInfo.count && !xineStretch) {
+		heads = xineInfo.screens;
+		nheads = xineInfo.count;
+	}
+#endif
+
+	jobs = wmalloc(sizeof(ScaleJob) * nheads);
+	headJob = wmalloc(sizeof(int) * nheads);
+	njobs = 0;
+	for (i = 0; i < nheads; i++) {
+		scaledSize(image, type, heads[i].size.width, heads[i].size.height, &w, &h);
+		for (j = 0; j < njobs; j++)
+			if (jobs[j].width == w && jobs[j].height == h)
+				break;
+		if (j == njobs) {
+			jobs[j].image = image;
+			jobs[j].width = w;
+			jobs[j].height = h;
+			njobs++;
 		}
-		break;
+		headJob[i] = j;
+	}
+
+	runScaleJobs(jobs, njobs);
+
+	screen = RCreateImage(scrWidth, scrHeight, False);
+	if (!screen) {
+		wwarning("could not render texture:%s", RMessageForError(RErrorCode));
+		goto out;
+	}
+	RFillImage(screen, color);
+
+	for (i = 0; i < nheads; i++) {
+		RImage *scaled = jobs[headJob[i]].scaled;
+		int x = heads[i].pos.x, y = heads[i].pos.y;
+		int width = heads[i].size.width, height = heads[i].size.height;
+		int sx, sy;
+
+		if (!scaled) {
+			wwarning("could not scale image:%s", RMessageForError(RErrorCode));
+			continue;
+		}
+
+		/* center the image on the head, cropping what does not fit */
+		if (scaled->height < height) {
+			h = scaled->height;
+			y += (height - h) / 2;
+			sy = 0;
+		} else {
+			sy = (scaled->height - height) / 2;
+			h = height;
+		}
+		if (scaled->width < width) {
+			w = scaled->width;
+			x += (width - w) / 2;
+			sx = 0;
+		} else {
+			sx = (scaled->width - width) / 2;
+			w = width;
+		}
+
+		RCopyArea(screen, scaled, sx, sy, w, h, x, y);
 	}
+
+	if (!RConvertImage(rc, screen, &pixmap)) {
+		wwarning("could not convert texture:%s", RMessageForError(RErrorCode));
+		pixmap = None;
+	}
+	RReleaseImage(screen);
+
+ out:
+	for (j = 0; j < njobs; j++)
+		if (jobs[j].scaled && jobs[j].scaled != image)
+			RReleaseImage(jobs[j].scaled);
+	wfree(jobs);
+	wfree(headJob);
+
+	return pixmap;
 }
 
 static BackgroundTexture *parseTexture(RContext * rc, char *text)
@@ -544,34 +652,28 @@ static BackgroundTexture *parseTexture(RContext * rc, char *text)
 		case 'C':
 		case 'F':
 			{
-				Pixmap tpixmap =
-				    XCreatePixmap(dpy, root, scrWidth, scrHeight, DefaultDepth(dpy, scr));
-				XSetForeground(dpy, DefaultGC(dpy, scr), color.pixel);
-				XFillRectangle(dpy, tpixmap, DefaultGC(dpy, scr), 0, 0, scrWidth, scrHeight);
+				RColor bg;
+				Pixmap tpixmap = None;
 
-				texture->pixmap = tpixmap;
 				texture->color = color;
 				texture->width = scrWidth;
 				texture->height = scrHeight;
 
-				if (!image)
-					break;
+				if (image) {
+					bg.red = color.red >> 8;
+					bg.green = color.green >> 8;
+					bg.blue = color.blue >> 8;
+					bg.alpha = 255;
+					tpixmap = composeImage(rc, image, type[0], &bg);
+				}
 
-#ifdef USE_XINERAMA
-				if (xineInfo.count && ! xineStretch) {
-					int i;
-					for (i = 0; i < xineInfo.count; ++i) {
-						applyImage(rc, texture, image, type[0],
-							   xineInfo.screens[i].pos.x, xineInfo.screens[i].pos.y,
-							   xineInfo.screens[i].size.width,
-							   xineInfo.screens[i].size.height);
-					}
-				} else {
-					applyImage(rc, texture, image, type[0], 0, 0, scrWidth, scrHeight);
+				if (!tpixmap) {
+					tpixmap = XCreatePixmap(dpy, root, scrWidth, scrHeight, DefaultDepth(dpy, scr));
+					XSetForeground(dpy, DefaultGC(dpy, scr), color.pixel);
+					XFillRectangle(dpy, tpixmap, DefaultGC(dpy, scr), 0, 0, scrWidth, scrHeight);
 				}
-#else				/* !USE_XINERAMA */
-				applyImage(rc, texture, image, type[0], 0, 0, scrWidth, scrHeight);
-#endif				/* !USE_XINERAMA */
+
+				texture->pixmap = tpixmap;
 			}
 			break;
 		}
@@ -685,6 +787,7 @@ static BackgroundTexture *parseTexture(RContext * rc, char *text)
 	}
 
 	texture->spec = wstrdup(text);
+	WMReleasePropList(texarray);
 
 	return texture;
 
@@ -697,8 +800,11 @@ static BackgroundTexture *parseTexture(RContext * rc, char *text)
 	return NULL;
 }
 
-static void freeTexture(BackgroundTexture * texture)
+static void releaseTexturePixmap(BackgroundTexture * texture)
 {
+	if (!texture->pixmap)
+		return;
+
 	if (texture->solid) {
 		unsigned long pixel[1];
 
@@ -708,26 +814,92 @@ static void freeTexture(BackgroundTexture * texture)
 		    && pixel[0] != WhitePixelOfScreen(DefaultScreenOfDisplay(dpy)))
 			XFreeColors(dpy, DefaultColormap(dpy, scr), pixel, 1, 0);
 	}
-	if (texture->pixmap) {
-		XFreePixmap(dpy, texture->pixmap);
-	}
+	XFreePixmap(dpy, texture->pixmap);
+	texture->pixmap = None;
+	texture->solid = 0;
+	renderedTextures--;
+}
+
+static void freeTexture(BackgroundTexture * texture)
+{
+	releaseTexturePixmap(texture);
 	wfree(texture->spec);
 	wfree(texture);
 }
 
-static void setupTexture(RContext * rc, BackgroundTexture ** textures, int *maxTextures, int workspace, char *texture)
+static void releaseTexture(BackgroundTexture * texture)
+{
+	texture->refcount--;
+
+	if (texture->refcount == 0)
+		freeTexture(texture);
+}
+
+/*
+ * Free the pixmaps which were not used for the longest time, keeping the
+ * one on the root window, until at most 'keep' are left.
+ */
+static void evictTextures(BackgroundTexture ** textures, int keep)
+{
+	BackgroundTexture *oldest;
+	int i;
+
+	while (renderedTextures > keep) {
+		oldest = NULL;
+		for (i = 0; i < WORKSPACE_COUNT; i++) {
+			if (!textures[i] || !textures[i]->pixmap || textures[i] == shownTexture)
+				continue;
+			if (!oldest || textures[i]->used < oldest->used)
+				oldest = textures[i];
+		}
+		if (!oldest)
+			return;
+
+		releaseTexturePixmap(oldest);
+	}
+}
+
+static Bool renderTexture(RContext * rc, BackgroundTexture ** textures, BackgroundTexture * texture)
+{
+	BackgroundTexture *tmp;
+
+	texture->used = ++textureClock;
+
+	if (texture->pixmap)
+		return True;
+	if (texture->invalid)
+		return False;
+
+	evictTextures(textures, MAX_BACKGROUND_PIXMAPS - 1);
+
+	tmp = parseTexture(rc, texture->spec);
+	if (!tmp) {
+		texture->invalid = True;
+		return False;
+	}
+
+	texture->solid = tmp->solid;
+	texture->color = tmp->color;
+	texture->pixmap = tmp->pixmap;
+	texture->width = tmp->width;
+	texture->height = tmp->height;
+	renderedTextures++;
+
+	wfree(tmp->spec);
+	wfree(tmp);
+
+	return True;
+}
+
+static void setupTexture(BackgroundTexture ** textures, int *maxTextures, int workspace, char *texture)
 {
 	BackgroundTexture *newTexture = NULL;
 	int i;
 
 	/* unset the texture */
 	if (!texture) {
-		if (textures[workspace] != NULL) {
-			textures[workspace]->refcount--;
-
-			if (textures[workspace]->refcount == 0)
-				freeTexture(textures[workspace]);
-		}
+		if (textures[workspace] != NULL)
+			releaseTexture(textures[workspace]);
 		textures[workspace] = NULL;
 		return;
 	}
@@ -739,7 +911,7 @@ static void setupTexture(RContext * rc, BackgroundTexture ** textures, int *maxT
 	}
 
 	/* check if the same texture is already created */
-	for (i = 0; i < *maxTextures; i++) {
+	for (i = 0; i <= *maxTextures; i++) {
 		if (textures[i] && strcasecmp(textures[i]->spec, texture) == 0) {
 			newTexture = textures[i];
 			break;
@@ -747,19 +919,13 @@ static void setupTexture(RContext * rc, BackgroundTexture ** textures, int *maxT
 	}
 
 	if (!newTexture) {
-		/* create the texture */
-		newTexture = parseTexture(rc, texture);
+		/* the texture is rendered when the workspace is shown */
+		newTexture = wmalloc(sizeof(BackgroundTexture));
+		newTexture->spec = wstrdup(texture);
 	}
-	if (!newTexture)
-		return;
-
-	if (textures[workspace] != NULL) {
 
-		textures[workspace]->refcount--;
-
-		if (textures[workspace]->refcount == 0)
-			freeTexture(textures[workspace]);
-	}
+	if (textures[workspace] != NULL)
+		releaseTexture(textures[workspace]);
 
 	newTexture->refcount++;
 	textures[workspace] = newTexture;
@@ -823,10 +989,13 @@ static void setPixmapProperty(Pixmap pixmap)
 			   &type, &format, &length, &after, &data);
 
 	if ((type == XA_PIXMAP) && (format == 32) && (length == 1)) {
-		XSetErrorHandler(dummyErrorHandler);
-		XKillClient(dpy, *((Pixmap *) data));
-		XSync(dpy, False);
-		XSetErrorHandler(NULL);
+		/* the helper publishes its own pixmaps, don't kill ourselves */
+		if (*((Pixmap *) data) != publishedPixmap) {
+			XSetErrorHandler(dummyErrorHandler);
+			XKillClient(dpy, *((Pixmap *) data));
+			XSync(dpy, False);
+			XSetErrorHandler(NULL);
+		}
 		mode = PropModeReplace;
 	} else {
 		mode = PropModeAppend;
@@ -840,12 +1009,8 @@ static void setPixmapProperty(Pixmap pixmap)
 	XFlush(dpy);
 }
 
-static void changeTexture(BackgroundTexture * texture)
+static void setRootBackground(BackgroundTexture * texture)
 {
-	if (!texture) {
-		return;
-	}
-
 	if (texture->solid) {
 		XSetWindowBackground(dpy, root, texture->color.pixel);
 	} else {
@@ -854,6 +1019,19 @@ static void changeTexture(BackgroundTexture * texture)
 	XClearWindow(dpy, root);
 
 	XSync(dpy, False);
+}
+
+/*
+ * Set the background and publish a copy of the pixmap which stays valid
+ * after we exit.
+ */
+static void changeTexture(BackgroundTexture * texture)
+{
+	if (!texture) {
+		return;
+	}
+
+	setRootBackground(texture);
 
 	{
 		Pixmap pixmap;
@@ -864,134 +1042,263 @@ static void changeTexture(BackgroundTexture * texture)
 	}
 }
 
-static int readmsg(int fd, char *buffer, int size)
+/*
+ * Same as above for the helper, which publishes its own pixmap and keeps
+ * it as long as it is on the root window. A copy is only made when the
+ * helper exits.
+ */
+static void showTexture(RContext * rc, BackgroundTexture ** textures, BackgroundTexture * texture)
 {
-	int count;
+	if (!renderTexture(rc, textures, texture)) {
+		if (texture == textures[0] || !textures[0] || !renderTexture(rc, textures, textures[0]))
+			return;
+		texture = textures[0];
+	}
 
-	while (size > 0) {
-		count = read(fd, buffer, size);
-		if (count < 0)
-			return -1;
-		size -= count;
-		buffer += count;
-		*buffer = 0;
+	setRootBackground(texture);
+
+	if (texture->pixmap != publishedPixmap) {
+		setPixmapProperty(texture->pixmap);
+		publishedPixmap = texture->pixmap;
 	}
 
-	return size;
+	texture->refcount++;
+	if (shownTexture)
+		releaseTexture(shownTexture);
+	shownTexture = texture;
 }
 
-/*
- * Message Format:
- * sizeSntexture_spec - sets the texture for workspace n
- * sizeCn - change background texture to the one for workspace n
- * sizePpath - set the pixmap search path
- *
- * n is 4 bytes
- * size = 4 bytes for length of the message data
- */
-static noreturn void helperLoop(RContext * rc)
+static Bool inputPending(void)
 {
-	BackgroundTexture *textures[WORKSPACE_COUNT];
-	int maxTextures = 0;
-	char buffer[2048], buf[8];
-	int size;
-	int errcount = 4;
+	struct pollfd pfd;
 
-	memset(textures, 0, WORKSPACE_COUNT * sizeof(BackgroundTexture *));
+	pfd.fd = 0;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
 
-	while (1) {
-		int workspace = -1;
+	return poll(&pfd, 1, 0) > 0;
+}
 
-		/* get length of message */
-		if (readmsg(0, buffer, 4) < 0) {
-			werror("error reading message from Window Maker");
-			errcount--;
-			if (errcount == 0) {
-				wfatal("quitting");
-				quit(1);
-			}
+/*
+ * Render the textures of the workspaces next to the one shown while
+ * Window Maker has nothing else to ask, so that switching to them is fast.
+ */
+static void prerenderNeighbours(RContext * rc, BackgroundTexture ** textures, int workspace)
+{
+	BackgroundTexture *texture;
+	int i, n;
+
+	for (i = 0; i < 2; i++) {
+		n = (i == 0) ? workspace + 1 : workspace - 1;
+		if (n < 0 || n >= WORKSPACE_COUNT)
 			continue;
-		}
-		memcpy(buf, buffer, 4);
-		buf[4] = 0;
-		size = atoi(buf);
-		if (size < 0 || size > sizeof(buffer)) {
-			wfatal("received invalid size %d for message from WindowMaker", size);
-			quit(1);
-		}
-		if (size == 0) {
-			werror("received 0-sized message from WindowMaker, trying to continue");
+
+		texture = textures[n] ? textures[n] : textures[0];
+		if (!texture || texture->pixmap || texture->invalid)
 			continue;
+
+		if (inputPending())
+			return;
+
+		renderTexture(rc, textures, texture);
+	}
+}
+
+/*
+ * Returns 0 once 'size' bytes were read, 1 at the end of the input and
+ * -1 on error.
+ */
+static int readmsg(int fd, void *buffer, size_t size)
+{
+	char *ptr = buffer;
+	ssize_t count;
+
+	while (size > 0) {
+		count = read(fd, ptr, size);
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
 		}
+		if (count == 0)
+			return 1;
+		size -= count;
+		ptr += count;
+	}
 
-		/* get message */
-		if (readmsg(0, buffer, size) < 0) {
-			werror("error reading message from Window Maker");
-			errcount--;
-			if (errcount == 0) {
-				wfatal("quitting");
-				quit(1);
-			}
-			continue;
+	return 0;
+}
+
+static void acknowledge(int workspace)
+{
+	BGHelperHeader ack;
+
+	ack.version = BGHELPER_VERSION;
+	ack.type = 'A';
+	ack.workspace = workspace;
+	ack.length = 0;
+
+	while (write(STDOUT_FILENO, &ack, sizeof(ack)) < 0) {
+		if (errno != EINTR) {
+			werror("could not acknowledge message from Window Maker");
+			break;
 		}
-#ifdef DEBUG
-		printf("RECEIVED %s\n", buffer);
-#endif
-		if (buffer[0] != 'P' && buffer[0] != 'K') {
-			memcpy(buf, &buffer[1], 4);
-			buf[4] = 0;
-			workspace = atoi(buf);
-			if (workspace < 0 || workspace >= WORKSPACE_COUNT) {
-				wwarning("received message with invalid workspace number %i", workspace);
-				continue;
-			}
+	}
+}
+
+static noreturn void helperExit(int rcode)
+{
+	/* our pixmaps go away with us */
+	if (shownTexture)
+		changeTexture(shownTexture);
+	quit(rcode);
+}
+
+/*
+ * See src/bghelper.h for the messages. 'data' is null terminated.
+ */
+static void handleMessage(RContext * rc, BackgroundTexture ** textures, int *maxTextures,
+			  const BGHelperHeader * header, char *data)
+{
+	int workspace = header->workspace;
+
+	if (header->version != BGHELPER_VERSION) {
+		wfatal("received message with unsupported version %i from Window Maker", header->version);
+		quit(1);
+	}
+
+	if (header->type != 'P' && header->type != 'K' && header->type != 'B') {
+		if (workspace >= WORKSPACE_COUNT) {
+			wwarning("received message with invalid workspace number %i", workspace);
+			/* Window Maker waits for it before sending the next change */
+			if (header->type == 'C')
+				acknowledge(workspace);
+			return;
 		}
+	}
 
-		switch (buffer[0]) {
-		case 'S':
+	switch (header->type) {
+	case 'S':
 #ifdef DEBUG
-			printf("set texture %s\n", &buffer[5]);
+		fprintf(stderr, "set texture %s\n", data);
 #endif
-			setupTexture(rc, textures, &maxTextures, workspace, &buffer[5]);
-			break;
+		setupTexture(textures, maxTextures, workspace, data);
+		break;
 
-		case 'C':
+	case 'C':
 #ifdef DEBUG
-			printf("change texture %i\n", workspace);
+		fprintf(stderr, "change texture %i\n", workspace);
 #endif
-			if (!textures[workspace]) {
-				changeTexture(textures[0]);
-			} else {
-				changeTexture(textures[workspace]);
-			}
-			break;
+		if (!textures[workspace]) {
+			if (textures[0])
+				showTexture(rc, textures, textures[0]);
+		} else {
+			showTexture(rc, textures, textures[workspace]);
+		}
+		acknowledge(workspace);
+		prerenderNeighbours(rc, textures, workspace);
+		break;
 
-		case 'P':
+	case 'P':
 #ifdef DEBUG
-			printf("change pixmappath %s\n", &buffer[1]);
+		fprintf(stderr, "change pixmappath %s\n", data);
 #endif
-			if (PixmapPath)
-				wfree(PixmapPath);
-			PixmapPath = wstrdup(&buffer[1]);
-			break;
+		if (PixmapPath)
+			wfree(PixmapPath);
+		PixmapPath = wstrdup(data);
+		break;
 
-		case 'U':
+	case 'U':
 #ifdef DEBUG
-			printf("unset workspace %i\n", workspace);
+		fprintf(stderr, "unset workspace %i\n", workspace);
 #endif
-			setupTexture(rc, textures, &maxTextures, workspace, NULL);
-			break;
+		setupTexture(textures, maxTextures, workspace, NULL);
+		break;
 
-		case 'K':
+	case 'K':
 #ifdef DEBUG
-			printf("exit command\n");
+		fprintf(stderr, "exit command\n");
 #endif
-			quit(0);
+		helperExit(0);
 
-		default:
-			wwarning("unknown message received");
-			break;
+	case 'B':
+		{
+			BGHelperHeader sub;
+			uint32_t offset = 0;
+			char *subdata;
+
+			while (header->length - offset >= sizeof(sub)) {
+				memcpy(&sub, data + offset, sizeof(sub));
+				offset += sizeof(sub);
+				if (sub.length > header->length - offset) {
+					wwarning("received truncated message from Window Maker");
+					break;
+				}
+
+				subdata = wmalloc(sub.length + 1);
+				memcpy(subdata, data + offset, sub.length);
+				offset += sub.length;
+
+				handleMessage(rc, textures, maxTextures, &sub, subdata);
+				wfree(subdata);
+			}
 		}
+		break;
+
+	default:
+		wwarning("unknown message received");
+		break;
+	}
+}
+
+static noreturn void helperLoop(RContext * rc)
+{
+	BackgroundTexture *textures[WORKSPACE_COUNT];
+	int maxTextures = 0;
+	BGHelperHeader header;
+	char *data;
+	int result;
+	int errcount = 4;
+
+	memset(textures, 0, WORKSPACE_COUNT * sizeof(BackgroundTexture *));
+
+	/* we find out that Window Maker went away when reading */
+	signal(SIGPIPE, SIG_IGN);
+
+	while (1) {
+		result = readmsg(0, &header, sizeof(header));
+		if (result == 0 && header.length > BGHELPER_MAX_LENGTH) {
+			wfatal("received invalid size %u for message from WindowMaker", (unsigned) header.length);
+			quit(1);
+		}
+
+		data = NULL;
+		if (result == 0) {
+			data = wmalloc(header.length + 1);
+			result = readmsg(0, data, header.length);
+		}
+
+		if (result > 0)
+			helperExit(0);
+
+		if (result < 0) {
+			werror("error reading message from Window Maker");
+			if (data) {
+				/* the header was read, a lost change must still be answered */
+				if (header.type == 'C')
+					acknowledge(header.workspace);
+				wfree(data);
+			}
+			errcount--;
+			if (errcount == 0) {
+				wfatal("quitting");
+				quit(1);
+			}
+			continue;
+		}
+
+		handleMessage(rc, textures, &maxTextures, &header, data);
+		wfree(data);
 	}
 }
 
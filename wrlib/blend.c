@@ -0,0 +1,655 @@
+/* blend.c - pixel blending kernels for the RCombine* functions
+ *
+ * Raster graphics library
+ *
+ * Copyright (c) 2026 Window Maker Team
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *  MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <X11/Xlib.h>
+#include <string.h>
+
+#include "wraster.h"
+#include "blend.h"
+
+
+/*
+ *----------------------------------------------------------------------
+ * Scalar versions: this is the reference for the others
+ *----------------------------------------------------------------------
+ */
+static void scalar_rgba_over_rgb(unsigned char *d, const unsigned char *s, int count)
+{
+	int i, alpha, calpha;
+
+	for (i = 0; i < count; i++) {
+		alpha = s[3];
+		calpha = 255 - alpha;
+		d[0] = (((int)d[0] * calpha) + ((int)s[0] * alpha)) / 256;
+		d[1] = (((int)d[1] * calpha) + ((int)s[1] * alpha)) / 256;
+		d[2] = (((int)d[2] * calpha) + ((int)s[2] * alpha)) / 256;
+		d += 3;
+		s += 4;
+	}
+}
+
+static void scalar_rgba_over_rgb_opacity(unsigned char *d, const unsigned char *s, int count, int opacity)
+{
+	int i, tmp;
+
+	for (i = 0; i < count; i++) {
+		tmp = (s[3] * opacity) / 256;
+		d[0] = (((int)d[0] * (255 - tmp)) + ((int)s[0] * tmp)) / 256;
+		d[1] = (((int)d[1] * (255 - tmp)) + ((int)s[1] * tmp)) / 256;
+		d[2] = (((int)d[2] * (255 - tmp)) + ((int)s[2] * tmp)) / 256;
+		d += 3;
+		s += 4;
+	}
+}
+
+static void scalar_rgb_mix(unsigned char *d, const unsigned char *s, int count, int opacity)
+{
+	int i, c_opacity = 255 - opacity;
+
+	for (i = 0; i < count * 3; i++)
+		d[i] = (((int)d[i] * c_opacity) + ((int)s[i] * opacity)) / 256;
+}
+
+static void scalar_color_under_rgba(unsigned char *d, int count, int r, int g, int b)
+{
+	int i, alpha, nalpha;
+
+	for (i = 0; i < count; i++) {
+		alpha = d[3];
+		nalpha = 255 - alpha;
+		d[0] = (((int)d[0] * alpha) + (r * nalpha)) / 256;
+		d[1] = (((int)d[1] * alpha) + (g * nalpha)) / 256;
+		d[2] = (((int)d[2] * alpha) + (b * nalpha)) / 256;
+		d += 4;
+	}
+}
+
+/* based on Gimp 1.1.24 */
+static void scalar_alpha_combine(unsigned char *d, const unsigned char *s, int s_has_alpha,
+				 int count, int opacity)
+{
+	int x;
+	int t, sa;
+	int alpha;
+	float ratio, cratio;
+
+	for (x = 0; x < count; x++) {
+		sa = s_has_alpha ? s[3] : 255;
+
+		if (opacity != 255) {
+			t = sa * opacity + 0x80;
+			sa = ((t >> 8) + t) >> 8;
+		}
+
+		t = d[3] * (255 - sa) + 0x80;
+		alpha = sa + (((t >> 8) + t) >> 8);
+
+		if (sa == 0 || alpha == 0) {
+			ratio = 0;
+			cratio = 1.0;
+		} else if (sa == alpha) {
+			ratio = 1.0;
+			cratio = 0;
+		} else {
+			ratio = (float)sa / alpha;
+			cratio = 1.0F - ratio;
+		}
+
+		d[0] = (int)d[0] * cratio + (int)s[0] * ratio;
+		d[1] = (int)d[1] * cratio + (int)s[1] * ratio;
+		d[2] = (int)d[2] * cratio + (int)s[2] * ratio;
+		d[3] = alpha;
+
+		d += 4;
+		s += s_has_alpha ? 4 : 3;
+	}
+}
+
+static void scalar_box_step(unsigned char *d, int *acc, const unsigned char *add, const unsigned char *sub,
+			    int count, int scale)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		d[i] = (acc[i] * scale + 0x8000) >> 16;
+		acc[i] += add[i] - sub[i];
+	}
+}
+
+/* the weights use 7 bits, so that the SIMD versions stay on signed 16 bits */
+static void scalar_bilinear_span(unsigned char *d, const unsigned char *s, int stride,
+				 int u, int v, int du, int dv, int count)
+{
+	int i, c;
+
+	for (i = 0; i < count; i++, u += du, v += dv, d += 4) {
+		const unsigned char *p = s + (v >> 16) * stride + (u >> 16) * 4;
+		int fu = (u >> 9) & 127;
+		int fv = (v >> 9) & 127;
+
+		for (c = 0; c < 4; c++) {
+			int top = p[c] * (128 - fu) + p[c + 4] * fu;
+			int bottom = p[stride + c] * (128 - fu) + p[stride + c + 4] * fu;
+
+			d[c] = (top * (128 - fv) + bottom * fv + 8192) >> 14;
+		}
+	}
+}
+
+const RBlendFunctions R_BlendScalar = {
+	"scalar",
+	scalar_rgba_over_rgb,
+	scalar_rgba_over_rgb_opacity,
+	scalar_rgb_mix,
+	scalar_color_under_rgba,
+	scalar_alpha_combine,
+	scalar_box_step,
+	scalar_bilinear_span
+};
+
+
+#ifdef R_BLEND_X86
+/*
+ *----------------------------------------------------------------------
+ * x86 versions
+ *
+ * The integer kernels work on 16 bits lanes, where the weighted sum of
+ * two bytes never overflows. RCombineAlpha works with floats, it is only
+ * vectorized when the scalar code does not use a wider precision (x87).
+ * Anything left over at the end of a row goes through the scalar code.
+ *----------------------------------------------------------------------
+ */
+#include <float.h>
+#include <immintrin.h>
+
+#define SSE2_FN __attribute__((target("sse2")))
+#define AVX2_FN __attribute__((target("avx2")))
+
+/* (d * (255 - a) + s * a) >> 8 */
+static inline SSE2_FN __m128i sse2_mix16(__m128i d, __m128i s, __m128i a)
+{
+	__m128i ca = _mm_sub_epi16(_mm_set1_epi16(255), a);
+
+	return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(d, ca), _mm_mullo_epi16(s, a)), 8);
+}
+
+static SSE2_FN void sse2_rgb_mix(unsigned char *d, const unsigned char *s, int count, int opacity)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i op = _mm_set1_epi16(opacity);
+	int i, n = count * 3;
+
+	if (opacity < 0 || opacity > 255) {
+		scalar_rgb_mix(d, s, count, opacity);
+		return;
+	}
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__m128i dv = _mm_loadu_si128((const __m128i *)(d + i));
+		__m128i sv = _mm_loadu_si128((const __m128i *)(s + i));
+		__m128i lo, hi;
+
+		lo = sse2_mix16(_mm_unpacklo_epi8(dv, zero), _mm_unpacklo_epi8(sv, zero), op);
+		hi = sse2_mix16(_mm_unpackhi_epi8(dv, zero), _mm_unpackhi_epi8(sv, zero), op);
+		_mm_storeu_si128((__m128i *)(d + i), _mm_packus_epi16(lo, hi));
+	}
+
+	/* the operation is the same for every byte */
+	for (; i < n; i++)
+		d[i] = (((int)d[i] * (255 - opacity)) + ((int)s[i] * opacity)) / 256;
+}
+
+static SSE2_FN void sse2_color_under_rgba(unsigned char *d, int count, int r, int g, int b)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i color = _mm_set_epi16(0, b, g, r, 0, b, g, r);
+	const __m128i amask = _mm_set1_epi32(0xff000000);
+	int i;
+
+	for (i = 0; i + 4 <= count; i += 4, d += 16) {
+		__m128i dv = _mm_loadu_si128((const __m128i *)d);
+		__m128i lo = _mm_unpacklo_epi8(dv, zero);
+		__m128i hi = _mm_unpackhi_epi8(dv, zero);
+		__m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xff), 0xff);
+		__m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xff), 0xff);
+		__m128i res;
+
+		res = _mm_packus_epi16(sse2_mix16(color, lo, alo), sse2_mix16(color, hi, ahi));
+		res = _mm_or_si128(_mm_andnot_si128(amask, res), _mm_and_si128(amask, dv));
+		_mm_storeu_si128((__m128i *)d, res);
+	}
+
+	scalar_color_under_rgba(d, count - i, r, g, b);
+}
+
+static SSE2_FN void sse2_alpha_combine(unsigned char *d, const unsigned char *s, int s_has_alpha,
+				       int count, int opacity)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c255 = _mm_set1_epi32(255);
+	const __m128i c80 = _mm_set1_epi32(0x80);
+	const __m128i op = _mm_set1_epi32(opacity);
+	const __m128 one = _mm_set1_ps(1.0F);
+	int i, k;
+
+	if (!s_has_alpha || opacity < 0 || opacity > 255 || FLT_EVAL_METHOD != 0) {
+		scalar_alpha_combine(d, s, s_has_alpha, count, opacity);
+		return;
+	}
+
+	/* one pixel per 32 bits lane, the 16 bits operations only touch the low half */
+	for (i = 0; i + 4 <= count; i += 4, d += 16, s += 16) {
+		__m128i dv = _mm_loadu_si128((const __m128i *)d);
+		__m128i sv = _mm_loadu_si128((const __m128i *)s);
+		__m128i sa = _mm_srli_epi32(sv, 24);
+		__m128i t, alpha, special, same, res;
+		__m128 ratio, cratio, keep;
+
+		if (opacity != 255) {
+			t = _mm_add_epi16(_mm_mullo_epi16(sa, op), c80);
+			sa = _mm_srli_epi16(_mm_add_epi16(_mm_srli_epi16(t, 8), t), 8);
+		}
+
+		t = _mm_add_epi16(_mm_mullo_epi16(_mm_srli_epi32(dv, 24), _mm_sub_epi16(c255, sa)), c80);
+		alpha = _mm_add_epi16(sa, _mm_srli_epi16(_mm_add_epi16(_mm_srli_epi16(t, 8), t), 8));
+
+		ratio = _mm_div_ps(_mm_cvtepi32_ps(sa), _mm_cvtepi32_ps(alpha));
+		cratio = _mm_sub_ps(one, ratio);
+
+		special = _mm_or_si128(_mm_cmpeq_epi32(sa, zero), _mm_cmpeq_epi32(alpha, zero));
+		same = _mm_andnot_si128(special, _mm_cmpeq_epi32(sa, alpha));
+		keep = _mm_castsi128_ps(_mm_or_si128(special, same));
+		ratio = _mm_or_ps(_mm_andnot_ps(keep, ratio), _mm_and_ps(_mm_castsi128_ps(same), one));
+		cratio = _mm_or_ps(_mm_andnot_ps(keep, cratio), _mm_and_ps(_mm_castsi128_ps(special), one));
+
+		res = _mm_slli_epi32(alpha, 24);
+		for (k = 0; k < 24; k += 8) {
+			__m128 dc = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(dv, k), c255));
+			__m128 sc = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(sv, k), c255));
+			__m128i v = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(dc, cratio), _mm_mul_ps(sc, ratio)));
+
+			res = _mm_or_si128(res, _mm_slli_epi32(v, k));
+		}
+		_mm_storeu_si128((__m128i *)d, res);
+	}
+
+	scalar_alpha_combine(d, s, s_has_alpha, count - i, opacity);
+}
+
+/* SSE2 has no 32 bits multiply, do it with two 32x32->64 ones */
+static inline SSE2_FN __m128i sse2_mullo_epi32(__m128i a, __m128i b)
+{
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, 0x08), _mm_shuffle_epi32(odd, 0x08));
+}
+
+static SSE2_FN void sse2_box_step(unsigned char *d, int *acc, const unsigned char *add, const unsigned char *sub,
+				  int count, int scale)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi32(0x8000);
+	const __m128i mul = _mm_set1_epi32(scale);
+	int i, k;
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(add + i));
+		__m128i s = _mm_loadu_si128((const __m128i *)(sub + i));
+		__m128i a16[2], s16[2], v[4];
+
+		a16[0] = _mm_unpacklo_epi8(a, zero);
+		a16[1] = _mm_unpackhi_epi8(a, zero);
+		s16[0] = _mm_unpacklo_epi8(s, zero);
+		s16[1] = _mm_unpackhi_epi8(s, zero);
+
+		for (k = 0; k < 4; k++) {
+			__m128i *p = (__m128i *)(acc + i + k * 4);
+			__m128i sum = _mm_loadu_si128(p);
+			__m128i da, ds;
+
+			v[k] = _mm_srli_epi32(_mm_add_epi32(sse2_mullo_epi32(sum, mul), round), 16);
+
+			if (k & 1) {
+				da = _mm_unpackhi_epi16(a16[k / 2], zero);
+				ds = _mm_unpackhi_epi16(s16[k / 2], zero);
+			} else {
+				da = _mm_unpacklo_epi16(a16[k / 2], zero);
+				ds = _mm_unpacklo_epi16(s16[k / 2], zero);
+			}
+			_mm_storeu_si128(p, _mm_sub_epi32(_mm_add_epi32(sum, da), ds));
+		}
+
+		_mm_storeu_si128((__m128i *)(d + i),
+				 _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3])));
+	}
+
+	scalar_box_step(d + i, acc + i, add + i, sub + i, count - i, scale);
+}
+
+/* one pixel per step, its 4 channels side by side */
+static SSE2_FN void sse2_bilinear_span(unsigned char *d, const unsigned char *s, int stride,
+				       int u, int v, int du, int dv, int count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi32(8192);
+	int i, pixel;
+
+	for (i = 0; i < count; i++, u += du, v += dv, d += 4) {
+		const unsigned char *p = s + (v >> 16) * stride + (u >> 16) * 4;
+		int fu = (u >> 9) & 127;
+		int fv = (v >> 9) & 127;
+		__m128i wu = _mm_set1_epi32((fu << 16) | (128 - fu));
+		__m128i wv = _mm_set1_epi32((fv << 16) | (128 - fv));
+		__m128i top = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p), zero);
+		__m128i bottom = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(p + stride)), zero);
+		__m128i res;
+
+		/* pair each channel with the same one of the next pixel (or row) */
+		top = _mm_madd_epi16(_mm_unpacklo_epi16(top, _mm_srli_si128(top, 8)), wu);
+		bottom = _mm_madd_epi16(_mm_unpacklo_epi16(bottom, _mm_srli_si128(bottom, 8)), wu);
+		res = _mm_packs_epi32(top, bottom);
+		res = _mm_madd_epi16(_mm_unpacklo_epi16(res, _mm_srli_si128(res, 8)), wv);
+		res = _mm_srai_epi32(_mm_add_epi32(res, round), 14);
+		res = _mm_packs_epi32(res, res);
+
+		pixel = _mm_cvtsi128_si32(_mm_packus_epi16(res, res));
+		memcpy(d, &pixel, 4);
+	}
+}
+
+/*
+ * RGB destinations need byte shuffles (SSSE3), so they are left to the
+ * AVX2 set and stay scalar with plain SSE2.
+ */
+const RBlendFunctions R_BlendSSE2 = {
+	"sse2",
+	scalar_rgba_over_rgb,
+	scalar_rgba_over_rgb_opacity,
+	sse2_rgb_mix,
+	sse2_color_under_rgba,
+	sse2_alpha_combine,
+	sse2_box_step,
+	sse2_bilinear_span
+};
+
+
+/* (d * (255 - a) + s * a) >> 8 */
+static inline AVX2_FN __m256i avx2_mix16(__m256i d, __m256i s, __m256i a)
+{
+	__m256i ca = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+
+	return _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(d, ca), _mm256_mullo_epi16(s, a)), 8);
+}
+
+/* load 8 RGB pixels as RGB0, reads 28 bytes */
+static inline AVX2_FN __m256i avx2_load_rgb(const unsigned char *p, __m128i *lo, __m128i *hi)
+{
+	const __m256i expand = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+						0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+
+	*lo = _mm_loadu_si128((const __m128i *)p);
+	*hi = _mm_loadu_si128((const __m128i *)(p + 12));
+
+	return _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(*lo), *hi, 1), expand);
+}
+
+/* store 8 RGB0 pixels as RGB, keeping the 4 bytes after them as read by avx2_load_rgb */
+static inline AVX2_FN void avx2_store_rgb(unsigned char *p, __m256i v, __m128i lo, __m128i hi)
+{
+	const __m256i compact = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+						 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	const __m128i tail = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1);
+	__m256i c = _mm256_shuffle_epi8(v, compact);
+
+	/* the first store overlaps the second one, it must be done first */
+	_mm_storeu_si128((__m128i *)p,
+			 _mm_or_si128(_mm256_castsi256_si128(c), _mm_and_si128(tail, lo)));
+	_mm_storeu_si128((__m128i *)(p + 12),
+			 _mm_or_si128(_mm256_extracti128_si256(c, 1), _mm_and_si128(tail, hi)));
+}
+
+static AVX2_FN void avx2_rgba_over_rgb_opacity(unsigned char *d, const unsigned char *s, int count, int opacity)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i op = _mm256_set1_epi16(opacity);
+	int i;
+
+	if (opacity < 0 || opacity > 255) {
+		scalar_rgba_over_rgb_opacity(d, s, count, opacity);
+		return;
+	}
+
+	for (i = 0; i + 10 <= count; i += 8, d += 24, s += 32) {
+		__m128i dlo, dhi;
+		__m256i dv = avx2_load_rgb(d, &dlo, &dhi);
+		__m256i sv = _mm256_loadu_si256((const __m256i *)s);
+		__m256i slo = _mm256_unpacklo_epi8(sv, zero);
+		__m256i shi = _mm256_unpackhi_epi8(sv, zero);
+		__m256i alo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(slo, 0xff), 0xff);
+		__m256i ahi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(shi, 0xff), 0xff);
+
+		alo = _mm256_srli_epi16(_mm256_mullo_epi16(alo, op), 8);
+		ahi = _mm256_srli_epi16(_mm256_mullo_epi16(ahi, op), 8);
+
+		dv = _mm256_packus_epi16(avx2_mix16(_mm256_unpacklo_epi8(dv, zero), slo, alo),
+					 avx2_mix16(_mm256_unpackhi_epi8(dv, zero), shi, ahi));
+		avx2_store_rgb(d, dv, dlo, dhi);
+	}
+
+	scalar_rgba_over_rgb_opacity(d, s, count - i, opacity);
+}
+
+static AVX2_FN void avx2_rgba_over_rgb(unsigned char *d, const unsigned char *s, int count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	int i;
+
+	for (i = 0; i + 10 <= count; i += 8, d += 24, s += 32) {
+		__m128i dlo, dhi;
+		__m256i dv = avx2_load_rgb(d, &dlo, &dhi);
+		__m256i sv = _mm256_loadu_si256((const __m256i *)s);
+		__m256i slo = _mm256_unpacklo_epi8(sv, zero);
+		__m256i shi = _mm256_unpackhi_epi8(sv, zero);
+		__m256i alo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(slo, 0xff), 0xff);
+		__m256i ahi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(shi, 0xff), 0xff);
+
+		dv = _mm256_packus_epi16(avx2_mix16(_mm256_unpacklo_epi8(dv, zero), slo, alo),
+					 avx2_mix16(_mm256_unpackhi_epi8(dv, zero), shi, ahi));
+		avx2_store_rgb(d, dv, dlo, dhi);
+	}
+
+	scalar_rgba_over_rgb(d, s, count - i);
+}
+
+static AVX2_FN void avx2_rgb_mix(unsigned char *d, const unsigned char *s, int count, int opacity)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i op = _mm256_set1_epi16(opacity);
+	int i, n = count * 3;
+
+	if (opacity < 0 || opacity > 255) {
+		scalar_rgb_mix(d, s, count, opacity);
+		return;
+	}
+
+	for (i = 0; i + 32 <= n; i += 32) {
+		__m256i dv = _mm256_loadu_si256((const __m256i *)(d + i));
+		__m256i sv = _mm256_loadu_si256((const __m256i *)(s + i));
+		__m256i lo, hi;
+
+		lo = avx2_mix16(_mm256_unpacklo_epi8(dv, zero), _mm256_unpacklo_epi8(sv, zero), op);
+		hi = avx2_mix16(_mm256_unpackhi_epi8(dv, zero), _mm256_unpackhi_epi8(sv, zero), op);
+		_mm256_storeu_si256((__m256i *)(d + i), _mm256_packus_epi16(lo, hi));
+	}
+
+	for (; i < n; i++)
+		d[i] = (((int)d[i] * (255 - opacity)) + ((int)s[i] * opacity)) / 256;
+}
+
+static AVX2_FN void avx2_color_under_rgba(unsigned char *d, int count, int r, int g, int b)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i color = _mm256_setr_epi16(r, g, b, 0, r, g, b, 0, r, g, b, 0, r, g, b, 0);
+	const __m256i amask = _mm256_set1_epi32(0xff000000);
+	int i;
+
+	for (i = 0; i + 8 <= count; i += 8, d += 32) {
+		__m256i dv = _mm256_loadu_si256((const __m256i *)d);
+		__m256i lo = _mm256_unpacklo_epi8(dv, zero);
+		__m256i hi = _mm256_unpackhi_epi8(dv, zero);
+		__m256i alo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, 0xff), 0xff);
+		__m256i ahi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, 0xff), 0xff);
+		__m256i res;
+
+		res = _mm256_packus_epi16(avx2_mix16(color, lo, alo), avx2_mix16(color, hi, ahi));
+		res = _mm256_or_si256(_mm256_andnot_si256(amask, res), _mm256_and_si256(amask, dv));
+		_mm256_storeu_si256((__m256i *)d, res);
+	}
+
+	scalar_color_under_rgba(d, count - i, r, g, b);
+}
+
+static AVX2_FN void avx2_alpha_combine(unsigned char *d, const unsigned char *s, int s_has_alpha,
+				       int count, int opacity)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i c255 = _mm256_set1_epi32(255);
+	const __m256i c80 = _mm256_set1_epi32(0x80);
+	const __m256i op = _mm256_set1_epi32(opacity);
+	const __m256 one = _mm256_set1_ps(1.0F);
+	/* RGB sources are read with avx2_load_rgb, which goes past the 8 pixels */
+	int last = s_has_alpha ? 8 : 10;
+	int sstep = s_has_alpha ? 32 : 24;
+	int i, k;
+
+	if (opacity < 0 || opacity > 255 || FLT_EVAL_METHOD != 0) {
+		scalar_alpha_combine(d, s, s_has_alpha, count, opacity);
+		return;
+	}
+
+	for (i = 0; i + last <= count; i += 8, d += 32, s += sstep) {
+		__m256i dv = _mm256_loadu_si256((const __m256i *)d);
+		__m256i sv, sa, t, alpha, special, same, res;
+		__m256 ratio, cratio, keep;
+
+		if (s_has_alpha) {
+			sv = _mm256_loadu_si256((const __m256i *)s);
+			sa = _mm256_srli_epi32(sv, 24);
+		} else {
+			__m128i lo, hi;
+
+			sv = avx2_load_rgb(s, &lo, &hi);
+			sa = c255;
+		}
+
+		if (opacity != 255) {
+			t = _mm256_add_epi32(_mm256_mullo_epi32(sa, op), c80);
+			sa = _mm256_srli_epi32(_mm256_add_epi32(_mm256_srli_epi32(t, 8), t), 8);
+		}
+
+		t = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(dv, 24), _mm256_sub_epi32(c255, sa)), c80);
+		alpha = _mm256_add_epi32(sa, _mm256_srli_epi32(_mm256_add_epi32(_mm256_srli_epi32(t, 8), t), 8));
+
+		ratio = _mm256_div_ps(_mm256_cvtepi32_ps(sa), _mm256_cvtepi32_ps(alpha));
+		cratio = _mm256_sub_ps(one, ratio);
+
+		special = _mm256_or_si256(_mm256_cmpeq_epi32(sa, zero), _mm256_cmpeq_epi32(alpha, zero));
+		same = _mm256_andnot_si256(special, _mm256_cmpeq_epi32(sa, alpha));
+		keep = _mm256_castsi256_ps(_mm256_or_si256(special, same));
+		ratio = _mm256_or_ps(_mm256_andnot_ps(keep, ratio), _mm256_and_ps(_mm256_castsi256_ps(same), one));
+		cratio = _mm256_or_ps(_mm256_andnot_ps(keep, cratio), _mm256_and_ps(_mm256_castsi256_ps(special), one));
+
+		res = _mm256_slli_epi32(alpha, 24);
+		for (k = 0; k < 24; k += 8) {
+			__m256 dc = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(dv, k), c255));
+			__m256 sc = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(sv, k), c255));
+			__m256i v = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(dc, cratio), _mm256_mul_ps(sc, ratio)));
+
+			res = _mm256_or_si256(res, _mm256_slli_epi32(v, k));
+		}
+		_mm256_storeu_si256((__m256i *)d, res);
+	}
+
+	scalar_alpha_combine(d, s, s_has_alpha, count - i, opacity);
+}
+
+static AVX2_FN void avx2_box_step(unsigned char *d, int *acc, const unsigned char *add, const unsigned char *sub,
+				  int count, int scale)
+{
+	const __m256i round = _mm256_set1_epi32(0x8000);
+	const __m256i mul = _mm256_set1_epi32(scale);
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	int i, k;
+
+	for (i = 0; i + 32 <= count; i += 32) {
+		__m256i v[4];
+
+		for (k = 0; k < 4; k++) {
+			__m256i *p = (__m256i *)(acc + i + k * 8);
+			__m256i sum = _mm256_loadu_si256(p);
+			__m256i da = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(add + i + k * 8)));
+			__m256i ds = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(sub + i + k * 8)));
+
+			v[k] = _mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(sum, mul), round), 16);
+			_mm256_storeu_si256(p, _mm256_sub_epi32(_mm256_add_epi32(sum, da), ds));
+		}
+
+		/* the packs work inside each 128 bits half, put the bytes back in order */
+		v[0] = _mm256_packus_epi16(_mm256_packs_epi32(v[0], v[1]), _mm256_packs_epi32(v[2], v[3]));
+		_mm256_storeu_si256((__m256i *)(d + i), _mm256_permutevar8x32_epi32(v[0], order));
+	}
+
+	scalar_box_step(d + i, acc + i, add + i, sub + i, count - i, scale);
+}
+
+const RBlendFunctions R_BlendAVX2 = {
+	"avx2",
+	avx2_rgba_over_rgb,
+	avx2_rgba_over_rgb_opacity,
+	avx2_rgb_mix,
+	avx2_color_under_rgba,
+	avx2_alpha_combine,
+	avx2_box_step,
+	sse2_bilinear_span
+};
+#endif	/* R_BLEND_X86 */
+
+
+const RBlendFunctions *R_Blend = &R_BlendScalar;
+
+/*
+ * Called when a context is created: the RCombine* functions can be used
+ * before that, they will use the scalar code.
+ */
+void R_InitBlendFunctions(void)
+{
+#ifdef R_BLEND_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		R_Blend = &R_BlendAVX2;
+	else if (__builtin_cpu_supports("sse2"))
+		R_Blend = &R_BlendSSE2;
+#endif
+}
@@ -0,0 +1,82 @@
+/*
+ * Raster graphics library
+ *
+ * Copyright (c) 2026 Window Maker Team
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public
+ *  License along with this library.
+ */
+
+#ifndef WRASTER_BLEND_H
+#define WRASTER_BLEND_H
+
+
+/*
+ * Pixel kernels used by the RCombine*, RBlurImageRadius and RRotateImage
+ * functions.
+ *
+ * Each one works on 'count' consecutive pixels of a single row. The
+ * vectorized versions must give exactly the same result as the scalar ones,
+ * the choice is made at run time from what the CPU supports.
+ */
+typedef struct RBlendFunctions {
+	const char *name;
+
+	/* RGBA src over RGB dst: d = (d * (255 - sa) + s * sa) / 256 */
+	void (*rgba_over_rgb)(unsigned char *d, const unsigned char *s, int count);
+
+	/* same as above, with sa scaled by opacity first */
+	void (*rgba_over_rgb_opacity)(unsigned char *d, const unsigned char *s, int count, int opacity);
+
+	/* RGB src mixed into RGB dst with a constant opacity */
+	void (*rgb_mix)(unsigned char *d, const unsigned char *s, int count, int opacity);
+
+	/* solid color put behind the transparent parts of RGBA dst */
+	void (*color_under_rgba)(unsigned char *d, int count, int r, int g, int b);
+
+	/* RGB or RGBA src over RGBA dst, see RCombineAlpha */
+	void (*alpha_combine)(unsigned char *d, const unsigned char *s, int s_has_alpha, int count, int opacity);
+
+	/*
+	 * One step of a running sum box filter over 'count' bytes:
+	 *   d = (acc * scale + 0x8000) >> 16, then acc += add - sub
+	 * where acc * scale must fit in 24 bits
+	 */
+	void (*box_step)(unsigned char *d, int *acc, const unsigned char *add, const unsigned char *sub,
+			 int count, int scale);
+
+	/*
+	 * Bilinear sampling of RGBA src along a line, for rotations: (u, v) are
+	 * 16.16 fixed point coordinates in src, moved by (du, dv) for each
+	 * pixel of d; every 2x2 block read must be inside src
+	 */
+	void (*bilinear_span)(unsigned char *d, const unsigned char *s, int stride,
+			      int u, int v, int du, int dv, int count);
+} RBlendFunctions;
+
+extern const RBlendFunctions R_BlendScalar;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define R_BLEND_X86
+
+extern const RBlendFunctions R_BlendSSE2;
+extern const RBlendFunctions R_BlendAVX2;
+#endif
+
+/* functions currently in use by the library */
+extern const RBlendFunctions *R_Blend;
+
+void R_InitBlendFunctions(void);
+
+
+#endif
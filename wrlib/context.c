@@ -39,6 +39,8 @@
 
 #include "wraster.h"
 #include "scale.h"
+#include "xutil.h"
+#include "blend.h"
 
 
 #ifndef HAVE_FLOAT_MATHFUNC
@@ -531,6 +533,8 @@ RContext *RCreateContext(Display * dpy, int screen_number, const RContextAttribu
 	}
 	memset(context, 0, sizeof(RContext));
 
+	R_InitBlendFunctions();
+
 	context->dpy = dpy;
 
 	context->screen_number = screen_number;
@@ -660,6 +664,9 @@ RContext *RCreateContext(Display * dpy, int screen_number, const RContextAttribu
 void RDestroyContext(RContext *context)
 {
 	if (context) {
+#ifdef USE_XSHM
+		R_DestroyCaptureSegment(context);
+#endif
 		if (context->copy_gc)
 			XFreeGC(context->dpy, context->copy_gc);
 		if (context->attribs) {
@@ -25,7 +25,14 @@
 #include <stdio.h>
 #include <string.h>
 #include <X11/Xlib.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 #include "wraster.h"
+#include "blend.h"
 
 /*
  *----------------------------------------------------------------------
@@ -140,3 +147,199 @@ int RBlurImage(RImage * image)
 	return True;
 }
 
+
+
+/*
+ *----------------------------------------------------------------------
+ * RBlurImageRadius--
+ * 	Blur the image over 'radius' pixels with three box filters, which
+ * is close to a gaussian blur. Each box is a running sum done on rows
+ * then on columns, so the cost does not depend on the radius.
+ *
+ *	All the channels are filtered, alpha included. Big images are split
+ * between several threads, when available.
+ *----------------------------------------------------------------------
+ */
+
+/* below this, threads cost more than they bring */
+#define BLUR_THREAD_PIXELS	(512 * 1024)
+#define BLUR_MAX_THREADS	8
+
+typedef struct BlurJob {
+	unsigned char *src;
+	unsigned char *dst;
+	int *acc;
+	int width, height, ch;
+	int radius, scale;
+	int first, last;	/* rows for blur_rows, bytes of a row for blur_columns */
+} BlurJob;
+
+static void *blur_rows(void *arg)
+{
+	BlurJob *job = arg;
+	int width = job->width, ch = job->ch, r = job->radius;
+	int acc[4];
+	int x, y, c;
+
+	for (y = job->first; y < job->last; y++) {
+		const unsigned char *s = job->src + y * width * ch;
+		unsigned char *d = job->dst + y * width * ch;
+
+		for (c = 0; c < ch; c++) {
+			acc[c] = s[c] * (r + 1);
+			for (x = 1; x <= r; x++)
+				acc[c] += s[(x < width ? x : width - 1) * ch + c];
+		}
+
+		for (x = 0; x < width; x++) {
+			int add = (x + r + 1 < width ? x + r + 1 : width - 1) * ch;
+			int sub = (x - r > 0 ? x - r : 0) * ch;
+
+			for (c = 0; c < ch; c++) {
+				*d++ = (acc[c] * job->scale + 0x8000) >> 16;
+				acc[c] += s[add + c] - s[sub + c];
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static void *blur_columns(void *arg)
+{
+	BlurJob *job = arg;
+	int stride = job->width * job->ch;
+	int height = job->height, r = job->radius;
+	int count = job->last - job->first;
+	const unsigned char *s = job->src + job->first;
+	unsigned char *d = job->dst + job->first;
+	int *acc = job->acc + job->first;
+	int i, y;
+
+	for (i = 0; i < count; i++)
+		acc[i] = s[i] * (r + 1);
+	for (y = 1; y <= r; y++) {
+		const unsigned char *row = s + (y < height ? y : height - 1) * stride;
+
+		for (i = 0; i < count; i++)
+			acc[i] += row[i];
+	}
+
+	for (y = 0; y < height; y++) {
+		int add = (y + r + 1 < height ? y + r + 1 : height - 1);
+		int sub = (y - r > 0 ? y - r : 0);
+
+		R_Blend->box_step(d + y * stride, acc, s + add * stride, s + sub * stride, count, job->scale);
+	}
+
+	return NULL;
+}
+
+static void run_jobs(void *(*func)(void *), BlurJob *jobs, int njobs)
+{
+	int i;
+#ifdef HAVE_PTHREAD
+	pthread_t threads[BLUR_MAX_THREADS];
+	int started;
+
+	for (i = 1; i < njobs; i++)
+		if (pthread_create(&threads[i], NULL, func, &jobs[i]) != 0)
+			break;
+	started = i;
+
+	func(&jobs[0]);
+	/* the jobs whose thread could not be created are done here */
+	for (i = started; i < njobs; i++)
+		func(&jobs[i]);
+
+	for (i = 1; i < started; i++)
+		pthread_join(threads[i], NULL);
+#else
+	for (i = 0; i < njobs; i++)
+		func(&jobs[i]);
+#endif
+}
+
+static int blur_thread_count(RImage *image)
+{
+#ifdef HAVE_PTHREAD
+	long n;
+
+	if (image->width * image->height < BLUR_THREAD_PIXELS)
+		return 1;
+
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n < 1)
+		return 1;
+
+	return n < BLUR_MAX_THREADS ? n : BLUR_MAX_THREADS;
+#else
+	(void) image;
+
+	return 1;
+#endif
+}
+
+int RBlurImageRadius(RImage * image, int radius)
+{
+	BlurJob jobs[BLUR_MAX_THREADS];
+	int ch = image->format == RRGBAFormat ? 4 : 3;
+	int stride = image->width * ch;
+	int boxes[3];
+	int njobs, pass, i;
+	unsigned char *tmp;
+	int *acc;
+
+	if (radius <= 0 || image->width < 1 || image->height < 1)
+		return True;
+
+	tmp = malloc(stride * image->height);
+	acc = malloc(stride * sizeof(int));
+	if (!tmp || !acc) {
+		free(tmp);
+		free(acc);
+		RErrorCode = RERR_NOMEMORY;
+		return False;
+	}
+
+	/* spread the radius over the 3 boxes, the biggest ones first */
+	for (i = 0; i < 3; i++)
+		boxes[i] = (radius + 2 - i) / 3;
+
+	njobs = blur_thread_count(image);
+
+	for (pass = 0; pass < 3 && boxes[pass] > 0; pass++) {
+		int r = boxes[pass];
+		int scale = 65536 / (2 * r + 1);
+
+		for (i = 0; i < njobs; i++) {
+			jobs[i].acc = acc;
+			jobs[i].width = image->width;
+			jobs[i].height = image->height;
+			jobs[i].ch = ch;
+			jobs[i].radius = r;
+			jobs[i].scale = scale;
+		}
+
+		for (i = 0; i < njobs; i++) {
+			jobs[i].src = image->data;
+			jobs[i].dst = tmp;
+			jobs[i].first = image->height * i / njobs;
+			jobs[i].last = image->height * (i + 1) / njobs;
+		}
+		run_jobs(blur_rows, jobs, njobs);
+
+		for (i = 0; i < njobs; i++) {
+			jobs[i].src = tmp;
+			jobs[i].dst = image->data;
+			jobs[i].first = stride * i / njobs;
+			jobs[i].last = stride * (i + 1) / njobs;
+		}
+		run_jobs(blur_columns, jobs, njobs);
+	}
+
+	free(tmp);
+	free(acc);
+
+	return True;
+}
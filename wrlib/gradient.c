@@ -83,6 +83,109 @@ RImage *RRenderGradient(unsigned width, unsigned height, const RColor *from, con
 	return NULL;
 }
 
+/*
+ * Fills a line of 'width' pixels with a single color: the first pixel is
+ * set and then copied over, doubling the size of the copy every time.
+ */
+static inline unsigned char *renderGradientWidth(unsigned char *ptr, unsigned width, unsigned char r, unsigned char g, unsigned char b)
+{
+	unsigned size = width * 3;
+	unsigned done;
+
+	if (width == 0)
+		return ptr;
+
+	ptr[0] = r;
+	ptr[1] = g;
+	ptr[2] = b;
+
+	for (done = 3; done < size; done *= 2)
+		memcpy(ptr + done, ptr, (size - done < done) ? size - done : done);
+
+	return ptr + size;
+}
+
+/*
+ * Renders 'count' pixels of a linear gradient, starting at pixel 'start' of
+ * the line: the color is (r0, g0, b0) on pixel 0 and is moved by
+ * (dr, dg, db), in 16.16 fixed point, for every pixel.
+ */
+static void renderLine(unsigned char *ptr, unsigned start, unsigned count,
+		       int r0, int g0, int b0, long dr, long dg, long db)
+{
+	long r, g, b;
+
+	r = ((long)r0 << 16) + (long)start * dr;
+	g = ((long)g0 << 16) + (long)start * dg;
+	b = ((long)b0 << 16) + (long)start * db;
+
+	while (count--) {
+		*(ptr++) = (unsigned char)(r >> 16);
+		*(ptr++) = (unsigned char)(g >> 16);
+		*(ptr++) = (unsigned char)(b >> 16);
+		r += dr;
+		g += dg;
+		b += db;
+	}
+}
+
+/*
+ * Same as renderLine for a multicolor gradient 'width' pixels long: the
+ * line is split in ncolors - 1 parts of the same size, and what is left at
+ * the end gets the last color.
+ */
+static void renderMLine(unsigned char *ptr, unsigned width, unsigned start, unsigned count,
+			RColor **colors, int ncolors)
+{
+	unsigned width2 = width / (ncolors - 1);
+	unsigned end = start + count;
+	unsigned k = start;
+	unsigned i, n;
+
+	for (i = k / width2; i < (unsigned)(ncolors - 1) && k < end; i++) {
+		n = (i + 1) * width2;
+		if (n > end)
+			n = end;
+
+		renderLine(ptr, k - i * width2, n - k,
+			   colors[i]->red, colors[i]->green, colors[i]->blue,
+			   ((int)(colors[i + 1]->red - colors[i]->red) << 16) / (int)width2,
+			   ((int)(colors[i + 1]->green - colors[i]->green) << 16) / (int)width2,
+			   ((int)(colors[i + 1]->blue - colors[i]->blue) << 16) / (int)width2);
+		ptr += (n - k) * 3;
+		k = n;
+	}
+
+	if (k < end)
+		renderGradientWidth(ptr, end - k, colors[ncolors - 1]->red,
+				    colors[ncolors - 1]->green, colors[ncolors - 1]->blue);
+}
+
+/*
+ * A diagonal gradient is a horizontal one 2 * width - 1 pixels long, of
+ * which every row shows a part shifted a bit more to the right. The first
+ * row holds the first width pixels of it and the last row the last ones,
+ * so the rows in between are put together from these two.
+ */
+static void copyDiagonalRows(RImage *image)
+{
+	unsigned width = image->width;
+	unsigned height = image->height;
+	unsigned lineSize = width * 3;
+	unsigned char *first = image->data;
+	unsigned char *last = image->data + (height - 1) * lineSize;
+	unsigned char *ptr;
+	unsigned long offset;
+	unsigned j;
+
+	for (j = 1, ptr = first + lineSize; j < height - 1; j++, ptr += lineSize) {
+		offset = (unsigned long)j * (width - 1) / (height - 1);
+
+		memcpy(ptr, first + offset * 3, (width - offset) * 3);
+		memcpy(ptr + (width - offset) * 3, last + 3, offset * 3);
+	}
+}
+
 /*
  *----------------------------------------------------------------------
  * renderHGradient--
@@ -99,33 +202,19 @@ RImage *RRenderGradient(unsigned width, unsigned height, const RColor *from, con
 static RImage *renderHGradient(unsigned width, unsigned height, int r0, int g0, int b0, int rf, int gf, int bf)
 {
 	int i;
-	long r, g, b, dr, dg, db;
 	unsigned lineSize = width * 3;
 	RImage *image;
-	unsigned char *ptr;
 
 	image = RCreateImage(width, height, False);
 	if (!image) {
 		return NULL;
 	}
-	ptr = image->data;
 
-	r = r0 << 16;
-	g = g0 << 16;
-	b = b0 << 16;
-
-	dr = ((rf - r0) << 16) / (int)width;
-	dg = ((gf - g0) << 16) / (int)width;
-	db = ((bf - b0) << 16) / (int)width;
 	/* render the first line */
-	for (i = 0; i < width; i++) {
-		*(ptr++) = (unsigned char)(r >> 16);
-		*(ptr++) = (unsigned char)(g >> 16);
-		*(ptr++) = (unsigned char)(b >> 16);
-		r += dr;
-		g += dg;
-		b += db;
-	}
+	renderLine(image->data, 0, width, r0, g0, b0,
+		   ((rf - r0) << 16) / (int)width,
+		   ((gf - g0) << 16) / (int)width,
+		   ((bf - b0) << 16) / (int)width);
 
 	/* copy the first line to the other lines */
 	for (i = 1; i < height; i++) {
@@ -134,46 +223,6 @@ static RImage *renderHGradient(unsigned width, unsigned height, int r0, int g0,
 	return image;
 }
 
-static inline unsigned char *renderGradientWidth(unsigned char *ptr, unsigned width, unsigned char r, unsigned char g, unsigned char b)
-{
-	int i;
-
-	for (i = width / 4; i--;) {
-		*ptr++ = r;
-		*ptr++ = g;
-		*ptr++ = b;
-
-		*ptr++ = r;
-		*ptr++ = g;
-		*ptr++ = b;
-
-		*ptr++ = r;
-		*ptr++ = g;
-		*ptr++ = b;
-
-		*ptr++ = r;
-		*ptr++ = g;
-		*ptr++ = b;
-	}
-	switch (width % 4) {
-	case 3:
-		*ptr++ = r;
-		*ptr++ = g;
-		*ptr++ = b;
-		/* FALLTHRU */
-	case 2:
-		*ptr++ = r;
-		*ptr++ = g;
-		*ptr++ = b;
-		/* FALLTHRU */
-	case 1:
-		*ptr++ = r;
-		*ptr++ = g;
-		*ptr++ = b;
-	}
-	return ptr;
-}
-
 /*
  *----------------------------------------------------------------------
  * renderVGradient--
@@ -233,10 +282,8 @@ static RImage *renderVGradient(unsigned width, unsigned height, int r0, int g0,
 
 static RImage *renderDGradient(unsigned width, unsigned height, int r0, int g0, int b0, int rf, int gf, int bf)
 {
-	RImage *image, *tmp;
-	int j;
-	float a, offset;
-	unsigned char *ptr;
+	RImage *image;
+	long dr, dg, db;
 
 	if (width == 1)
 		return renderVGradient(width, height, r0, g0, b0, rf, gf, bf);
@@ -248,35 +295,23 @@ static RImage *renderDGradient(unsigned width, unsigned height, int r0, int g0,
 		return NULL;
 	}
 
-	tmp = renderHGradient(2 * width - 1, 1, r0, g0, b0, rf, gf, bf);
-	if (!tmp) {
-		RReleaseImage(image);
-		return NULL;
-	}
-
-	ptr = tmp->data;
+	dr = ((rf - r0) << 16) / (int)(2 * width - 1);
+	dg = ((gf - g0) << 16) / (int)(2 * width - 1);
+	db = ((bf - b0) << 16) / (int)(2 * width - 1);
 
-	a = ((float)(width - 1)) / ((float)(height - 1));
-	width = width * 3;
+	renderLine(image->data, 0, width, r0, g0, b0, dr, dg, db);
+	renderLine(image->data + (height - 1) * width * 3, width - 1, width, r0, g0, b0, dr, dg, db);
 
-	/* copy the first line to the other lines with corresponding offset */
-	for (j = 0, offset = 0.0; j < width * height; j += width) {
-		memcpy(&(image->data[j]), &ptr[3 * (int)offset], width);
-		offset += a;
-	}
+	copyDiagonalRows(image);
 
-	RReleaseImage(tmp);
 	return image;
 }
 
 static RImage *renderMHGradient(unsigned width, unsigned height, RColor ** colors, int count)
 {
-	int i, j, k;
-	long r, g, b, dr, dg, db;
+	int i;
 	unsigned lineSize = width * 3;
 	RImage *image;
-	unsigned char *ptr;
-	unsigned width2;
 
 	assert(count > 2);
 
@@ -284,45 +319,15 @@ static RImage *renderMHGradient(unsigned width, unsigned height, RColor ** color
 	if (!image) {
 		return NULL;
 	}
-	ptr = image->data;
 
 	if (count > width)
 		count = width;
 
+	/* render the first line */
 	if (count > 1)
-		width2 = width / (count - 1);
+		renderMLine(image->data, width, 0, width, colors, count);
 	else
-		width2 = width;
-
-	k = 0;
-
-	r = colors[0]->red << 16;
-	g = colors[0]->green << 16;
-	b = colors[0]->blue << 16;
-
-	/* render the first line */
-	for (i = 1; i < count; i++) {
-		dr = ((int)(colors[i]->red - colors[i - 1]->red) << 16) / (int)width2;
-		dg = ((int)(colors[i]->green - colors[i - 1]->green) << 16) / (int)width2;
-		db = ((int)(colors[i]->blue - colors[i - 1]->blue) << 16) / (int)width2;
-		for (j = 0; j < width2; j++) {
-			*ptr++ = (unsigned char)(r >> 16);
-			*ptr++ = (unsigned char)(g >> 16);
-			*ptr++ = (unsigned char)(b >> 16);
-			r += dr;
-			g += dg;
-			b += db;
-			k++;
-		}
-		r = colors[i]->red << 16;
-		g = colors[i]->green << 16;
-		b = colors[i]->blue << 16;
-	}
-	for (j = k; j < width; j++) {
-		*ptr++ = (unsigned char)(r >> 16);
-		*ptr++ = (unsigned char)(g >> 16);
-		*ptr++ = (unsigned char)(b >> 16);
-	}
+		renderGradientWidth(image->data, width, colors[0]->red, colors[0]->green, colors[0]->blue);
 
 	/* copy the first line to the other lines */
 	for (i = 1; i < height; i++) {
@@ -393,10 +398,8 @@ static RImage *renderMVGradient(unsigned width, unsigned height, RColor ** color
 
 static RImage *renderMDGradient(unsigned width, unsigned height, RColor ** colors, int count)
 {
-	RImage *image, *tmp;
-	float a, offset;
-	int j;
-	unsigned char *ptr;
+	RImage *image;
+	unsigned char *last;
 
 	assert(count > 2);
 
@@ -415,28 +418,12 @@ static RImage *renderMDGradient(unsigned width, unsigned height, RColor ** color
 	if (count > height)
 		count = height;
 
-	if (count > 2)
-		tmp = renderMHGradient(2 * width - 1, 1, colors, count);
-	else
-		tmp = renderHGradient(2 * width - 1, 1, colors[0]->red << 8,
-				      colors[0]->green << 8, colors[0]->blue << 8,
-				      colors[1]->red << 8, colors[1]->green << 8, colors[1]->blue << 8);
-
-	if (!tmp) {
-		RReleaseImage(image);
-		return NULL;
-	}
-	ptr = tmp->data;
+	last = image->data + (height - 1) * width * 3;
+	renderMLine(image->data, 2 * width - 1, 0, width, colors, count);
+	renderMLine(last, 2 * width - 1, width - 1, width, colors, count);
 
-	a = ((float)(width - 1)) / ((float)(height - 1));
-	width = width * 3;
+	copyDiagonalRows(image);
 
-	/* copy the first line to the other lines with corresponding offset */
-	for (j = 0, offset = 0; j < width * height; j += width) {
-		memcpy(&(image->data[j]), &ptr[3 * (int)offset], width);
-		offset += a;
-	}
-	RReleaseImage(tmp);
 	return image;
 }
 
@@ -34,6 +34,10 @@
 #include <time.h>
 #include <assert.h>
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
 #include "wraster.h"
 #include "imgformat.h"
 
@@ -64,6 +68,20 @@ static int RImageCacheMaxImage = -1;	/* 0 = any size */
 
 static RCachedImage *RImageCache;
 
+/*
+ * Images may be loaded from several threads at once, the cache is
+ * only used with this lock held
+ */
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define LOCK_CACHE()	pthread_mutex_lock(&cache_lock)
+#define UNLOCK_CACHE()	pthread_mutex_unlock(&cache_lock)
+#else
+#define LOCK_CACHE()
+#define UNLOCK_CACHE()
+#endif
+
 
 static WRImgFormat identFile(const char *path);
 
@@ -137,6 +155,7 @@ void RReleaseCache(void)
 {
 	int i;
 
+	LOCK_CACHE();
 	if (RImageCacheSize > 0) {
 		for (i = 0; i < RImageCacheSize; i++) {
 			if (RImageCache[i].file) {
@@ -148,6 +167,7 @@ void RReleaseCache(void)
 		RImageCache = NULL;
 		RImageCacheSize = -1;
 	}
+	UNLOCK_CACHE();
 }
 
 RImage *RLoadImage(RContext *context, const char *file, int index)
@@ -158,6 +178,7 @@ RImage *RLoadImage(RContext *context, const char *file, int index)
 
 	assert(file != NULL);
 
+	LOCK_CACHE();
 	if (RImageCacheSize < 0)
 		init_cache();
 
@@ -168,8 +189,10 @@ RImage *RLoadImage(RContext *context, const char *file, int index)
 
 				if (stat(file, &st) == 0 && st.st_mtime == RImageCache[i].last_modif) {
 					RImageCache[i].last_use = time(NULL);
+					image = RCloneImage(RImageCache[i].image);
+					UNLOCK_CACHE();
 
-					return RCloneImage(RImageCache[i].image);
+					return image;
 
 				} else {
 					free(RImageCache[i].file);
@@ -179,6 +202,7 @@ RImage *RLoadImage(RContext *context, const char *file, int index)
 			}
 		}
 	}
+	UNLOCK_CACHE();
 
 	switch (identFile(file)) {
 	case IM_ERROR:
@@ -240,8 +264,10 @@ RImage *RLoadImage(RContext *context, const char *file, int index)
 	}
 
 	/* store image in cache */
+	LOCK_CACHE();
 	if (RImageCacheSize > 0 && image &&
-	    (RImageCacheMaxImage == 0 || RImageCacheMaxImage >= image->width * image->height)) {
+	    (RImageCacheMaxImage == 0 || RImageCacheMaxImage >= image->width * image->height) &&
+	    stat(file, &st) == 0) {
 		time_t oldest = time(NULL);
 		int oldest_idx = 0;
 		int done = 0;
@@ -274,6 +300,7 @@ RImage *RLoadImage(RContext *context, const char *file, int index)
 			RImageCache[oldest_idx].last_use = time(NULL);
 		}
 	}
+	UNLOCK_CACHE();
 
 	return image;
 }
@@ -27,6 +27,7 @@
 #include <string.h>
 #include <X11/Xlib.h>
 #include "wraster.h"
+#include "blend.h"
 
 #include <assert.h>
 
@@ -177,29 +178,14 @@ void RCombineImages(RImage * image, RImage * src)
 			}
 		}
 	} else {
-		register int i;
 		unsigned char *d;
 		unsigned char *s;
-		int alpha, calpha;
 
 		d = image->data;
 		s = src->data;
 
 		if (!HAS_ALPHA(image)) {
-			for (i = 0; i < image->height * image->width; i++) {
-				alpha = *(s + 3);
-				calpha = 255 - alpha;
-				*d = (((int)*d * calpha) + ((int)*s * alpha)) / 256;
-				d++;
-				s++;
-				*d = (((int)*d * calpha) + ((int)*s * alpha)) / 256;
-				d++;
-				s++;
-				*d = (((int)*d * calpha) + ((int)*s * alpha)) / 256;
-				d++;
-				s++;
-				s++;
-			}
+			R_Blend->rgba_over_rgb(d, s, image->height * image->width);
 		} else {
 			RCombineAlpha(d, s, 1, image->width, image->height, 0, 0, 255);
 		}
@@ -208,10 +194,8 @@ void RCombineImages(RImage * image, RImage * src)
 
 void RCombineImagesWithOpaqueness(RImage * image, RImage * src, int opaqueness)
 {
-	register int i;
 	unsigned char *d;
 	unsigned char *s;
-	int c_opaqueness;
 
 	assert(image->width == src->width);
 	assert(image->height == src->height);
@@ -219,50 +203,19 @@ void RCombineImagesWithOpaqueness(RImage * image, RImage * src, int opaqueness)
 	d = image->data;
 	s = src->data;
 
-	c_opaqueness = 255 - opaqueness;
-
-#define OP opaqueness
-#define COP c_opaqueness
-
 	if (!HAS_ALPHA(src)) {
 		if (!HAS_ALPHA(image)) {
-			for (i = 0; i < image->width * image->height; i++) {
-				*d = (((int)*d * (int)COP) + ((int)*s * (int)OP)) / 256;
-				d++;
-				s++;
-				*d = (((int)*d * (int)COP) + ((int)*s * (int)OP)) / 256;
-				d++;
-				s++;
-				*d = (((int)*d * (int)COP) + ((int)*s * (int)OP)) / 256;
-				d++;
-				s++;
-			}
+			R_Blend->rgb_mix(d, s, image->width * image->height, opaqueness);
 		} else {
-			RCombineAlpha(d, s, 0, image->width, image->height, 0, 0, OP);
+			RCombineAlpha(d, s, 0, image->width, image->height, 0, 0, opaqueness);
 		}
 	} else {
-		int tmp;
-
 		if (!HAS_ALPHA(image)) {
-			for (i = 0; i < image->width * image->height; i++) {
-				tmp = (*(s + 3) * opaqueness) / 256;
-				*d = (((int)*d * (255 - tmp)) + ((int)*s * tmp)) / 256;
-				d++;
-				s++;
-				*d = (((int)*d * (255 - tmp)) + ((int)*s * tmp)) / 256;
-				d++;
-				s++;
-				*d = (((int)*d * (255 - tmp)) + ((int)*s * tmp)) / 256;
-				d++;
-				s++;
-				s++;
-			}
+			R_Blend->rgba_over_rgb_opacity(d, s, image->width * image->height, opaqueness);
 		} else {
 			RCombineAlpha(d, s, 1, image->width, image->height, 0, 0, opaqueness);
 		}
 	}
-#undef OP
-#undef COP
 }
 
 static int calculateCombineArea(RImage *des, int *sx, int *sy, unsigned int *swidth,
@@ -304,7 +257,6 @@ void RCombineArea(RImage * image, RImage * src, int sx, int sy, unsigned width,
 	int x, y, dwi, swi;
 	unsigned char *d;
 	unsigned char *s;
-	int alpha, calpha;
 
 	if (!calculateCombineArea(image, &sx, &sy, &width, &height, &dx, &dy))
 		return;
@@ -355,22 +307,9 @@ void RCombineArea(RImage * image, RImage * src, int sx, int sy, unsigned width,
 
 		if (!dalpha) {
 			for (y = 0; y < height; y++) {
-				for (x = 0; x < width; x++) {
-					alpha = *(s + 3);
-					calpha = 255 - alpha;
-					*d = (((int)*d * calpha) + ((int)*s * alpha)) / 256;
-					s++;
-					d++;
-					*d = (((int)*d * calpha) + ((int)*s * alpha)) / 256;
-					s++;
-					d++;
-					*d = (((int)*d * calpha) + ((int)*s * alpha)) / 256;
-					s++;
-					d++;
-					s++;
-				}
-				d += dwi;
-				s += swi;
+				R_Blend->rgba_over_rgb(d, s, width);
+				d += width * 3 + dwi;
+				s += width * 4 + swi;
 			}
 		} else {
 			RCombineAlpha(d, s, 1, width, height, dwi, swi, 255);
@@ -456,8 +395,7 @@ void
 RCombineAreaWithOpaqueness(RImage * image, RImage * src, int sx, int sy,
 			   unsigned width, unsigned height, int dx, int dy, int opaqueness)
 {
-	int x, y, dwi, swi;
-	int c_opaqueness;
+	int y, dwi, swi;
 	unsigned char *s, *d;
 	int dalpha = HAS_ALPHA(image);
 	int dch = (dalpha ? 4 : 3);
@@ -468,11 +406,6 @@ RCombineAreaWithOpaqueness(RImage * image, RImage * src, int sx, int sy,
 	d = image->data + (dy * image->width + dx) * dch;
 	dwi = (image->width - width) * dch;
 
-	c_opaqueness = 255 - opaqueness;
-
-#define OP opaqueness
-#define COP c_opaqueness
-
 	if (!HAS_ALPHA(src)) {
 
 		s = src->data + (sy * src->width + sx) * 3;
@@ -480,84 +413,39 @@ RCombineAreaWithOpaqueness(RImage * image, RImage * src, int sx, int sy,
 
 		if (!dalpha) {
 			for (y = 0; y < height; y++) {
-				for (x = 0; x < width; x++) {
-					*d = (((int)*d * (int)COP) + ((int)*s * (int)OP)) / 256;
-					s++;
-					d++;
-					*d = (((int)*d * (int)COP) + ((int)*s * (int)OP)) / 256;
-					s++;
-					d++;
-					*d = (((int)*d * (int)COP) + ((int)*s * (int)OP)) / 256;
-					s++;
-					d++;
-				}
-				d += dwi;
-				s += swi;
+				R_Blend->rgb_mix(d, s, width, opaqueness);
+				d += width * 3 + dwi;
+				s += width * 3 + swi;
 			}
 		} else {
-			RCombineAlpha(d, s, 0, width, height, dwi, swi, OP);
+			RCombineAlpha(d, s, 0, width, height, dwi, swi, opaqueness);
 		}
 	} else {
-		int tmp;
-
 		s = src->data + (sy * src->width + sx) * 4;
 		swi = (src->width - width) * 4;
 
 		if (!dalpha) {
 			for (y = 0; y < height; y++) {
-				for (x = 0; x < width; x++) {
-					tmp = (*(s + 3) * opaqueness) / 256;
-					*d = (((int)*d * (255 - tmp)) + ((int)*s * tmp)) / 256;
-					d++;
-					s++;
-					*d = (((int)*d * (255 - tmp)) + ((int)*s * tmp)) / 256;
-					d++;
-					s++;
-					*d = (((int)*d * (255 - tmp)) + ((int)*s * tmp)) / 256;
-					d++;
-					s++;
-					s++;
-				}
-				d += dwi;
-				s += swi;
+				R_Blend->rgba_over_rgb_opacity(d, s, width, opaqueness);
+				d += width * 3 + dwi;
+				s += width * 4 + swi;
 			}
 		} else {
-			RCombineAlpha(d, s, 1, width, height, dwi, swi, OP);
+			RCombineAlpha(d, s, 1, width, height, dwi, swi, opaqueness);
 		}
 	}
-#undef OP
-#undef COP
 }
 
 void RCombineImageWithColor(RImage * image, const RColor * color)
 {
-	register int i;
-	unsigned char *d;
-	int alpha, nalpha, r, g, b;
-
-	d = image->data;
-
 	if (!HAS_ALPHA(image)) {
 		/* Image has no alpha channel, so we consider it to be all 255.
 		 * Thus there are no transparent parts to be filled. */
 		return;
 	}
-	r = color->red;
-	g = color->green;
-	b = color->blue;
-
-	for (i = 0; i < image->width * image->height; i++) {
-		alpha = *(d + 3);
-		nalpha = 255 - alpha;
-
-		*d = (((int)*d * alpha) + (r * nalpha)) / 256;
-		d++;
-		*d = (((int)*d * alpha) + (g * nalpha)) / 256;
-		d++;
-		*d = (((int)*d * alpha) + (b * nalpha)) / 256;
-		d++;
-		d++;
-	}
+
+	R_Blend->color_under_rgba(image->data, image->width * image->height,
+				  color->red, color->green, color->blue);
 }
 
 RImage *RMakeTiledImage(RImage * tile, unsigned width, unsigned height)
@@ -30,6 +30,7 @@
 
 #include "wraster.h"
 #include "rotate.h"
+#include "blend.h"
 
 #include <math.h>
 
@@ -75,47 +76,62 @@ RImage *RRotateImage(RImage *image, float angle)
 	}
 }
 
-static RImage *rotate_image_90(RImage *source)
+/*
+ * Quarter turns, done by square tiles: the rows read and the rows written
+ * for a tile all stay in the cache, where a plain loop would write each
+ * pixel on a different line.
+ */
+#define ROTATE_TILE 32
+
+static RImage *rotate_image_quarter(RImage *source, int clockwise)
 {
 	RImage *target;
-	int nwidth, nheight;
-	int x, y;
+	int ch = (source->format == RRGBFormat) ? 3 : 4;
+	int width = source->width, height = source->height;
+	int x0, y0, x, y;
 
-	nwidth = source->height;
-	nheight = source->width;
-
-	target = RCreateImage(nwidth, nheight, (source->format != RRGBFormat));
+	target = RCreateImage(height, width, (source->format != RRGBFormat));
 	if (!target)
 		return NULL;
 
-	if (source->format == RRGBFormat) {
-		unsigned char *optr, *nptr;
-
-		optr = source->data;
-		for (x = nwidth; x; x--) {
-			nptr = target->data + 3 * (x - 1);
-			for (y = nheight; y; y--) {
-				nptr[0] = *optr++;
-				nptr[1] = *optr++;
-				nptr[2] = *optr++;
-
-				nptr += 3 * nwidth;
-			}
-		}
-
-	} else {
-		unsigned char *optr, *nptr;
-
-		optr = source->data;
-		for (x = nwidth; x; x--) {
-			nptr = target->data + 4 * (x - 1);
-			for (y = nheight; y; y--) {
-				nptr[0] = *optr++;
-				nptr[1] = *optr++;
-				nptr[2] = *optr++;
-				nptr[3] = *optr++;
-
-				nptr += 4 * nwidth;
+	for (y0 = 0; y0 < height; y0 += ROTATE_TILE) {
+		int y1 = (y0 + ROTATE_TILE < height) ? y0 + ROTATE_TILE : height;
+
+		for (x0 = 0; x0 < width; x0 += ROTATE_TILE) {
+			int x1 = (x0 + ROTATE_TILE < width) ? x0 + ROTATE_TILE : width;
+
+			for (y = y0; y < y1; y++) {
+				const unsigned char *optr = source->data + (y * width + x0) * ch;
+				unsigned char *nptr;
+				int step;
+
+				/*
+				 * source row y becomes target column height - 1 - y going down
+				 * (90 degrees) or target column y going up (270 degrees)
+				 */
+				if (clockwise) {
+					nptr = target->data + (x0 * height + height - 1 - y) * ch;
+					step = height * ch;
+				} else {
+					nptr = target->data + ((width - 1 - x0) * height + y) * ch;
+					step = -height * ch;
+				}
+
+				if (ch == 4) {
+					for (x = x0; x < x1; x++) {
+						memcpy(nptr, optr, 4);
+						optr += 4;
+						nptr += step;
+					}
+				} else {
+					for (x = x0; x < x1; x++) {
+						nptr[0] = optr[0];
+						nptr[1] = optr[1];
+						nptr[2] = optr[2];
+						optr += 3;
+						nptr += step;
+					}
+				}
 			}
 		}
 	}
@@ -123,6 +139,12 @@ static RImage *rotate_image_90(RImage *source)
 	return target;
 }
 
+static RImage *rotate_image_90(RImage *source)
+{
+	return rotate_image_quarter(source, True);
+}
+
+/* the pixels are read and written in order already, no need for tiles */
 RImage *wraster_rotate_image_180(RImage *source)
 {
 	RImage *target;
@@ -175,259 +197,134 @@ RImage *wraster_rotate_image_180(RImage *source)
 
 static RImage *rotate_image_270(RImage *source)
 {
-	RImage *target;
-	int nwidth, nheight;
-	int x, y;
-
-	nwidth = source->height;
-	nheight = source->width;
-
-	target = RCreateImage(nwidth, nheight, (source->format != RRGBFormat));
-	if (!target)
-		return NULL;
-
-	if (source->format == RRGBFormat) {
-		unsigned char *optr, *nptr;
-
-		optr = source->data;
-		for (x = nwidth; x; x--) {
-			nptr = target->data + 3 * nwidth * nheight - x * 3;
-			for (y = nheight; y; y--) {
-				nptr[0] = *optr++;
-				nptr[1] = *optr++;
-				nptr[2] = *optr++;
-
-				nptr -= 3 * nwidth;
-			}
-		}
-
-	} else {
-		unsigned char *optr, *nptr;
-
-		optr = source->data;
-		for (x = nwidth; x; x--) {
-			nptr = target->data + 4 * nwidth * nheight - x * 4;
-			for (y = nheight; y; y--) {
-				nptr[0] = *optr++;
-				nptr[1] = *optr++;
-				nptr[2] = *optr++;
-				nptr[3] = *optr++;
-
-				nptr -= 4 * nwidth;
-			}
-		}
-	}
-
-	return target;
+	return rotate_image_quarter(source, False);
 }
 
 /*
- * Image rotation through Bresenham's line algorithm:
- *
- * If a square must be rotate by angle a, like in:
- *  _______
- * |    B  |
- * |   /4\ |
- * |  /3 8\|
- * | /2 7 /|
- * |A1 6 / |      A_______B
- * | \5 / a| <--- |1 2 3 4|
- * |__C/_)_|      |5 6 7 8|
- *                C-------
- *
- * for each point P1 in the line from C to A
- *	for each point P2 in the perpendicular line starting at P1
- *		get pixel from the source and plot at P2
- *		increment pixel location from source
+ * Rotation by any angle, with bilinear filtering.
  *
+ * For each pixel of the target, the matching position in the source is
+ * followed in 16.16 fixed point along the row. Where the 2x2 pixels needed
+ * are all inside the source, whole runs go to the bilinear_span kernel;
+ * around the edges, the pixels outside are taken as transparent, which
+ * smoothes the border. The target is RGBA, its corners are transparent.
  */
 
-#if 0
-static void
-copyLine(int x1, int y1, int x2, int y2, int nwidth, int format, unsigned char *dst, unsigned char **src)
+/* floor(a / 65536), whatever the sign of a */
+#define FIXED_FLOOR(a)	((a) >= 0 ? (a) >> 16 : -((-(a) + 0xffff) >> 16))
+
+static void rotate_edge_pixel(unsigned char *d, const RImage *image, int u, int v)
 {
-	unsigned char *s = *src;
-	int dx, dy;
-	int xi, yi;
-	int offset;
-	int dpr, dpru, p;
-
-	dx = abs(x2 - x1);
-	dy = abs(y2 - y1);
-
-	if (x1 > x2)
-		xi = -1;
-	else
-		xi = 1;
-	if (y1 > y2)
-		yi = -1;
-	else
-		yi = 1;
-
-	if (dx >= dy) {
-
-		dpr = dy << 1;
-		dpru = dpr - (dx << 1);
-		p = dpr - dx;
-
-		while (dx-- >= 0) {
-			/* fetch and draw the pixel */
-			offset = (x1 + y1 * nwidth) << 2;
-			dst[offset++] = *s++;
-			dst[offset++] = *s++;
-			dst[offset++] = *s++;
-			if (format == RRGBAFormat)
-				dst[offset++] = *s++;
-			else
-				dst[offset++] = 255;
-
-			/* calc next step */
-			if (p > 0) {
-				x1 += xi;
-				y1 += yi;
-				p += dpru;
-			} else {
-				x1 += xi;
-				p += dpr;
-			}
-		}
-	} else {
+	int iu = FIXED_FLOOR(u), iv = FIXED_FLOOR(v);
+	int fu = ((unsigned int)u >> 9) & 127;
+	int fv = ((unsigned int)v >> 9) & 127;
+	unsigned char p[4][4];
+	int i, c;
+
+	if (iu < -1 || iu >= image->width || iv < -1 || iv >= image->height) {
+		memset(d, 0, 4);
+		return;
+	}
 
-		dpr = dx << 1;
-		dpru = dpr - (dy << 1);
-		p = dpr - dy;
-
-		while (dy-- >= 0) {
-			/* fetch and draw the pixel */
-			offset = (x1 + y1 * nwidth) << 2;
-			dst[offset++] = *s++;
-			dst[offset++] = *s++;
-			dst[offset++] = *s++;
-			if (format == RRGBAFormat)
-				dst[offset++] = *s++;
-			else
-				dst[offset++] = 255;
-
-			/* calc next step */
-			if (p > 0) {
-				x1 += xi;
-				y1 += yi;
-				p += dpru;
-			} else {
-				y1 += yi;
-				p += dpr;
-			}
-		}
+	for (i = 0; i < 4; i++) {
+		int x = iu + (i & 1), y = iv + (i >> 1);
+		int cx = (x < 0) ? 0 : (x >= image->width ? image->width - 1 : x);
+		int cy = (y < 0) ? 0 : (y >= image->height ? image->height - 1 : y);
+
+		/* keep the color of the nearest pixel, so the edge does not darken */
+		memcpy(p[i], image->data + (cy * image->width + cx) * 4, 4);
+		if (x != cx || y != cy)
+			p[i][3] = 0;
 	}
 
-	*src = s;
+	for (c = 0; c < 4; c++) {
+		int top = p[0][c] * (128 - fu) + p[1][c] * fu;
+		int bottom = p[2][c] * (128 - fu) + p[3][c] * fu;
+
+		d[c] = (top * (128 - fv) + bottom * fv + 8192) >> 14;
+	}
 }
-#endif
 
 static RImage *rotate_image_any(RImage *source, float angle)
 {
-	(void) angle;
-	puts("NOT FULLY IMPLEMENTED");
-	return RCloneImage(source);
-#if 0
-	RImage *img;
-	int nwidth, nheight;
-	int x1, y1;
-	int x2, y2;
-	int dx, dy;
-	int xi, yi;
-	int xx, yy;
-	unsigned char *src, *dst;
-	int dpr, dpru, p;
-
-	/* only 180o for now */
-	if (angle > 180.0F)
-		angle -= 180.0F;
-
-	angle = (angle * WM_PI) / 180.0;
-
-	nwidth = ceil(abs(cos(angle) * image->width))
-	    + ceil(abs(cos(WM_PI / 2 - angle) * image->width));
+	RImage *image, *target;
+	double rad = angle * WM_PI / 180.0;
+	double cosa = cos(rad), sina = sin(rad);
+	int width = source->width, height = source->height;
+	int nwidth, nheight, x, y;
+	int du, dv;
 
-	nheight = ceil(abs(sin(angle) * image->height))
-	    + ceil(abs(cos(WM_PI / 2 - angle) * image->height));
+	nwidth = ceil(fabs(cosa) * width + fabs(sina) * height);
+	nheight = ceil(fabs(sina) * width + fabs(cosa) * height);
 
-	img = RCreateImage(nwidth, nheight, True);
-	if (!img)
+	target = RCreateImage(nwidth, nheight, True);
+	if (!target)
 		return NULL;
 
-	src = image->data;
-	dst = img->data;
-
-	x1 = floor(abs(cos(WM_PI / 2 - angle) * image->width));
-	y1 = 0;
-
-	x2 = 0;
-	y2 = floor(abs(sin(WM_PI / 2 - angle) * image->width));
-
-	xx = floor(abs(cos(angle) * image->height)) - 1;
-	yy = nheight - 1;
-
-	printf("%ix%i, %i %i     %i %i %i\n", nwidth, nheight, x1, y1, x2, y2, (int)((angle * 180.0) / WM_PI));
-
-	dx = abs(x2 - x1);
-	dy = abs(y2 - y1);
-
-	if (x1 > x2)
-		xi = -1;
-	else
-		xi = 1;
-	if (y1 > y2)
-		yi = -1;
-	else
-		yi = 1;
-
-	if (dx >= dy) {
-		dpr = dy << 1;
-		dpru = dpr - (dx << 1);
-		p = dpr - dx;
-
-		while (dx-- >= 0) {
-
-			copyLine(x1, y1, xx, yy, nwidth, image->format, dst, &src);
-
-			/* calc next step */
-
-			if (p > 0) {
-				x1 += xi;
-				y1 += yi;
-				xx += xi;
-				yy += yi;
-				p += dpru;
-			} else {
-				x1 += xi;
-				xx += xi;
-				p += dpr;
-			}
-		}
+	if (source->format == RRGBAFormat) {
+		image = RRetainImage(source);
 	} else {
-		dpr = dx << 1;
-		dpru = dpr - (dy << 1);
-		p = dpr - dy;
+		unsigned char *optr, *nptr;
+		int i;
 
-		while (dy-- >= 0) {
-			xx = abs(x1 * sin(angle * WM_PI / 180.0));
-			yy = abs(y1 * cos(angle * WM_PI / 180.0));
+		image = RCreateImage(width, height, True);
+		if (!image) {
+			RReleaseImage(target);
+			return NULL;
+		}
 
-			copyLine(x1, y1, xx, yy, nwidth, image->format, dst, &src);
+		optr = source->data;
+		nptr = image->data;
+		for (i = width * height; i; i--) {
+			*nptr++ = *optr++;
+			*nptr++ = *optr++;
+			*nptr++ = *optr++;
+			*nptr++ = 255;
+		}
+	}
 
-			/* calc next step */
-			if (p > 0) {
-				x1 += xi;
-				y1 += yi;
-				p += dpru;
+	/* going right in the target, clockwise rotation */
+	du = lrint(cosa * 65536.0);
+	dv = lrint(-sina * 65536.0);
+
+	for (y = 0; y < nheight; y++) {
+		unsigned char *d = target->data + y * nwidth * 4;
+		double dx = 0.5 - nwidth / 2.0;
+		double dy = y + 0.5 - nheight / 2.0;
+		int u, v;
+
+		/* where the center of the first pixel of the row comes from */
+		u = lrint((dx * cosa + dy * sina + width / 2.0 - 0.5) * 65536.0);
+		v = lrint((-dx * sina + dy * cosa + height / 2.0 - 0.5) * 65536.0);
+
+#define INSIDE(u, v)	((u) >= 0 && (v) >= 0 && ((u) >> 16) < width - 1 && ((v) >> 16) < height - 1)
+
+		for (x = 0; x < nwidth; ) {
+			if (INSIDE(u, v)) {
+				int n = 1, nu = u + du, nv = v + dv;
+
+				while (x + n < nwidth && INSIDE(nu, nv)) {
+					n++;
+					nu += du;
+					nv += dv;
+				}
+				R_Blend->bilinear_span(d, image->data, width * 4, u, v, du, dv, n);
+				d += 4 * n;
+				x += n;
+				u = nu;
+				v = nv;
 			} else {
-				y1 += yi;
-				p += dpr;
+				rotate_edge_pixel(d, image, u, v);
+				d += 4;
+				x++;
+				u += du;
+				v += dv;
 			}
 		}
+#undef INSIDE
 	}
 
-	return img;
-#endif
+	RReleaseImage(image);
+
+	return target;
 }
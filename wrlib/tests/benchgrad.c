@@ -0,0 +1,94 @@
+/*
+ * Time the gradient renderers on 4K and 8K images, the size of the
+ * gradient workspace backgrounds set by wmsetbg.
+ */
+
+#include "wraster.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static const struct {
+	const char *name;
+	int width, height;
+} sizes[] = {
+	{ "4K", 3840, 2160 },
+	{ "8K", 7680, 4320 }
+};
+
+static const struct {
+	const char *name;
+	RGradientStyle style;
+} styles[] = {
+	{ "horizontal", RHorizontalGradient },
+	{ "vertical", RVerticalGradient },
+	{ "diagonal", RDiagonalGradient }
+};
+
+static RColor color_list[] = {
+	{ 0x20, 0x40, 0x80, 0xff },
+	{ 0xe0, 0xc0, 0x10, 0xff },
+	{ 0x10, 0x90, 0x30, 0xff },
+	{ 0xff, 0xff, 0xff, 0xff }
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static RImage *render(int width, int height, int ncolors, RGradientStyle style)
+{
+	RColor *colors[5];
+	int i;
+
+	if (ncolors == 2)
+		return RRenderGradient(width, height, &color_list[0], &color_list[1], style);
+
+	for (i = 0; i < ncolors; i++)
+		colors[i] = &color_list[i];
+	colors[i] = NULL;
+
+	return RRenderMultiGradient(width, height, colors, style);
+}
+
+int main(int argc, char **argv)
+{
+	int runs = 3;
+	int s, g, ncolors, i;
+
+	if (argc > 1)
+		runs = atoi(argv[1]);
+	if (runs < 1)
+		runs = 1;
+
+	for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		for (ncolors = 2; ncolors <= 4; ncolors += 2) {
+			for (g = 0; g < sizeof(styles) / sizeof(styles[0]); g++) {
+				double best = 0;
+
+				for (i = 0; i < runs; i++) {
+					double start = now();
+					RImage *image = render(sizes[s].width, sizes[s].height, ncolors, styles[g].style);
+					double t = now() - start;
+
+					if (!image) {
+						puts(RMessageForError(RErrorCode));
+						exit(1);
+					}
+					RReleaseImage(image);
+
+					if (i == 0 || t < best)
+						best = t;
+				}
+				printf("%s %d colors %-10s: %8.2f ms\n", sizes[s].name, ncolors,
+				       styles[g].name, best);
+			}
+		}
+	}
+
+	return 0;
+}
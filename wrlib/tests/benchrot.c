@@ -0,0 +1,97 @@
+/*
+ * Time RRotateImage on 4K and 8K images, RGB and RGBA, for the quarter
+ * turns and an arbitrary angle.
+ *
+ * When a display is available a context is created first, so that the
+ * library picks the vectorized kernels the CPU supports.
+ */
+
+#include <X11/Xlib.h>
+#include "wraster.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static const struct {
+	const char *name;
+	int width, height;
+} sizes[] = {
+	{ "4K", 3840, 2160 },
+	{ "8K", 7680, 4320 }
+};
+
+static const float angles[] = { 90.0, 180.0, 270.0, 30.0 };
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static RImage *make_image(int width, int height, int alpha)
+{
+	RImage *image;
+	int i, size;
+
+	image = RCreateImage(width, height, alpha);
+	if (!image) {
+		puts(RMessageForError(RErrorCode));
+		exit(1);
+	}
+
+	size = width * height * (alpha ? 4 : 3);
+	for (i = 0; i < size; i++)
+		image->data[i] = i * 7 + (i >> 12);
+
+	return image;
+}
+
+int main(int argc, char **argv)
+{
+	Display *dpy;
+	int runs = 3;
+	int s, a, alpha, i;
+
+	if (argc > 1)
+		runs = atoi(argv[1]);
+	if (runs < 1)
+		runs = 1;
+
+	dpy = XOpenDisplay(NULL);
+	if (dpy)
+		RCreateContext(dpy, DefaultScreen(dpy), NULL);
+	else
+		puts("no display, using the scalar kernels");
+
+	for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		for (alpha = 0; alpha <= 1; alpha++) {
+			RImage *image = make_image(sizes[s].width, sizes[s].height, alpha);
+
+			for (a = 0; a < sizeof(angles) / sizeof(angles[0]); a++) {
+				double best = 0;
+
+				for (i = 0; i < runs; i++) {
+					double start = now();
+					RImage *rotated = RRotateImage(image, angles[a]);
+					double t = now() - start;
+
+					if (!rotated) {
+						puts(RMessageForError(RErrorCode));
+						exit(1);
+					}
+					RReleaseImage(rotated);
+
+					if (i == 0 || t < best)
+						best = t;
+				}
+				printf("%s %s %5.1f degrees: %8.2f ms\n", sizes[s].name,
+				       alpha ? "RGBA" : "RGB ", angles[a], best);
+			}
+			RReleaseImage(image);
+		}
+	}
+
+	return 0;
+}
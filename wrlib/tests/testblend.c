@@ -0,0 +1,165 @@
+/*
+ * Check that the vectorized blending kernels give exactly the same result
+ * as the scalar ones, on random pixels and all the row lengths and offsets
+ * which exercise the ends of the vector loops.
+ *
+ * The kernels are not exported by the library, so they are built in here.
+ */
+
+#include "../blend.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_PIXELS 100
+
+static unsigned char src[MAX_PIXELS * 4 + 16];
+static unsigned char dst[MAX_PIXELS * 4 + 16];
+static unsigned char ref[MAX_PIXELS * 4 + 16];
+static unsigned char res[MAX_PIXELS * 4 + 16];
+
+static const int opacities[] = { 0, 1, 127, 128, 200, 254, 255 };
+
+static int errors = 0;
+
+static void fill_random(void)
+{
+	int i;
+
+	for (i = 0; i < (int) sizeof(src); i++) {
+		src[i] = rand();
+		dst[i] = rand();
+	}
+
+	/* make sure the special cases of the alpha combination are met */
+	for (i = 0; i < MAX_PIXELS; i += 5) {
+		src[i * 4 + 3] = (i % 2) ? 0 : 255;
+		dst[i * 4 + 3] = (i % 3) ? 0 : 255;
+	}
+}
+
+static void compare(const RBlendFunctions *f, const char *kernel, int offset, int count, int opacity)
+{
+	if (memcmp(ref, res, sizeof(ref)) != 0) {
+		printf("%s: %s differs (offset %d, %d pixels, opacity %d)\n",
+		       f->name, kernel, offset, count, opacity);
+		errors++;
+	}
+}
+
+#define RUN(f, call) \
+	do { \
+		memcpy(ref, dst, sizeof(dst)); \
+		memcpy(res, dst, sizeof(dst)); \
+		{ const RBlendFunctions *k = &R_BlendScalar; unsigned char *d = ref; call; } \
+		{ const RBlendFunctions *k = f; unsigned char *d = res; call; } \
+	} while (0)
+
+static void test_box_step(const RBlendFunctions *f, int offset, int count)
+{
+	static int acc_ref[MAX_PIXELS * 4], acc_res[MAX_PIXELS * 4];
+	int i, radius = 1 + rand() % 20;
+	int scale = 65536 / (2 * radius + 1);
+
+	for (i = 0; i < MAX_PIXELS * 4; i++)
+		acc_ref[i] = acc_res[i] = rand() % (255 * (2 * radius + 1) + 1);
+
+	memcpy(ref, dst, sizeof(dst));
+	memcpy(res, dst, sizeof(dst));
+	R_BlendScalar.box_step(ref + offset, acc_ref, src + offset, dst + offset, count, scale);
+	f->box_step(res + offset, acc_res, src + offset, dst + offset, count, scale);
+	compare(f, "box_step", offset, count, 0);
+
+	if (memcmp(acc_ref, acc_res, sizeof(acc_ref)) != 0) {
+		printf("%s: box_step sums differ (offset %d, %d bytes)\n", f->name, offset, count);
+		errors++;
+	}
+}
+
+static void test_bilinear_span(const RBlendFunctions *f, int count)
+{
+	/* src seen as a 10x10 RGBA image, spans go across it in any direction */
+	int u = (3 << 16) + rand() % (2 << 16), v = (3 << 16) + rand() % (2 << 16);
+	int du = rand() % (1 << 15) - (1 << 14), dv = rand() % (1 << 15) - (1 << 14);
+
+	if (count > 8)
+		count = 8;
+
+	memcpy(ref, dst, sizeof(dst));
+	memcpy(res, dst, sizeof(dst));
+	R_BlendScalar.bilinear_span(ref, src, 10 * 4, u, v, du, dv, count);
+	f->bilinear_span(res, src, 10 * 4, u, v, du, dv, count);
+	compare(f, "bilinear_span", 0, count, 0);
+}
+
+static void test_functions(const RBlendFunctions *f)
+{
+	int pass, offset, count, i, op;
+
+	for (pass = 0; pass < 20; pass++) {
+		fill_random();
+
+		for (offset = 0; offset < 4; offset++) {
+			for (count = 0; count <= MAX_PIXELS - offset; count++) {
+				RUN(f, k->rgba_over_rgb(d + offset * 3, src + offset, count));
+				compare(f, "rgba_over_rgb", offset, count, 255);
+
+				RUN(f, k->color_under_rgba(d + offset * 4, count, src[0], src[1], src[2]));
+				compare(f, "color_under_rgba", offset, count, 255);
+
+				test_box_step(f, offset, count * 4);
+				test_bilinear_span(f, count);
+
+				for (i = 0; i < (int) (sizeof(opacities) / sizeof(opacities[0])); i++) {
+					op = opacities[i];
+
+					RUN(f, k->rgba_over_rgb_opacity(d + offset * 3, src + offset, count, op));
+					compare(f, "rgba_over_rgb_opacity", offset, count, op);
+
+					RUN(f, k->rgb_mix(d + offset * 3, src + offset, count, op));
+					compare(f, "rgb_mix", offset, count, op);
+
+					RUN(f, k->alpha_combine(d + offset * 4, src + offset, 1, count, op));
+					compare(f, "alpha_combine", offset, count, op);
+
+					RUN(f, k->alpha_combine(d + offset * 4, src + offset, 0, count, op));
+					compare(f, "alpha_combine (RGB source)", offset, count, op);
+				}
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	(void) argc;
+	(void) argv;
+
+	srand(1);
+
+#ifdef R_BLEND_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2")) {
+		test_functions(&R_BlendSSE2);
+		puts("sse2: checked");
+	} else {
+		puts("sse2: not supported by this CPU");
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		test_functions(&R_BlendAVX2);
+		puts("avx2: checked");
+	} else {
+		puts("avx2: not supported by this CPU");
+	}
+#else
+	puts("no vectorized blending functions on this platform");
+#endif
+
+	if (errors) {
+		printf("%d errors\n", errors);
+		return 1;
+	}
+
+	return 0;
+}
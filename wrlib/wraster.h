@@ -494,6 +494,8 @@ const char *RMessageForError(int errorCode);
 
 int RBlurImage(RImage *image);
 
+int RBlurImageRadius(RImage *image, int radius);
+
 /****** Global Variables *******/
 
 extern int RErrorCode;
@@ -49,6 +49,31 @@ static int get_shifts(unsigned long mask)
 #define NORMALIZE_BLUE(pixel)	((bshift>0) ? ((pixel) & bmask) >> bshift \
     : ((pixel) & bmask) << -bshift)
 
+/*
+ * Read a pixel straight from the image buffer, for the common ZPixmap
+ * layouts; this is what XGetPixel does, without the function call and the
+ * format checks for each pixel.
+ */
+static inline unsigned long fetch_pixel(const unsigned char *p, int bpp, int byte_order)
+{
+	switch (bpp) {
+	case 32:
+		if (byte_order == LSBFirst)
+			return (unsigned long)p[0] | (unsigned long)p[1] << 8
+			    | (unsigned long)p[2] << 16 | (unsigned long)p[3] << 24;
+		return (unsigned long)p[3] | (unsigned long)p[2] << 8
+		    | (unsigned long)p[1] << 16 | (unsigned long)p[0] << 24;
+	case 24:
+		if (byte_order == LSBFirst)
+			return (unsigned long)p[0] | (unsigned long)p[1] << 8 | (unsigned long)p[2] << 16;
+		return (unsigned long)p[2] | (unsigned long)p[1] << 8 | (unsigned long)p[0] << 16;
+	default:
+		if (byte_order == LSBFirst)
+			return (unsigned long)p[0] | (unsigned long)p[1] << 8;
+		return (unsigned long)p[1] | (unsigned long)p[0] << 8;
+	}
+}
+
 RImage *RCreateImageFromXImage(RContext * context, XImage * image, XImage * mask)
 {
 	RImage *img;
@@ -104,6 +129,37 @@ RImage *RCreateImageFromXImage(RContext * context, XImage * image, XImage * mask
 					data++;
 			}
 		}
+	} else if (image->xoffset == 0 &&
+		   (image->bits_per_pixel == 32 || image->bits_per_pixel == 24 || image->bits_per_pixel == 16)) {
+		int bpp = image->bits_per_pixel;
+		int step = bpp / 8;
+
+		if (bpp == 32 && image->byte_order == LSBFirst && !mask &&
+		    rmask == 0xff0000 && gmask == 0xff00 && bmask == 0xff) {
+			/* the usual TrueColor layout: bytes are already in place */
+			for (y = 0; y < image->height; y++) {
+				const unsigned char *p = (unsigned char *)image->data + y * image->bytes_per_line;
+
+				for (x = 0; x < image->width; x++, p += 4) {
+					*(data++) = p[2];
+					*(data++) = p[1];
+					*(data++) = p[0];
+				}
+			}
+		} else {
+			for (y = 0; y < image->height; y++) {
+				const unsigned char *p = (unsigned char *)image->data + y * image->bytes_per_line;
+
+				for (x = 0; x < image->width; x++, p += step) {
+					pixel = fetch_pixel(p, bpp, image->byte_order);
+					*(data++) = NORMALIZE_RED(pixel);
+					*(data++) = NORMALIZE_GREEN(pixel);
+					*(data++) = NORMALIZE_BLUE(pixel);
+					if (mask)
+						data++;
+				}
+			}
+		}
 	} else {
 		for (y = 0; y < image->height; y++) {
 			for (x = 0; x < image->width; x++) {
@@ -147,7 +203,8 @@ RImage *RCreateImageFromXImage(RContext * context, XImage * image, XImage * mask
 RImage *RCreateImageFromDrawable(RContext * context, Drawable drawable, Pixmap mask)
 {
 	RImage *image;
-	XImage *pimg, *mimg;
+	RXImage *pimg;
+	XImage *mimg;
 	unsigned int w, h, bar;
 	int foo;
 	Window baz;
@@ -158,7 +215,7 @@ RImage *RCreateImageFromDrawable(RContext * context, Drawable drawable, Pixmap m
 		printf("wrlib: invalid window or pixmap passed to RCreateImageFromDrawable\n");
 		return NULL;
 	}
-	pimg = XGetImage(context->dpy, drawable, 0, 0, w, h, AllPlanes, ZPixmap);
+	pimg = RGetXImage(context, drawable, 0, 0, w, h);
 
 	if (!pimg) {
 		RErrorCode = RERR_XERROR;
@@ -171,9 +228,9 @@ RImage *RCreateImageFromDrawable(RContext * context, Drawable drawable, Pixmap m
 		}
 	}
 
-	image = RCreateImageFromXImage(context, pimg, mimg);
+	image = RCreateImageFromXImage(context, pimg->image, mimg);
 
-	XDestroyImage(pimg);
+	RDestroyXImage(context, pimg);
 	if (mimg)
 		XDestroyImage(mimg);
 
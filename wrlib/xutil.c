@@ -53,6 +53,187 @@ static int errorHandler(Display * dpy, XErrorEvent * err)
 	return 0;
 }
 
+/*
+ * Pixels read back from the server go through a shared memory segment which
+ * is kept from one capture to the next, instead of creating a segment for
+ * each request. It is grown on demand, up to the size needed for the whole
+ * screen; bigger requests and small ones use the X socket.
+ */
+#define CAPTURE_MIN_PIXELS	(64 * 64)
+#define CAPTURE_SIZE_ROUNDING	(64 * 1024)
+
+/* marker in RXImage->is_shared for images using the capture segment */
+#define CAPTURE_SEGMENT		2
+
+typedef struct RCaptureSegment {
+	RContext *context;
+	XShmSegmentInfo info;
+	size_t size;
+	Bool in_use;
+	struct RCaptureSegment *next;
+} RCaptureSegment;
+
+static RCaptureSegment *captureSegments = NULL;
+
+static Bool attachSegment(RContext *context, XShmSegmentInfo *info, size_t size)
+{
+	info->readOnly = False;
+	info->shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+	if (info->shmid < 0)
+		return False;
+
+	info->shmaddr = shmat(info->shmid, 0, 0);
+	if (info->shmaddr == (void *)-1) {
+		shmctl(info->shmid, IPC_RMID, 0);
+		return False;
+	}
+
+	shmError = 0;
+	XSync(context->dpy, False);
+	oldErrorHandler = XSetErrorHandler(errorHandler);
+	XShmAttach(context->dpy, info);
+	XSync(context->dpy, False);
+	XSetErrorHandler(oldErrorHandler);
+
+	/* the segment will be freed by the system when both sides detached */
+	shmctl(info->shmid, IPC_RMID, 0);
+
+	if (shmError) {
+		shmdt(info->shmaddr);
+		return False;
+	}
+
+	return True;
+}
+
+static void detachSegment(RContext *context, XShmSegmentInfo *info)
+{
+	XShmDetach(context->dpy, info);
+	XSync(context->dpy, False);
+	if (shmdt(info->shmaddr) < 0)
+		perror("wrlib: shmdt");
+}
+
+static RCaptureSegment *getCaptureSegment(RContext *context, size_t size)
+{
+	RCaptureSegment *seg;
+	Screen *screen;
+	size_t max_size;
+
+	screen = ScreenOfDisplay(context->dpy, context->screen_number);
+	max_size = (size_t) WidthOfScreen(screen) * HeightOfScreen(screen) * 4;
+	if (size > max_size)
+		return NULL;
+
+	for (seg = captureSegments; seg; seg = seg->next)
+		if (seg->context == context)
+			break;
+
+	if (seg && seg->in_use)
+		return NULL;
+
+	if (seg && seg->size >= size)
+		return seg;
+
+	if (!seg) {
+		seg = malloc(sizeof(RCaptureSegment));
+		if (!seg)
+			return NULL;
+
+		seg->context = context;
+		seg->size = 0;
+		seg->in_use = False;
+		seg->next = captureSegments;
+		captureSegments = seg;
+	} else if (seg->size > 0) {
+		detachSegment(context, &seg->info);
+		seg->size = 0;
+	}
+
+	size = (size + CAPTURE_SIZE_ROUNDING - 1) / CAPTURE_SIZE_ROUNDING * CAPTURE_SIZE_ROUNDING;
+	if (size > max_size)
+		size = max_size;
+
+	if (!attachSegment(context, &seg->info, size)) {
+		/* do not try again, the server probably cannot share memory with us */
+		context->attribs->use_shared_memory = 0;
+		return NULL;
+	}
+	seg->size = size;
+
+	return seg;
+}
+
+static RXImage *getCaptureXImage(RContext *context, Drawable d, int x, int y, unsigned width, unsigned height)
+{
+	RCaptureSegment *seg;
+	RXImage *ximg;
+	XImage *image;
+
+	image = XShmCreateImage(context->dpy, context->visual, context->depth,
+				ZPixmap, NULL, NULL, width, height);
+	if (!image)
+		return NULL;
+
+	seg = getCaptureSegment(context, (size_t) image->bytes_per_line * height);
+	if (!seg) {
+		XDestroyImage(image);
+		return NULL;
+	}
+
+	image->data = seg->info.shmaddr;
+	image->obdata = (char *)&seg->info;
+
+	if (!XShmGetImage(context->dpy, d, image, x, y, AllPlanes)) {
+		image->data = NULL;
+		XDestroyImage(image);
+		return NULL;
+	}
+
+	ximg = malloc(sizeof(RXImage));
+	if (!ximg) {
+		image->data = NULL;
+		XDestroyImage(image);
+		RErrorCode = RERR_NOMEMORY;
+		return NULL;
+	}
+
+	ximg->image = image;
+	ximg->info = seg->info;
+	ximg->is_shared = CAPTURE_SEGMENT;
+	seg->in_use = True;
+
+	return ximg;
+}
+
+static void releaseCaptureXImage(RContext *context, RXImage *rximage)
+{
+	RCaptureSegment *seg;
+
+	for (seg = captureSegments; seg; seg = seg->next)
+		if (seg->context == context)
+			seg->in_use = False;
+
+	/* the data belongs to the segment, do not let Xlib free it */
+	rximage->image->data = NULL;
+	XDestroyImage(rximage->image);
+}
+
+void R_DestroyCaptureSegment(RContext *context)
+{
+	RCaptureSegment *seg, **prev;
+
+	for (prev = &captureSegments; (seg = *prev) != NULL; prev = &seg->next) {
+		if (seg->context == context) {
+			if (seg->size > 0)
+				detachSegment(context, &seg->info);
+			*prev = seg->next;
+			free(seg);
+			break;
+		}
+	}
+}
+
 #endif
 
 RXImage *RCreateXImage(RContext * context, int depth, unsigned width, unsigned height)
@@ -159,7 +340,9 @@ void RDestroyXImage(RContext * context, RXImage * rximage)
 
 	XDestroyImage(rximage->image);
 #else				/* USE_XSHM */
-	if (rximage->is_shared) {
+	if (rximage->is_shared == CAPTURE_SEGMENT) {
+		releaseCaptureXImage(context, rximage);
+	} else if (rximage->is_shared) {
 		XSync(context->dpy, False);
 		XShmDetach(context->dpy, &rximage->info);
 		XDestroyImage(rximage->image);
@@ -191,17 +374,10 @@ RXImage *RGetXImage(RContext * context, Drawable d, int x, int y, unsigned width
 	RXImage *ximg = NULL;
 
 #ifdef USE_XSHM
-	if (context->attribs->use_shared_memory && 0) {
-		ximg = RCreateXImage(context, getDepth(context->dpy, d), width, height);
+	if (context->attribs->use_shared_memory && width * height >= CAPTURE_MIN_PIXELS &&
+	    getDepth(context->dpy, d) == context->depth)
+		ximg = getCaptureXImage(context, d, x, y, width, height);
 
-		if (ximg && !ximg->is_shared) {
-			RDestroyXImage(context, ximg);
-			ximg = NULL;
-		}
-		if (ximg) {
-			XShmGetImage(context->dpy, d, ximg->image, x, y, AllPlanes);
-		}
-	}
 	if (!ximg) {
 		ximg = malloc(sizeof(RXImage));
 		if (!ximg) {
@@ -23,6 +23,8 @@
 
 #ifdef USE_XSHM
 Pixmap R_CreateXImageMappedPixmap(RContext *context, RXImage *ximage);
+
+void R_DestroyCaptureSegment(RContext *context);
 #endif
 
 